@@ -0,0 +1,43 @@
+﻿#include <algorithm>
+#include "arena.h"
+
+FrameArena::FrameArena(std::size_t capacity)
+	: used(0),
+	  frameUsed(0),
+	  lastFrameUsed(0),
+	  overflows(0)
+{
+	blocks.push_back({std::make_unique<unsigned char[]>(capacity), capacity});
+}
+
+void FrameArena::addBlock(std::size_t size, std::size_t alignment)
+{
+	// Blocken blir minst dubbelt så stora som det förra, så att det inte behövs många.
+	const std::size_t blockSize = std::max(size + alignment, blocks.back().size * 2);
+	// Det som är kvar i det förra blocket används inte, men räknas som använt så att nästa block räcker.
+	frameUsed += blocks.back().size - used;
+	blocks.push_back({std::make_unique<unsigned char[]>(blockSize), blockSize});
+	used = 0;
+	overflows++;
+}
+
+void FrameArena::reset()
+{
+	lastFrameUsed = frameUsed;
+	if (blocks.size() > 1)
+	{
+		// Allt som användes den här framen ska få plats i ett block nästa gång.
+		const std::size_t capacity = std::max(getCapacity(), frameUsed);
+		blocks.clear();
+		blocks.push_back({std::make_unique<unsigned char[]>(capacity), capacity});
+	}
+	used = 0;
+	frameUsed = 0;
+}
+
+std::size_t FrameArena::getCapacity() const noexcept
+{
+	std::size_t capacity = 0;
+	for (const Block& block : blocks) capacity += block.size;
+	return capacity;
+}
\ No newline at end of file
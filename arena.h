@@ -0,0 +1,105 @@
+﻿#pragma once
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/*
+ * Ett linjärt minne för data som bara behövs under en frame, t.ex. renderkön och tillfälliga
+ * sorteringsbuffertar. Allokeringar flyttar bara fram en pekare och allt frigörs på en gång med
+ * reset(), som plattformen kör i början av varje frame. Om minnet tar slut lånas ett nytt block
+ * från heapen, och vid nästa reset() slås blocken ihop till ett som räcker till hela framen, så
+ * att en frame som inte är större än de tidigare inte allokerar något från heapen alls.
+ * Arenan är inte trådsäker.
+*/
+class FrameArena
+{
+private:
+	struct Block
+	{
+		std::unique_ptr<unsigned char[]> memory;
+		std::size_t size;
+	};
+	std::vector<Block> blocks; // Det sista blocket är det som allokeras från.
+	std::size_t used; // Använda bytes i det sista blocket.
+	std::size_t frameUsed; // Använda bytes i alla block sedan reset(), med utfyllnad.
+	std::size_t lastFrameUsed;
+	unsigned overflows;
+
+	// Lägger till ett block med plats för minst size bytes med alignment alignment.
+	void addBlock(std::size_t size, std::size_t alignment);
+public:
+	static constexpr std::size_t defaultCapacity = 1 << 20;
+
+	explicit FrameArena(std::size_t capacity = defaultCapacity);
+
+	// Ingen kopiering.
+	FrameArena(const FrameArena&) = delete;
+	// Ingen kopiering.
+	FrameArena& operator=(const FrameArena&) = delete;
+
+	// Returnerar size bytes med alignment alignment, som måste vara en tvåpotens som inte är större än alignof(std::max_align_t).
+	void* allocate(std::size_t size, std::size_t alignment)
+	{
+		const std::size_t start = (used + alignment - 1) & ~(alignment - 1);
+		if (start + size > blocks.back().size)
+		{
+			addBlock(size, alignment);
+			return allocate(size, alignment);
+		}
+		frameUsed += start + size - used;
+		used = start + size;
+		return blocks.back().memory.get() + start;
+	}
+	// Returnerar plats för count objekt av typen T. Objekten skapas inte.
+	template <typename T>
+	T* allocate(std::size_t count) {return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));}
+
+	// Frigör allt som har allokerats. Inga objekt förstörs, så det som ligger i arenan får inte användas efteråt.
+	void reset();
+
+	// Returnerar antalet bytes som har allokerats sedan reset().
+	std::size_t getUsed() const noexcept {return frameUsed;}
+	// Returnerar antalet bytes som allokerades mellan de två senaste reset().
+	std::size_t getLastFrameUsed() const noexcept {return lastFrameUsed;}
+	// Returnerar storleken på alla block tillsammans.
+	std::size_t getCapacity() const noexcept;
+	// Returnerar hur många gånger minnet har tagit slut, så att ett nytt block har behövts.
+	unsigned getOverflowCount() const noexcept {return overflows;}
+};
+
+/*
+ * En allocator för standardcontainrar som tar minnet från en FrameArena. deallocate() gör ingenting,
+ * så en container måste göras om (t.ex. tilldelas en ny, tom container) efter att arenan har nollställts.
+*/
+template <typename T>
+class ArenaAllocator
+{
+private:
+	FrameArena* arena;
+public:
+	typedef T value_type;
+	typedef std::true_type propagate_on_container_copy_assignment;
+	typedef std::true_type propagate_on_container_move_assignment;
+	typedef std::true_type propagate_on_container_swap;
+
+	explicit ArenaAllocator(FrameArena& arena) noexcept
+		: arena(&arena) {}
+	template <typename U>
+	ArenaAllocator(const ArenaAllocator<U>& o) noexcept
+		: arena(&o.getArena()) {}
+
+	T* allocate(std::size_t count) {return arena->allocate<T>(count);}
+	void deallocate(T*, std::size_t) noexcept {}
+
+	FrameArena& getArena() const noexcept {return *arena;}
+
+	template <typename U>
+	bool operator==(const ArenaAllocator<U>& o) const noexcept {return arena == &o.getArena();}
+	template <typename U>
+	bool operator!=(const ArenaAllocator<U>& o) const noexcept {return arena != &o.getArena();}
+};
+
+// En vector i en FrameArena.
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
\ No newline at end of file
@@ -0,0 +1,158 @@
+﻿#include <algorithm>
+#include <cmath>
+#include <tuple>
+#include "damage.h"
+
+namespace
+{
+	bool overlaps(const ScreenRect& a, const ScreenRect& b) noexcept
+	{
+		return a.startX < b.endX && b.startX < a.endX && a.startY < b.endY && b.startY < a.endY;
+	}
+
+	ScreenRect bounds(const ScreenRect& a, const ScreenRect& b) noexcept
+	{
+		return {std::min(a.startX, b.startX), std::min(a.startY, b.startY), std::max(a.endX, b.endX), std::max(a.endY, b.endY)};
+	}
+
+	uint64_t area(const ScreenRect& r) noexcept
+	{
+		return uint64_t(r.endX - r.startX) * uint64_t(r.endY - r.startY);
+	}
+
+	auto tie(const ScreenRect& r) noexcept
+	{
+		return std::tie(r.startX, r.startY, r.endX, r.endY);
+	}
+}
+
+DamageTracker::DamageTracker() noexcept
+	: width(0),
+	  height(0),
+	  full(true),
+	  redrawnPixels(0),
+	  totalPixels(0) {}
+
+void DamageTracker::beginFrame(int width, int height)
+{
+	rects.clear();
+	full = width != this->width || height != this->height;
+	this->width = width;
+	this->height = height;
+}
+
+void DamageTracker::addAll() noexcept
+{
+	full = true;
+}
+
+void DamageTracker::add(ScreenRect rect)
+{
+	rect.startX = std::max(rect.startX, 0);
+	rect.startY = std::max(rect.startY, 0);
+	rect.endX = std::min(rect.endX, width);
+	rect.endY = std::min(rect.endY, height);
+	if (rect.startX < rect.endX && rect.startY < rect.endY) rects.push_back(rect);
+}
+
+void DamageTracker::addQueue(const RenderQueue& queue, float scale)
+{
+	current.clear();
+	current.reserve(queue.size());
+	for (const RenderQueue::Item& item : queue.getItems())
+	{
+		// Bilder ritas på heltalskoordinater, se Image::draw().
+		const float x = int(item.x);
+		const float y = int(item.y);
+		current.push_back({
+			item.image,
+			item.key,
+			{
+				int(std::floor(x * scale)),
+				int(std::floor(y * scale)),
+				int(std::ceil((x + item.image->getWidth() * item.count) * scale)),
+				int(std::ceil((y + item.image->getHeight()) * scale))
+			}
+		});
+	}
+
+	// Båda listorna sorteras, och det som bara finns i den ena har ändrats. Både den gamla och den nya platsen ritas om.
+	auto less = [](const Footprint& a, const Footprint& b) -> bool {
+		return std::tie(a.key, a.image) < std::tie(b.key, b.image) || (std::tie(a.key, a.image) == std::tie(b.key, b.image) && tie(a.rect) < tie(b.rect));
+	};
+	std::sort(current.begin(), current.end(), less);
+	if (!full)
+	{
+		auto p = previous.begin();
+		auto c = current.begin();
+		while (p != previous.end() || c != current.end())
+		{
+			if (c == current.end() || (p != previous.end() && less(*p, *c)))
+			{
+				add((p++)->rect);
+			}
+			else if (p == previous.end() || less(*c, *p))
+			{
+				add((c++)->rect);
+			}
+			else
+			{
+				++p;
+				++c;
+			}
+		}
+	}
+	previous.swap(current);
+}
+
+void DamageTracker::mergeRects()
+{
+	// Upprepas tills inga rektanglar överlappar, eftersom en sammanslagen rektangel kan överlappa nya.
+	bool merged = true;
+	while (merged)
+	{
+		merged = false;
+		for (std::size_t i = 0; i < rects.size(); i++)
+		{
+			for (std::size_t j = i + 1; j < rects.size(); j++)
+			{
+				if (overlaps(rects[i], rects[j]))
+				{
+					rects[i] = bounds(rects[i], rects[j]);
+					rects[j] = rects.back();
+					rects.pop_back();
+					merged = true;
+					j = i;
+				}
+			}
+		}
+	}
+	if (rects.size() > maxRects)
+	{
+		ScreenRect all = rects[0];
+		for (const ScreenRect& r : rects) all = bounds(all, r);
+		rects.assign(1, all);
+	}
+}
+
+const std::vector<ScreenRect>& DamageTracker::finishFrame()
+{
+	if (!full)
+	{
+		mergeRects();
+		uint64_t damaged = 0;
+		for (const ScreenRect& r : rects) damaged += area(r);
+		if (damaged > fullRedrawFraction * width * height) full = true;
+	}
+	if (full) rects.assign(1, {0, 0, width, height});
+
+	for (const ScreenRect& r : rects) redrawnPixels += area(r);
+	totalPixels += uint64_t(width) * height;
+	return rects;
+}
+
+void DamageTracker::resetStats() noexcept
+{
+	redrawnPixels = 0;
+	totalPixels = 0;
+}
\ No newline at end of file
@@ -0,0 +1,70 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+#include "renderqueue.h"
+
+// En rektangel på skärmen i pixlar, [startX, endX) * [startY, endY).
+struct ScreenRect
+{
+	int startX;
+	int startY;
+	int endX;
+	int endY;
+};
+
+/*
+ * Håller reda på vilka delar av skärmen som behöver ritas om. Varje frame jämförs det som ligger i
+ * renderingskön med förra framen, och bara där något har flyttats, lagts till eller tagits bort behöver
+ * bilden ritas om. Det fungerar bara om det som ritades förra framen finns kvar, vilket det gör med
+ * DirectV::setInternalResolution(). Annars ska addAll() köras varje frame.
+*/
+class DamageTracker
+{
+public:
+	// Så många rektanglar som ritas om innan de slås ihop till en enda som täcker alla.
+	static constexpr std::size_t maxRects = 16;
+	// Om mer än så här stor del av skärmen har ändrats ritas allt om.
+	static constexpr double fullRedrawFraction = 0.5;
+private:
+	// Det som en bild i kön lämnar efter sig på skärmen.
+	struct Footprint
+	{
+		const Image* image;
+		uint64_t key;
+		ScreenRect rect;
+	};
+	std::vector<Footprint> previous;
+	std::vector<Footprint> current;
+	std::vector<ScreenRect> rects;
+	int width;
+	int height;
+	bool full;
+	uint64_t redrawnPixels;
+	uint64_t totalPixels;
+
+	// Slår ihop rektanglar som överlappar. Om det blir för många blir de en enda.
+	void mergeRects();
+public:
+	DamageTracker() noexcept;
+
+	// Påbörjar en ny frame. Om skärmens storlek har ändrats ritas allt om.
+	void beginFrame(int width, int height);
+	// Markerar hela skärmen som ändrad.
+	void addAll() noexcept;
+	// Markerar en rektangel som ändrad. Den klipps mot skärmen.
+	void add(ScreenRect rect);
+	/*
+	 * Jämför kön med den som gavs förra framen och markerar allt som skiljer sig. Kön ska vara sorterad.
+	 * scale är skalningen som kön ritas med, så att rektanglarna blir i skärmens pixlar.
+	*/
+	void addQueue(const RenderQueue& queue, float scale);
+	// Avslutar framen och returnerar rektanglarna som ska ritas om. De överlappar inte varandra.
+	const std::vector<ScreenRect>& finishFrame();
+
+	// Returnerar true om hela skärmen ska ritas om den här framen.
+	bool isFull() const noexcept {return full;}
+	// Returnerar hur stor del av pixlarna som har ritats om sedan resetStats(), mellan 0 och 1.
+	double getRedrawnFraction() const noexcept {return totalPixels == 0 ? 0.0 : double(redrawnPixels) / totalPixels;}
+	// Nollställer statistiken för getRedrawnFraction().
+	void resetStats() noexcept;
+};
\ No newline at end of file
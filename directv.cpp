@@ -1,4 +1,6 @@
-﻿#include "directv.h"
+﻿#include <algorithm>
+#include <cmath>
+#include "directv.h"
 
 template <class T>
 void SafeRelease(T*& p)
@@ -33,13 +35,13 @@ SolidBrush::SolidBrush(ID2D1HwndRenderTarget* renderTarget, const D2D1_COLOR_F&
 	if (!SUCCEEDED(hr)) throw DirectVException("Failed to create D2D brush.", hr);
 }
 
-SolidBrush::SolidBrush(SolidBrush&& o)
+SolidBrush::SolidBrush(SolidBrush&& o) noexcept
 {
 	brush = o.brush;
 	o.brush = nullptr;
 }
 
-SolidBrush& SolidBrush::operator=(SolidBrush&& o)
+SolidBrush& SolidBrush::operator=(SolidBrush&& o) noexcept
 {
 	if (this != &o)
 	{
@@ -124,33 +126,126 @@ Bitmap::Bitmap(ID2D1HwndRenderTarget* renderTarget, IWICImagingFactory* wicFacto
 	size = bitmap->GetSize();
 }
 
-Bitmap::Bitmap(Bitmap&& o)
+Bitmap::Bitmap(ID2D1HwndRenderTarget* renderTarget, unsigned width, unsigned height, const uint32_t* pixels)
+{
+	HRESULT hr = renderTarget->CreateBitmap(
+		D2D1::SizeU(width, height),
+		pixels,
+		width * sizeof(uint32_t),
+		D2D1::BitmapProperties(D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED)),
+		&bitmap
+	);
+	if (!SUCCEEDED(hr)) throw DirectVException("Failed to create D2D bitmap from memory.", hr);
+
+	size = bitmap->GetSize();
+}
+
+Bitmap::Bitmap(ID2D1Bitmap* bitmap) noexcept
+	: bitmap(bitmap),
+	  size(bitmap->GetSize()) {}
+
+Bitmap::Bitmap(Bitmap&& o) noexcept
 {
 	bitmap = o.bitmap;
 	size = o.size;
+	repeatBrushes = std::move(o.repeatBrushes);
 	o.bitmap = nullptr;
 	o.size = {};
+	o.repeatBrushes.clear();
 }
 
-Bitmap& Bitmap::operator=(Bitmap&& o)
+Bitmap& Bitmap::operator=(Bitmap&& o) noexcept
 {
 	if (this != &o)
 	{
+		releaseRepeatBrushes();
 		SafeRelease(bitmap);
 
 		bitmap = o.bitmap;
 		size = o.size;
+		repeatBrushes = std::move(o.repeatBrushes);
 		o.bitmap = nullptr;
 		o.size = {};
+		o.repeatBrushes.clear();
 	}
 	return *this;
 }
 
 Bitmap::~Bitmap()
 {
+	releaseRepeatBrushes();
 	SafeRelease(bitmap);
 }
 
+ID2D1BitmapBrush* Bitmap::getRepeatBrush(ID2D1RenderTarget* renderTarget, D2D1_RECT_U source) noexcept
+{
+	for (const RepeatBrush& repeat : repeatBrushes)
+	{
+		if (repeat.source.left == source.left && repeat.source.top == source.top && repeat.source.right == source.right && repeat.source.bottom == source.bottom)
+		{
+			return repeat.brush;
+		}
+	}
+
+	// En bitmap-brush upprepar hela sin bitmap, så delen kopieras först till en egen bitmap.
+	ID2D1Bitmap* part = nullptr;
+	HRESULT hr = renderTarget->CreateBitmap(
+		D2D1::SizeU(source.right - source.left, source.bottom - source.top),
+		nullptr,
+		0,
+		D2D1::BitmapProperties(D2D1::PixelFormat(DXGI_FORMAT_B8G8R8A8_UNORM, D2D1_ALPHA_MODE_PREMULTIPLIED)),
+		&part
+	);
+	if (!SUCCEEDED(hr)) return nullptr;
+	const D2D1_POINT_2U origin = {0, 0};
+	hr = part->CopyFromBitmap(&origin, bitmap, &source);
+	ID2D1BitmapBrush* brush = nullptr;
+	if (SUCCEEDED(hr))
+	{
+		hr = renderTarget->CreateBitmapBrush(
+			part,
+			D2D1::BitmapBrushProperties(D2D1_EXTEND_MODE_WRAP, D2D1_EXTEND_MODE_WRAP, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR),
+			&brush
+		);
+	}
+	// Brushen håller kvar bitmapen själv.
+	SafeRelease(part);
+	if (!SUCCEEDED(hr)) return nullptr;
+
+	try
+	{
+		repeatBrushes.push_back({source, brush});
+	}
+	catch (...)
+	{
+		SafeRelease(brush);
+		return nullptr;
+	}
+	return brush;
+}
+
+void Bitmap::releaseRepeatBrushes() noexcept
+{
+	for (RepeatBrush& repeat : repeatBrushes) SafeRelease(repeat.brush);
+	repeatBrushes.clear();
+}
+
+void Bitmap::copyFromMemory(const uint32_t* pixels)
+{
+	// Brusharna har kopior av pixlarna, så de görs om nästa gång de används.
+	releaseRepeatBrushes();
+	HRESULT hr = bitmap->CopyFromMemory(NULL, pixels, bitmap->GetPixelSize().width * sizeof(uint32_t));
+	if (!SUCCEEDED(hr)) throw DirectVException("Failed to copy pixels to bitmap.", hr);
+}
+
+void Bitmap::copyFromMemory(unsigned x, unsigned y, unsigned width, unsigned height, const uint32_t* pixels, unsigned pitch)
+{
+	releaseRepeatBrushes();
+	const D2D1_RECT_U rect = D2D1::RectU(x, y, x + width, y + height);
+	HRESULT hr = bitmap->CopyFromMemory(&rect, pixels, pitch * sizeof(uint32_t));
+	if (!SUCCEEDED(hr)) throw DirectVException("Failed to copy pixels to bitmap.", hr);
+}
+
 
 
 Font::Font(IDWriteFactory* DWriteFactory, const wchar_t* fontFamily, float size, const wchar_t* locale)
@@ -195,6 +290,97 @@ Font::~Font()
 	SafeRelease(textFormat);
 }
 
+TextLayout::TextLayout(IDWriteFactory* DWriteFactory, const wchar_t* text, IDWriteTextFormat* textFormat, float width, float height)
+{
+	HRESULT hr = DWriteFactory->CreateTextLayout(text, wcslen(text), textFormat, width, height, &textLayout);
+	if (!SUCCEEDED(hr)) throw DirectVException("Failed to create text layout.", hr);
+}
+
+TextLayout::TextLayout(TextLayout&& o) noexcept
+{
+	textLayout = o.textLayout;
+	o.textLayout = nullptr;
+}
+
+TextLayout& TextLayout::operator=(TextLayout&& o) noexcept
+{
+	if (this != &o)
+	{
+		SafeRelease(textLayout);
+
+		textLayout = o.textLayout;
+		o.textLayout = nullptr;
+	}
+	return *this;
+}
+
+TextLayout::~TextLayout()
+{
+	SafeRelease(textLayout);
+}
+
+GlyphAtlas::GlyphAtlas(Bitmap&& bitmap, wchar_t first, std::vector<Glyph> glyphs, float cellWidth, float cellHeight, float padding)
+	: bitmap(std::move(bitmap)),
+	  first(first),
+	  glyphs(std::move(glyphs)),
+	  cellWidth(cellWidth),
+	  cellHeight(cellHeight),
+	  padding(padding) {}
+
+template <typename Vector>
+void GlyphAtlas::placeGlyphs(std::wstring_view text, Vector& out) const
+{
+	const Glyph* fallback = glyph(L'?');
+	float x = 0.0f;
+	float y = 0.0f;
+	for (wchar_t c : text)
+	{
+		if (c == L'\n')
+		{
+			x = 0.0f;
+			y += cellHeight;
+			continue;
+		}
+		const Glyph* g = glyph(c);
+		if (!g) g = fallback;
+		if (!g) continue;
+		// Tecknen hamnar på hela pixlar, så att de inte blir suddiga.
+		out.push_back({std::round(x), y, g});
+		x += g->advance;
+	}
+}
+
+const std::vector<GlyphAtlas::PlacedGlyph>& GlyphAtlas::layout(std::wstring_view text)
+{
+	// Om två texter har samma hash ersätter den nya den gamla.
+	const std::size_t hash = std::hash<std::wstring_view>()(text);
+	const auto it = layouts.find(hash);
+	if (it != layouts.end() && it->second.text == text) return it->second.glyphs;
+	if (layouts.size() >= maxCachedLayouts) layouts.clear();
+
+	CachedLayout& cached = layouts[hash];
+	cached.text.assign(text);
+	cached.glyphs.clear();
+	placeGlyphs(text, cached.glyphs);
+	return cached.glyphs;
+}
+
+ArenaVector<GlyphAtlas::PlacedGlyph> GlyphAtlas::layout(std::wstring_view text, FrameArena& arena) const
+{
+	ArenaVector<PlacedGlyph> placed{ArenaAllocator<PlacedGlyph>(arena)};
+	placed.reserve(text.size());
+	placeGlyphs(text, placed);
+	return placed;
+}
+
+float GlyphAtlas::measure(std::wstring_view text)
+{
+	const std::vector<PlacedGlyph>& placed = layout(text);
+	float width = 0.0f;
+	for (const PlacedGlyph& g : placed) width = std::max(width, g.x + g.glyph->advance);
+	return width;
+}
+
 
 
 void DirectV::initWindow(const wchar_t* title, int width, int height, WndType wndType)
@@ -339,6 +525,7 @@ void DirectV::initD2D()
 		throw DirectVException("Failed to create DirectWrite factory.", hr);
 	}
 
+	drawTarget = renderTarget;
 	D2DInitialised = true;
 }
 
@@ -348,56 +535,136 @@ void DirectV::setD2DSize(int width, int height)
 	if (!SUCCEEDED(hr)) throw DirectVException("Failed to resize D2D render target.", hr);
 }
 
+void DirectV::updateDrawSize() noexcept
+{
+	if (targetWidth <= 0 || targetHeight <= 0)
+	{
+		pixelScale = 1;
+		drawWidth = width;
+		drawHeight = height;
+		return;
+	}
+	// Upplösningen avrundas uppåt, så att den täcker hela fönstret. Det som hamnar utanför klipps bort.
+	pixelScale = std::max(std::min(width / targetWidth, height / targetHeight), 1);
+	drawWidth = (width + pixelScale - 1) / pixelScale;
+	drawHeight = (height + pixelScale - 1) / pixelScale;
+}
+
+void DirectV::updateDrawTarget()
+{
+	if (targetWidth <= 0 || targetHeight <= 0)
+	{
+		SafeRelease(internalTarget);
+		drawTarget = renderTarget;
+		return;
+	}
+	if (internalTarget)
+	{
+		const D2D1_SIZE_U size = internalTarget->GetPixelSize();
+		if (size.width == UINT32(drawWidth) && size.height == UINT32(drawHeight)) return;
+		SafeRelease(internalTarget);
+	}
+	// Den kompatibla render targeten delar resurser med renderTarget, så brushar och bitmaps kan användas på båda.
+	HRESULT hr = renderTarget->CreateCompatibleRenderTarget(
+		D2D1::SizeF(float(drawWidth), float(drawHeight)),
+		D2D1::SizeU(drawWidth, drawHeight),
+		&internalTarget
+	);
+	if (!SUCCEEDED(hr))
+	{
+		drawTarget = renderTarget;
+		throw DirectVException("Failed to create internal render target.", hr);
+	}
+	drawTarget = internalTarget;
+	applyTransform();
+}
+
+void DirectV::applyTransform() noexcept
+{
+	drawTarget->SetTransform(rotationMatrix * D2D1::Matrix3x2F::Scale({scale.xFactor, scale.yFactor}, {scale.x, scale.y}));
+}
+
 DirectV::DirectV(HINSTANCE hInstance, const wchar_t* title, int width, int height, bool resizeable)
 	: hInstance(hInstance),
+	  internalTarget(nullptr),
+	  drawTarget(nullptr),
 	  keyData{},
 	  lastChar(L'\0'),
+	  inputWriter(inputEvents),
+	  mouseX(0),
+	  mouseY(0),
 	  D2DInitialised(false),
+	  targetWidth(0),
+	  targetHeight(0),
+	  pixelScale(1),
 	  scale{1.0f, 1.0f, 0.0f, 0.0f},
 	  rotationMatrix(D2D1::Matrix3x2F::Identity())
 {
 	initWindow(title, width, height, resizeable ? WndType::RESIZEABLE : WndType::NONRESIZEABLE);
 	initD2D();
+	updateDrawSize();
 }
 
 DirectV::DirectV(HINSTANCE hInstance, const wchar_t* title)
 	: hInstance(hInstance),
+	  internalTarget(nullptr),
+	  drawTarget(nullptr),
 	  keyData{},
 	  lastChar(L'\0'),
+	  inputWriter(inputEvents),
+	  mouseX(0),
+	  mouseY(0),
 	  D2DInitialised(false),
+	  targetWidth(0),
+	  targetHeight(0),
+	  pixelScale(1),
 	  scale{1.0f, 1.0f, 0.0f, 0.0f},
 	  rotationMatrix(D2D1::Matrix3x2F::Identity())
 {
 	initWindow(title, 0, 0, WndType::FULLSCREEN);
 	initD2D();
+	updateDrawSize();
 }
 
 DirectV::~DirectV()
 {
+	// Resurserna i poolerna tas bort innan fabrikerna och render targeten.
+	bitmaps.clear();
+	brushes.clear();
+	fonts.clear();
 	SafeRelease(DWriteFactory);
 	SafeRelease(wicFactory);
+	SafeRelease(internalTarget);
 	SafeRelease(renderTarget);
 	SafeRelease(D2DFactory);
 	if (IsWindow(hWnd)) DestroyWindow(hWnd);
 }
 
+void DirectV::setInternalResolution(int width, int height)
+{
+	targetWidth = width;
+	targetHeight = height;
+	updateDrawSize();
+	updateDrawTarget();
+}
+
 void DirectV::resetTransform() noexcept
 {
 	scale = {1.0f, 1.0f, 0.0f, 0.0f};
 	rotationMatrix = D2D1::Matrix3x2F::Identity();
-	renderTarget->SetTransform(D2D1::Matrix3x2F::Identity());
+	applyTransform();
 }
 
 void DirectV::rotateTransform(float degrees, float x, float y) noexcept
 {
 	rotationMatrix = D2D1::Matrix3x2F::Rotation(degrees, {x, y});
-	renderTarget->SetTransform(rotationMatrix * D2D1::Matrix3x2F::Scale({scale.xFactor, scale.yFactor}, {scale.x, scale.y}));
+	applyTransform();
 }
 
 void DirectV::scaleTransform(float xFactor, float yFactor, float x, float y) noexcept
 {
 	scale = {xFactor, yFactor, x, y};
-	renderTarget->SetTransform(rotationMatrix * D2D1::Matrix3x2F::Scale({scale.xFactor, scale.yFactor}, {scale.x, scale.y}));
+	applyTransform();
 }
 
 SolidBrush DirectV::createSolidBrush(const D2D1_COLOR_F& colour)
@@ -410,75 +677,211 @@ Bitmap DirectV::createBitmap(const wchar_t* filename)
 	return Bitmap(renderTarget, wicFactory, filename);
 }
 
+Bitmap DirectV::createBitmap(unsigned width, unsigned height, const uint32_t* pixels)
+{
+	return Bitmap(renderTarget, width, height, pixels);
+}
+
 Font DirectV::createFont(const wchar_t* fontFamily, float size, const wchar_t* locale)
 {
 	return Font(DWriteFactory, fontFamily, size, locale);
 }
 
-void DirectV::beginDraw() noexcept
+TextLayout DirectV::createTextLayout(const wchar_t* text, Font& font, float width, float height)
 {
+	return TextLayout(DWriteFactory, text, font.textFormat, width, height);
+}
+
+GlyphAtlas DirectV::createGlyphAtlas(Font& font, const D2D1_COLOR_F& colour, wchar_t first, wchar_t last)
+{
+	if (last < first) throw DirectVException("Invalid glyph range.");
+	const unsigned count = last - first + 1;
+
+	// Varje tecken mäts med en egen layout. Cellerna i bitmapen är lika stora som det största tecknet.
+	std::vector<GlyphAtlas::Glyph> glyphs(count);
+	float maxAdvance = 0.0f;
+	float lineHeight = 0.0f;
+	for (unsigned i = 0; i < count; i++)
+	{
+		const wchar_t c[2] = {wchar_t(first + i), L'\0'};
+		TextLayout layout = createTextLayout(c, font, 4096.0f, 4096.0f);
+		DWRITE_TEXT_METRICS metrics;
+		HRESULT hr = layout.textLayout->GetMetrics(&metrics);
+		if (!SUCCEEDED(hr)) throw DirectVException("Failed to measure glyph.", hr);
+		glyphs[i].advance = metrics.widthIncludingTrailingWhitespace;
+		maxAdvance = std::max(maxAdvance, metrics.widthIncludingTrailingWhitespace);
+		lineHeight = std::max(lineHeight, metrics.height);
+	}
+	const unsigned columns = 16;
+	const unsigned rows = (count + columns - 1) / columns;
+	const float padding = 2.0f;
+	const float cellWidth = std::ceil(maxAdvance) + padding * 2.0f;
+	const float cellHeight = std::ceil(lineHeight);
+
+	ID2D1BitmapRenderTarget* atlasTarget = nullptr;
+	HRESULT hr = renderTarget->CreateCompatibleRenderTarget(
+		D2D1::SizeF(columns * cellWidth, rows * cellHeight),
+		D2D1::SizeU(columns * cellWidth, rows * cellHeight),
+		&atlasTarget
+	);
+	if (!SUCCEEDED(hr)) throw DirectVException("Failed to create glyph atlas render target.", hr);
+	ID2D1SolidColorBrush* brush = nullptr;
+	hr = atlasTarget->CreateSolidColorBrush(colour, &brush);
+	if (!SUCCEEDED(hr))
+	{
+		SafeRelease(atlasTarget);
+		throw DirectVException("Failed to create brush.", hr);
+	}
+
+	// ClearType fungerar inte på en genomskinlig bakgrund, så tecknen ritas med gråskale-antialiasing.
+	atlasTarget->BeginDraw();
+	atlasTarget->Clear(D2D1::ColorF(0.0f, 0.0f, 0.0f, 0.0f));
+	atlasTarget->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+	for (unsigned i = 0; i < count; i++)
+	{
+		const wchar_t c = first + i;
+		glyphs[i].sourceX = (i % columns) * cellWidth;
+		glyphs[i].sourceY = (i / columns) * cellHeight;
+		atlasTarget->DrawTextW(
+			&c,
+			1,
+			font.textFormat,
+			{
+				glyphs[i].sourceX + padding,
+				glyphs[i].sourceY,
+				glyphs[i].sourceX + cellWidth,
+				glyphs[i].sourceY + cellHeight
+			},
+			brush
+		);
+	}
+	hr = atlasTarget->EndDraw();
+	SafeRelease(brush);
+	ID2D1Bitmap* bitmap = nullptr;
+	if (SUCCEEDED(hr)) hr = atlasTarget->GetBitmap(&bitmap);
+	SafeRelease(atlasTarget);
+	if (!SUCCEEDED(hr)) throw DirectVException("Failed to draw glyph atlas.", hr);
+
+	return GlyphAtlas(Bitmap(bitmap), first, std::move(glyphs), cellWidth, cellHeight, padding);
+}
+
+void DirectV::beginDraw()
+{
+	updateDrawTarget();
 	renderTarget->BeginDraw();
+	if (internalTarget) internalTarget->BeginDraw();
 }
 
 void DirectV::endDraw()
 {
+	if (internalTarget)
+	{
+		HRESULT hr = internalTarget->EndDraw();
+		if (!SUCCEEDED(hr))
+		{
+			renderTarget->EndDraw();
+			throw DirectVException("Drawing error.", hr);
+		}
+		// Bilden skalas upp en gång, med närmaste granne, till fönstret.
+		ID2D1Bitmap* bitmap = nullptr;
+		hr = internalTarget->GetBitmap(&bitmap);
+		if (!SUCCEEDED(hr))
+		{
+			renderTarget->EndDraw();
+			throw DirectVException("Failed to get internal render target bitmap.", hr);
+		}
+		renderTarget->SetTransform(D2D1::Matrix3x2F::Identity());
+		renderTarget->DrawBitmap(
+			bitmap,
+			{0.0f, 0.0f, float(drawWidth * pixelScale), float(drawHeight * pixelScale)},
+			1.0f,
+			D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR
+		);
+		SafeRelease(bitmap);
+	}
 	HRESULT hr = renderTarget->EndDraw();
 	if (!SUCCEEDED(hr)) throw DirectVException("Drawing error.", hr);
 }
 
 void DirectV::clear() noexcept
 {
-	renderTarget->Clear(D2D1::ColorF(D2D1::ColorF::Black));
+	drawTarget->Clear(D2D1::ColorF(D2D1::ColorF::Black));
 }
 
 void DirectV::clear(const D2D1_COLOR_F& colour) noexcept
 {
-	renderTarget->Clear(colour);
+	drawTarget->Clear(colour);
 }
 
 void DirectV::drawRectangle(float x, float y, float width, float height, Brush& brush) noexcept
 {
-	renderTarget->DrawRectangle(D2D1::RectF(x, y, x + width, y + height), brush.getBrush());
+	drawTarget->DrawRectangle(D2D1::RectF(x, y, x + width, y + height), brush.getBrush());
 }
 
 void DirectV::fillRectangle(float x, float y, float width, float height, Brush& brush) noexcept
 {
-	renderTarget->FillRectangle(D2D1::RectF(x, y, x + width, y + height), brush.getBrush());
+	drawTarget->FillRectangle(D2D1::RectF(x, y, x + width, y + height), brush.getBrush());
 }
 
 void DirectV::drawEllipse(float x, float y, float xRadius, float yRadius, Brush& brush) noexcept
 {
-	renderTarget->DrawEllipse({{x, y}, xRadius, yRadius}, brush.getBrush());
+	drawTarget->DrawEllipse({{x, y}, xRadius, yRadius}, brush.getBrush());
 }
 
 void DirectV::fillEllipse(float x, float y, float xRadius, float yRadius, Brush& brush) noexcept
 {
-	renderTarget->FillEllipse({{x, y}, xRadius, yRadius}, brush.getBrush());
+	drawTarget->FillEllipse({{x, y}, xRadius, yRadius}, brush.getBrush());
 }
 
 void DirectV::drawBitmap(float x, float y, Bitmap& bitmap) noexcept
 {
-	renderTarget->DrawBitmap(bitmap.bitmap, {x, y, x + bitmap.getWidth(), y + bitmap.getHeight()}, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR);
+	drawTarget->DrawBitmap(bitmap.bitmap, {x, y, x + bitmap.getWidth(), y + bitmap.getHeight()}, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR);
 }
 
 void DirectV::drawBitmap(float x, float y, float width, float height, Bitmap& bitmap) noexcept
 {
-	renderTarget->DrawBitmap(bitmap.bitmap, {x, y, x + width, y + height}, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR);
+	drawTarget->DrawBitmap(bitmap.bitmap, {x, y, x + width, y + height}, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR);
 }
 
 void DirectV::drawBitmap(float x, float y, float sourceX, float sourceY, float sourceWidth, float sourceHeight, Bitmap& bitmap) noexcept
 {
-	renderTarget->DrawBitmap(bitmap.bitmap, {x, y, x + sourceWidth, y + sourceHeight}, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR, {sourceX, sourceY, sourceX + sourceWidth, sourceY + sourceHeight});
+	drawTarget->DrawBitmap(bitmap.bitmap, {x, y, x + sourceWidth, y + sourceHeight}, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR, {sourceX, sourceY, sourceX + sourceWidth, sourceY + sourceHeight});
 }
 
 void DirectV::drawBitmap(float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight, Bitmap& bitmap) noexcept
 {
-	renderTarget->DrawBitmap(bitmap.bitmap, {x, y, x + width, y + height}, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR, {sourceX, sourceY, sourceX + sourceWidth, sourceY + sourceHeight});
+	drawTarget->DrawBitmap(bitmap.bitmap, {x, y, x + width, y + height}, 1.0f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR, {sourceX, sourceY, sourceX + sourceWidth, sourceY + sourceHeight});
+}
+
+void DirectV::drawBitmapRepeated(float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight, unsigned count, Bitmap& bitmap) noexcept
+{
+	ID2D1BitmapBrush* brush = nullptr;
+	if (count > 1 && sourceX >= 0.0f && sourceY >= 0.0f && sourceWidth >= 1.0f && sourceHeight >= 1.0f)
+	{
+		const UINT32 left = static_cast<UINT32>(sourceX);
+		const UINT32 top = static_cast<UINT32>(sourceY);
+		brush = bitmap.getRepeatBrush(renderTarget, D2D1::RectU(left, top, left + static_cast<UINT32>(sourceWidth), top + static_cast<UINT32>(sourceHeight)));
+	}
+	if (!brush)
+	{
+		for (unsigned i = 0; i < count; i++)
+		{
+			drawBitmap(x + i * width, y, width, height, sourceX, sourceY, sourceWidth, sourceHeight, bitmap);
+		}
+		return;
+	}
+
+	// Brushens bitmap skalas till (width, height) och börjar i (x, y), så att varje upprepning hamnar där drawBitmap() hade ritat den.
+	brush->SetTransform(
+		D2D1::Matrix3x2F::Scale(D2D1::SizeF(width / sourceWidth, height / sourceHeight), D2D1::Point2F(0.0f, 0.0f)) *
+		D2D1::Matrix3x2F::Translation(x, y)
+	);
+	drawTarget->FillRectangle({x, y, x + width * count, y + height}, brush);
 }
 
 void DirectV::drawText(float x, float y, float width, float height, const wchar_t* text, Font& font, Brush& brush) noexcept
 {
-	renderTarget->DrawTextW(
+	drawTarget->DrawTextW(
 		text,
 		wcslen(text),
 		font.textFormat,
@@ -492,12 +895,98 @@ void DirectV::drawText(float x, float y, float width, float height, const wchar_
 	);
 }
 
+void DirectV::drawRectangle(float x, float y, float width, float height, BrushHandle brush) noexcept
+{
+	if (SolidBrush* b = brushes.get(brush)) drawRectangle(x, y, width, height, *b);
+}
+
+void DirectV::fillRectangle(float x, float y, float width, float height, BrushHandle brush) noexcept
+{
+	if (SolidBrush* b = brushes.get(brush)) fillRectangle(x, y, width, height, *b);
+}
+
+void DirectV::drawBitmap(float x, float y, float width, float height, BitmapHandle bitmap) noexcept
+{
+	if (Bitmap* b = bitmaps.get(bitmap)) drawBitmap(x, y, width, height, *b);
+}
+
+void DirectV::drawBitmap(float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight, BitmapHandle bitmap) noexcept
+{
+	if (Bitmap* b = bitmaps.get(bitmap)) drawBitmap(x, y, width, height, sourceX, sourceY, sourceWidth, sourceHeight, *b);
+}
+
+void DirectV::drawBitmapRepeated(float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight, unsigned count, BitmapHandle bitmap) noexcept
+{
+	if (Bitmap* b = bitmaps.get(bitmap)) drawBitmapRepeated(x, y, width, height, sourceX, sourceY, sourceWidth, sourceHeight, count, *b);
+}
+
+void DirectV::drawText(float x, float y, float width, float height, const wchar_t* text, FontHandle font, BrushHandle brush) noexcept
+{
+	Font* f = fonts.get(font);
+	SolidBrush* b = brushes.get(brush);
+	if (f && b) drawText(x, y, width, height, text, *f, *b);
+}
+
+void DirectV::drawTextLayout(float x, float y, TextLayout& layout, Brush& brush) noexcept
+{
+	drawTarget->DrawTextLayout({x, y}, layout.textLayout, brush.getBrush());
+}
+
+void DirectV::drawText(float x, float y, const wchar_t* text, GlyphAtlas& atlas)
+{
+	const std::vector<GlyphAtlas::PlacedGlyph>& placed = atlas.layout(text);
+	drawGlyphs(x, y, placed.data(), placed.size(), atlas);
+}
+
+void DirectV::drawText(float x, float y, const wchar_t* text, GlyphAtlas& atlas, FrameArena& arena)
+{
+	const ArenaVector<GlyphAtlas::PlacedGlyph> placed = atlas.layout(text, arena);
+	drawGlyphs(x, y, placed.data(), placed.size(), atlas);
+}
+
+void DirectV::drawGlyphs(float x, float y, const GlyphAtlas::PlacedGlyph* glyphs, std::size_t count, const GlyphAtlas& atlas) noexcept
+{
+	for (std::size_t i = 0; i < count; i++)
+	{
+		const GlyphAtlas::PlacedGlyph& g = glyphs[i];
+		const float glyphX = x + g.x - atlas.padding;
+		const float glyphY = y + g.y;
+		drawTarget->DrawBitmap(
+			atlas.bitmap.bitmap,
+			{glyphX, glyphY, glyphX + atlas.cellWidth, glyphY + atlas.cellHeight},
+			1.0f,
+			D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR,
+			{g.glyph->sourceX, g.glyph->sourceY, g.glyph->sourceX + atlas.cellWidth, g.glyph->sourceY + atlas.cellHeight}
+		);
+	}
+}
+
+void DirectV::pushClip(float x, float y, float width, float height) noexcept
+{
+	drawTarget->PushAxisAlignedClip(D2D1::RectF(x, y, x + width, y + height), D2D1_ANTIALIAS_MODE_ALIASED);
+}
+
+void DirectV::popClip() noexcept
+{
+	drawTarget->PopAxisAlignedClip();
+}
+
 void DirectV::updateWindow()
 {
+	// Alla meddelanden hanteras, så att de inte blir liggande och ger fördröjning när det laggar.
 	MSG msg;
-    PeekMessageW(&msg, hWnd, 0, 0, PM_REMOVE);
-	TranslateMessage(&msg);
-	DispatchMessageW(&msg);
+	while (PeekMessageW(&msg, hWnd, 0, 0, PM_REMOVE))
+	{
+		TranslateMessage(&msg);
+		DispatchMessageW(&msg);
+	}
+	// Det som inte fick plats i kön läggs i den när spelet har hunnit läsa.
+	inputWriter.flush();
+}
+
+void DirectV::postInput(const InputEvent& e) noexcept
+{
+	inputWriter.post(e);
 }
 
 bool DirectV::keyDown(unsigned char key) noexcept
@@ -542,22 +1031,57 @@ LRESULT CALLBACK DirectV::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM
 			case WM_CHAR:
 			{
 				directV->lastChar = wParam;
+				directV->postInput({InputEvent::CHAR, InputClock::now(), 0, static_cast<wchar_t>(wParam), 0, 0});
 			}
 			return 0;
 			case WM_KEYDOWN:
 			{
 				directV->keyData[wParam] = true;
+				directV->postInput({InputEvent::KEY_DOWN, InputClock::now(), static_cast<unsigned char>(wParam), L'\0', 0, 0});
 			}
 			return 0;
 			case WM_KEYUP:
 			{
 				directV->keyData[wParam] = false;
+				directV->postInput({InputEvent::KEY_UP, InputClock::now(), static_cast<unsigned char>(wParam), L'\0', 0, 0});
+			}
+			return 0;
+			case WM_MOUSEMOVE:
+			{
+				directV->mouseX = static_cast<short>(LOWORD(lParam));
+				directV->mouseY = static_cast<short>(HIWORD(lParam));
+				directV->postInput({InputEvent::MOUSE_MOVE, InputClock::now(), 0, L'\0', directV->mouseX, directV->mouseY});
+			}
+			return 0;
+			case WM_LBUTTONDOWN:
+			{
+				directV->keyData[VK_LBUTTON] = true;
+				directV->postInput({InputEvent::KEY_DOWN, InputClock::now(), VK_LBUTTON, L'\0', 0, 0});
+			}
+			return 0;
+			case WM_LBUTTONUP:
+			{
+				directV->keyData[VK_LBUTTON] = false;
+				directV->postInput({InputEvent::KEY_UP, InputClock::now(), VK_LBUTTON, L'\0', 0, 0});
+			}
+			return 0;
+			case WM_RBUTTONDOWN:
+			{
+				directV->keyData[VK_RBUTTON] = true;
+				directV->postInput({InputEvent::KEY_DOWN, InputClock::now(), VK_RBUTTON, L'\0', 0, 0});
+			}
+			return 0;
+			case WM_RBUTTONUP:
+			{
+				directV->keyData[VK_RBUTTON] = false;
+				directV->postInput({InputEvent::KEY_UP, InputClock::now(), VK_RBUTTON, L'\0', 0, 0});
 			}
 			return 0;
 			case WM_SIZE:
 			{
 				directV->width = LOWORD(lParam);
 				directV->height = HIWORD(lParam);
+				directV->updateDrawSize();
 				if (directV->D2DInitialised)
 				{
 					try
@@ -579,24 +1103,6 @@ LRESULT CALLBACK DirectV::WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM
 
 
 
-Timer::Timer(double framerate) noexcept
-	: waitTime(1.0 / framerate),
-	  delta(waitTime),
-	  frameStartTime(TimerClock::now()) {}
-
-void Timer::wait()
-{
-	const auto frameEndTime = TimerClock::now();
-	const double d = (frameEndTime - frameStartTime).count() / 1000000000.0;
-
-	std::this_thread::sleep_for(std::chrono::duration<double>(waitTime - d));
-	const auto prevFrameStartTime = frameStartTime;
-	frameStartTime = TimerClock::now();
-	delta = (frameStartTime - prevFrameStartTime).count() / 1000000000.0;
-}
-
-
-
 void changeScreenResolution(int width, int height)
 {
 	DEVMODEW devMode {};
@@ -7,11 +7,18 @@
 #endif
 #include <windows.h>
 #include <d2d1.h>
+#include <cstdint>
 #include <stdexcept>
-#include <chrono>
-#include <thread>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 #include <wincodec.h>
 #include <dwrite.h>
+#include "arena.h"
+#include "input.h"
+#include "resourcepool.h"
+#include "timer.h"
 
 /*
  * Länka med:
@@ -21,8 +28,6 @@
  * - dwrite
 */
 
-using TimerClock = std::chrono::high_resolution_clock;
-
 // Exceptionklass för alla exceptions som kommer från DirectV.
 class DirectVException : public std::runtime_error
 {
@@ -64,9 +69,9 @@ protected:
 	ID2D1Brush* getBrush() noexcept override {return brush;}
 public:
 	// Movekonstruktor.
-	SolidBrush(SolidBrush&& o);
+	SolidBrush(SolidBrush&& o) noexcept;
 	// Moveoperator.
-	SolidBrush& operator=(SolidBrush&& o);
+	SolidBrush& operator=(SolidBrush&& o) noexcept;
 	// Destruktor.
 	~SolidBrush();
 
@@ -82,16 +87,31 @@ public:
 class Bitmap
 {
 private:
+	// En brush som upprepar en del av bitmapen, se DirectV::drawBitmapRepeated().
+	struct RepeatBrush
+	{
+		D2D1_RECT_U source;
+		ID2D1BitmapBrush* brush;
+	};
 	ID2D1Bitmap* bitmap;
 	D2D1_SIZE_F size;
+	std::vector<RepeatBrush> repeatBrushes;
 
 	// Skapa en Bitmap. Det är tänkt att en DirectV ska göra detta.
 	Bitmap(ID2D1HwndRenderTarget* renderTarget, IWICImagingFactory* wicFactory, const wchar_t* filename);
+	// Skapa en Bitmap från pixlar i minnet. Det är tänkt att en DirectV ska göra detta.
+	Bitmap(ID2D1HwndRenderTarget* renderTarget, unsigned width, unsigned height, const uint32_t* pixels);
+	// Skapa en Bitmap som tar över en ID2D1Bitmap. Det är tänkt att en DirectV ska göra detta.
+	explicit Bitmap(ID2D1Bitmap* bitmap) noexcept;
+	// Returnerar en brush som upprepar delen source av bitmapen. Den skapas första gången. Returnerar nullptr om det inte går.
+	ID2D1BitmapBrush* getRepeatBrush(ID2D1RenderTarget* renderTarget, D2D1_RECT_U source) noexcept;
+	// Släpper alla brushar från getRepeatBrush().
+	void releaseRepeatBrushes() noexcept;
 public:
 	// Movekonstruktor.
-	Bitmap(Bitmap&& o);
+	Bitmap(Bitmap&& o) noexcept;
 	// Moveoperator
-	Bitmap& operator=(Bitmap&& o);
+	Bitmap& operator=(Bitmap&& o) noexcept;
 	~Bitmap();
 
 	// Ingen kopiering.
@@ -104,6 +124,11 @@ public:
 	// Returnerar bitmapens höjd.
 	float getHeight() const noexcept {return size.height;}
 
+	// Skriver över hela bitmapen med pixlar i samma format som DirectV::createBitmap(width, height, pixels).
+	void copyFromMemory(const uint32_t* pixels);
+	// Skriver över en rektangel i bitmapen. pitch är antalet pixlar mellan två rader i pixels.
+	void copyFromMemory(unsigned x, unsigned y, unsigned width, unsigned height, const uint32_t* pixels, unsigned pitch);
+
 	friend DirectV;
 };
 
@@ -130,6 +155,105 @@ public:
 	friend DirectV;
 };
 
+// Klass som representerar en text vars layout redan är gjord, så att den kan ritas flera gånger utan att göras om. Den kan inte skapas direkt, utan måste skapas av en DirectV.
+class TextLayout
+{
+private:
+	IDWriteTextLayout* textLayout;
+
+	// Skapa en TextLayout. Det är tänkt att en DirectV ska göra detta.
+	TextLayout(IDWriteFactory* DWriteFactory, const wchar_t* text, IDWriteTextFormat* textFormat, float width, float height);
+public:
+	// Movekonstruktor.
+	TextLayout(TextLayout&& o) noexcept;
+	// Moveoperator.
+	TextLayout& operator=(TextLayout&& o) noexcept;
+	~TextLayout();
+
+	// Ingen kopiering.
+	TextLayout(const TextLayout&) = delete;
+	// Ingen kopiering.
+	TextLayout& operator=(const TextLayout&) = delete;
+
+	friend DirectV;
+};
+
+/*
+ * Klass med bilder av alla tecken i ett intervall för en font, ritade en gång i en bitmap. Text ritas
+ * sedan som delar av bitmapen, på samma sätt som sprites, och layouten för varje text sparas så att
+ * den inte görs om när samma text ritas igen. Den kan inte skapas direkt, utan måste skapas av en DirectV.
+*/
+class GlyphAtlas
+{
+public:
+	// Ett tecken i bitmapen.
+	struct Glyph
+	{
+		float sourceX;
+		float sourceY;
+		float advance; // Hur långt fram nästa tecken hamnar.
+	};
+	// Ett tecken i en layout, relativt till textens övre vänstra hörn.
+	struct PlacedGlyph
+	{
+		float x;
+		float y;
+		const Glyph* glyph;
+	};
+
+	// Så många layouter som sparas. När det blir fler glöms alla bort.
+	static constexpr std::size_t maxCachedLayouts = 256;
+private:
+	struct CachedLayout
+	{
+		std::wstring text;
+		std::vector<PlacedGlyph> glyphs;
+	};
+
+	Bitmap bitmap;
+	wchar_t first;
+	std::vector<Glyph> glyphs;
+	float cellWidth;
+	float cellHeight;
+	float padding; // Tomrum till vänster om varje tecken i bitmapen, för tecken som sticker ut.
+	std::unordered_map<std::size_t, CachedLayout> layouts; // Nyckeln är hashen av texten.
+
+	// Lägger tecknen i text i out.
+	template <typename Vector>
+	void placeGlyphs(std::wstring_view text, Vector& out) const;
+
+	// Skapa en GlyphAtlas. Det är tänkt att en DirectV ska göra detta.
+	GlyphAtlas(Bitmap&& bitmap, wchar_t first, std::vector<Glyph> glyphs, float cellWidth, float cellHeight, float padding);
+public:
+	// Movekonstruktor.
+	GlyphAtlas(GlyphAtlas&& o) = default;
+	// Moveoperator.
+	GlyphAtlas& operator=(GlyphAtlas&& o) = default;
+
+	// Ingen kopiering.
+	GlyphAtlas(const GlyphAtlas&) = delete;
+	// Ingen kopiering.
+	GlyphAtlas& operator=(const GlyphAtlas&) = delete;
+
+	// Returnerar tecknet c, eller nullptr om det inte finns i bitmapen.
+	const Glyph* glyph(wchar_t c) const noexcept {return c >= first && std::size_t(c - first) < glyphs.size() ? &glyphs[c - first] : nullptr;}
+	// Returnerar layouten för text. Tecken som inte finns blir frågetecken. \n börjar en ny rad.
+	const std::vector<PlacedGlyph>& layout(std::wstring_view text);
+	// Som ovan, men layouten sparas inte utan läggs i arena. För text som ändras ofta, t.ex. räknare.
+	ArenaVector<PlacedGlyph> layout(std::wstring_view text, FrameArena& arena) const;
+	// Returnerar hur bred text blir.
+	float measure(std::wstring_view text);
+
+	float getLineHeight() const noexcept {return cellHeight;}
+
+	friend DirectV;
+};
+
+// Handtag till resurser som ligger i en DirectV:s pooler.
+typedef Handle<Bitmap> BitmapHandle;
+typedef Handle<SolidBrush> BrushHandle;
+typedef Handle<Font> FontHandle;
+
 // Huvudklassen för DirectV. Den skapar fönster, initierar Direct2D etc. när man skapar den och tar bort det när den förstörs.
 class DirectV
 {
@@ -145,13 +269,26 @@ private:
 	HWND hWnd;
 	ID2D1Factory* D2DFactory;
 	ID2D1HwndRenderTarget* renderTarget;
+	ID2D1BitmapRenderTarget* internalTarget;
+	ID2D1RenderTarget* drawTarget; // Den som allt ritas på, antingen renderTarget eller internalTarget.
 	IWICImagingFactory* wicFactory;
 	bool keyData[0xff];
 	wchar_t lastChar;
+	InputQueue inputEvents;
+	InputWriter inputWriter;
+	int mouseX;
+	int mouseY;
 	bool D2DInitialised;
 	IDWriteFactory* DWriteFactory;
 	int width;
 	int height;
+	// Den upplösning som har begärts med setInternalResolution(), eller 0 * 0.
+	int targetWidth;
+	int targetHeight;
+	// Storleken på det som ritas och hur många gånger större det blir i fönstret.
+	int drawWidth;
+	int drawHeight;
+	int pixelScale;
 	struct {
 		float xFactor;
 		float yFactor;
@@ -159,6 +296,9 @@ private:
 		float y;
 	} scale;
 	D2D1_MATRIX_3X2_F rotationMatrix;
+	ResourcePool<Bitmap> bitmaps;
+	ResourcePool<SolidBrush> brushes;
+	ResourcePool<Font> fonts;
 
 	// Körs när DirectV:n skapas.
 	void initWindow(const wchar_t* title, int width, int height, WndType wndType);
@@ -166,6 +306,16 @@ private:
 	void initD2D();
 
 	void setD2DSize(int width, int height);
+	// Räknar om drawWidth, drawHeight och pixelScale efter fönstrets storlek.
+	void updateDrawSize() noexcept;
+	// Sätter drawTarget till rätt render target, och skapar om internalTarget om storleken har ändrats.
+	void updateDrawTarget();
+	// Lägger transformationen på drawTarget.
+	void applyTransform() noexcept;
+	// Lägger en händelse i inputEvents med inputWriter, så att inga tangenter tappas om kön är full.
+	void postInput(const InputEvent& e) noexcept;
+	// Ritar count tecken från en layout i atlas.
+	void drawGlyphs(float x, float y, const GlyphAtlas::PlacedGlyph* glyphs, std::size_t count, const GlyphAtlas& atlas) noexcept;
 public:
 	// Konstruktor som gör ett fönster med en bestämd storlek.
 	DirectV(HINSTANCE hInstance, const wchar_t* title, int width, int height, bool resizeable = false);
@@ -179,6 +329,15 @@ public:
 	// Ingen kopiering.
 	DirectV& operator=(const DirectV&) = delete;
 
+	/*
+	 * Ritar i en upplösning nära width * height istället för fönstrets, och skalar upp bilden med ett heltal
+	 * när den visas, så att pixelgrafik blir skarp och kostnaden för att rita inte beror på skärmens storlek.
+	 * Skalan är det största heltal som får plats i fönstret, och upplösningen görs så stor att den täcker
+	 * fönstret. getWidth(), getHeight() och musens position räknas i den upplösningen. 0 * 0 stänger av det.
+	 * Ska inte köras mellan beginDraw() och endDraw().
+	*/
+	void setInternalResolution(int width, int height);
+
 	// Återställer rotation o.d.
 	void resetTransform() noexcept;
 	// Roterar koordinatsystemet runt (x, y).
@@ -190,11 +349,41 @@ public:
 	SolidBrush createSolidBrush(const D2D1_COLOR_F& colour);
 	// Skapar en bitmap från en fil.
 	Bitmap createBitmap(const wchar_t* filename);
+	// Skapar en bitmap från pixlar i minnet. Pixlarna är rad för rad i formatet 0xAARRGGBB med förmultiplicerad alfa.
+	Bitmap createBitmap(unsigned width, unsigned height, const uint32_t* pixels);
 	// Skapar en font.
 	Font createFont(const wchar_t* fontFamily, float size, const wchar_t* locale = L"en-us");
-
-	// Denna funktion ska köras innan man börjar rita.
-	void beginDraw() noexcept;
+	// Gör layouten för en text som ska ritas i en rektangel med storleken (width, height).
+	TextLayout createTextLayout(const wchar_t* text, Font& font, float width, float height);
+	// Ritar tecknen från first till last med fonten i en GlyphAtlas.
+	GlyphAtlas createGlyphAtlas(Font& font, const D2D1_COLOR_F& colour, wchar_t first = L' ', wchar_t last = L'\u00ff');
+
+	/*
+	 * Resurser i DirectV:ns pooler. De ligger tätt i minnet och nås med handtag, så att många bitmaps och
+	 * brushar kan skapas och tas bort under spelets gång utan att minnet fragmenteras. Ett handtag till
+	 * något som har tagits bort blir ogiltigt, och att rita med ett ogiltigt handtag ritar ingenting.
+	 * Det som finns kvar i poolerna tas bort med DirectV:n.
+	*/
+
+	// Skapar en bitmap från en fil och lägger den i poolen.
+	BitmapHandle addBitmap(const wchar_t* filename) {return bitmaps.add(createBitmap(filename));}
+	// Skapar en bitmap från pixlar i minnet och lägger den i poolen. Pixlarna är som i createBitmap().
+	BitmapHandle addBitmap(unsigned width, unsigned height, const uint32_t* pixels) {return bitmaps.add(createBitmap(width, height, pixels));}
+	// Skapar en enfärgad brush och lägger den i poolen.
+	BrushHandle addSolidBrush(const D2D1_COLOR_F& colour) {return brushes.add(createSolidBrush(colour));}
+	// Skapar en font och lägger den i poolen.
+	FontHandle addFont(const wchar_t* fontFamily, float size, const wchar_t* locale = L"en-us") {return fonts.add(createFont(fontFamily, size, locale));}
+	// Tar bort en resurs ur poolen. Returnerar false om handtaget redan var ogiltigt.
+	bool release(BitmapHandle handle) {return bitmaps.remove(handle);}
+	bool release(BrushHandle handle) {return brushes.remove(handle);}
+	bool release(FontHandle handle) {return fonts.remove(handle);}
+	// Returnerar resursen som handtaget pekar på, eller nullptr om handtaget är ogiltigt. Pekaren gäller tills något läggs till i samma pool.
+	Bitmap* get(BitmapHandle handle) noexcept {return bitmaps.get(handle);}
+	SolidBrush* get(BrushHandle handle) noexcept {return brushes.get(handle);}
+	Font* get(FontHandle handle) noexcept {return fonts.get(handle);}
+
+	// Denna funktion ska köras innan man börjar rita. Kastar en exception om den interna render targeten inte kan skapas.
+	void beginDraw();
 	// Denna funktion ska köras när man har ritat klart. Kastar en exception om något har gått fel.
 	void endDraw();
 
@@ -218,13 +407,46 @@ public:
 	void drawBitmap(float x, float y, float sourceX, float sourceY, float sourceWidth, float sourceHeight, Bitmap& bitmap) noexcept;
 	// Rita en viss del av en bitmap med en annan storlek än den egentliga.
 	void drawBitmap(float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight, Bitmap& bitmap) noexcept;
+	/*
+	 * Rita en viss del av en bitmap count gånger bredvid varandra, med den första i (x, y, width, height).
+	 * Allt ritas med en bitmap-brush som upprepar delen, så det blir ett enda anrop till Direct2D.
+	*/
+	void drawBitmapRepeated(float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight, unsigned count, Bitmap& bitmap) noexcept;
 	// Rita text.
 	void drawText(float x, float y, float width, float height, const wchar_t* text, Font& font, Brush& brush) noexcept;
-
-	// Hanterar meddelanden som fönstret har fått. Denna funktion bör köras varje frame.
+	// Samma som ovan, men med resurser från poolerna.
+	void drawRectangle(float x, float y, float width, float height, BrushHandle brush) noexcept;
+	void fillRectangle(float x, float y, float width, float height, BrushHandle brush) noexcept;
+	void drawBitmap(float x, float y, float width, float height, BitmapHandle bitmap) noexcept;
+	void drawBitmap(float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight, BitmapHandle bitmap) noexcept;
+	void drawBitmapRepeated(float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight, unsigned count, BitmapHandle bitmap) noexcept;
+	void drawText(float x, float y, float width, float height, const wchar_t* text, FontHandle font, BrushHandle brush) noexcept;
+	// Rita text vars layout redan är gjord.
+	void drawTextLayout(float x, float y, TextLayout& layout, Brush& brush) noexcept;
+	// Rita text med tecknen i en GlyphAtlas. Färgen är den som atlasen skapades med.
+	void drawText(float x, float y, const wchar_t* text, GlyphAtlas& atlas);
+	// Som ovan, men layouten läggs i arena istället för att sparas i atlasen.
+	void drawText(float x, float y, const wchar_t* text, GlyphAtlas& atlas, FrameArena& arena);
+
+	// Gör så att inget ritas utanför rektangeln tills popClip() körs. Rektangeln påverkas av transformationen.
+	void pushClip(float x, float y, float width, float height) noexcept;
+	// Tar bort den senaste rektangeln från pushClip().
+	void popClip() noexcept;
+	// Returnerar true om det som ritades förra framen finns kvar när nästa frame börjar, så att bara delar av den behöver ritas om.
+	bool preservesFrame() const noexcept {return internalTarget != nullptr;}
+
+	// Hanterar alla meddelanden som fönstret har fått sedan förra gången. Denna funktion bör köras varje frame.
 	void updateWindow();
 
-	// Returnerar true om tangenten är nedtryckt.
+	/*
+	 * Returnerar kön som tangenttryckningar, tecken och musrörelser läggs i av updateWindow(). Den kan
+	 * läsas av en annan tråd än den som kör updateWindow(), men bara av en. Se InputState.
+	*/
+	InputQueue& getInputQueue() noexcept {return inputEvents;}
+	// Returnerar hur många tecken som har tappats för att kön var nästan full. Tangenter tappas aldrig.
+	std::size_t getDroppedInputEvents() const noexcept {return inputWriter.getDroppedChars();}
+
+	// Returnerar true om tangenten är nedtryckt just nu. Musknapparna räknas som tangenterna VK_LBUTTON och VK_RBUTTON.
 	bool keyDown(unsigned char key) noexcept;
 	// Får DirectV:n att glömma det senaste skrivna tecknet.
 	void clearChar() noexcept;
@@ -235,14 +457,28 @@ public:
 	HWND getHwnd() noexcept {return hWnd;}
 	// Returnerar renderTargeten.
 	ID2D1HwndRenderTarget* getRenderTarget() noexcept {return renderTarget;}
+	// Returnerar bredden på det som ritas. Det är fönstrets (inre) bredd om setInternalResolution() inte används.
+	int getWidth() const noexcept {return drawWidth;}
+	// Returnerar höjden på det som ritas. Det är fönstrets (inre) höjd om setInternalResolution() inte används.
+	int getHeight() const noexcept {return drawHeight;}
 	// Returnerar fönstrets (inre) bredd.
-	int getWidth() const noexcept {return width;}
+	int getWindowWidth() const noexcept {return width;}
 	// Returnerar fönstrets (inre) höjd.
-	int getHeight() const noexcept {return height;}
+	int getWindowHeight() const noexcept {return height;}
+	// Returnerar hur många pixlar i fönstret en ritad pixel blir.
+	int getPixelScale() const noexcept {return pixelScale;}
 	// Som getWidth() men den tar hänsyn till om man har använt scaleTransform().
-	int getEffWidth() const noexcept {return width / scale.xFactor;}
+	int getEffWidth() const noexcept {return drawWidth / scale.xFactor;}
 	// Som getHeight() men den tar hänsyn till om man har använt scaleTransform().
-	int getEffHeight() const noexcept {return height / scale.yFactor;}
+	int getEffHeight() const noexcept {return drawHeight / scale.yFactor;}
+	// Returnerar musens x-position, i samma koordinater som getWidth().
+	int getMouseX() const noexcept {return mouseX / pixelScale;}
+	// Returnerar musens y-position, i samma koordinater som getHeight().
+	int getMouseY() const noexcept {return mouseY / pixelScale;}
+	// Som getMouseX() men den tar hänsyn till om man har använt scaleTransform().
+	float getEffMouseX() const noexcept {return float(mouseX) / pixelScale / scale.xFactor;}
+	// Som getMouseY() men den tar hänsyn till om man har använt scaleTransform().
+	float getEffMouseY() const noexcept {return float(mouseY) / pixelScale / scale.yFactor;}
 	// Returnerar true om fönstret inte är stängt.
 	bool windowExists() const noexcept {return IsWindow(hWnd);}
 
@@ -250,30 +486,5 @@ public:
 	static LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam);
 };
 
-// En klass som kan användas för att försöka hålla en viss framerate.
-class Timer
-{
-private:
-	std::chrono::time_point<TimerClock> frameStartTime;
-	double waitTime;
-	double delta;
-public:
-	Timer(double framerate) noexcept;
-
-	Timer(const Timer&) = delete;
-	Timer& operator=(const Timer&) = delete;
-
-	// Ändrar frameraten.
-	void setFramerate(double framerate) noexcept {waitTime = 1.0 / framerate;}
-
-	// Väntar tills nästa frame ska börja. Funktionen räknar bort tiden som har gått sedan förra gången wait() kördes.
-	void wait();
-
-	// Returnerar ett tal som man kan multiplicera med för att snabba upp saker när det laggar.
-	double getDelta() const noexcept {return delta;}
-	// Returnerar den riktiga frameraten.
-	double getFramerate() const noexcept {return 1.0 / delta;}
-};
-
 // Ändrar skärmupplösningen. Skärmen återgår till den vanliga upplösningen när programmet avslutas.
 void changeScreenResolution(int width, int height);
\ No newline at end of file
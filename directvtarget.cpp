@@ -0,0 +1,11 @@
+﻿#include <string>
+#include "directvtarget.h"
+
+void loadImages(DirectV& dv, images_t& images)
+{
+	for (std::size_t i = 0; i < imageCount; i++)
+	{
+		const std::string file = imageFiles[i];
+		images[i] = dv.addBitmap(std::wstring(file.begin(), file.end()).c_str());
+	}
+}
\ No newline at end of file
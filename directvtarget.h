@@ -0,0 +1,39 @@
+﻿#pragma once
+#include <array>
+#include "directv.h"
+#include "image.h"
+#include "rendertarget.h"
+
+typedef std::array<BitmapHandle, imageCount> images_t;
+
+// Laddar alla bilder i imageFiles till dv:s pool.
+void loadImages(DirectV& dv, images_t& images);
+
+// En RenderTarget som ritar med en DirectV. Bilderna tas från images.
+class DirectVTarget : public RenderTarget
+{
+private:
+	DirectV& dv;
+	images_t& images;
+public:
+	DirectVTarget(DirectV& dv, images_t& images)
+		: dv(dv),
+		  images(images) {}
+
+	void setScale(float scale) override {dv.scaleTransform(scale, scale, 0.0f, 0.0f);}
+	int getEffWidth() const noexcept override {return dv.getEffWidth();}
+	int getEffHeight() const noexcept override {return dv.getEffHeight();}
+
+	void drawImage(ImageID imageID, float x, float y, float width, float height) override
+	{
+		dv.drawBitmap(x, y, width, height, images[imageID]);
+	}
+	void drawImage(ImageID imageID, float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight) override
+	{
+		dv.drawBitmap(x, y, width, height, sourceX, sourceY, sourceWidth, sourceHeight, images[imageID]);
+	}
+	void drawImageRepeated(ImageID imageID, float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight, unsigned count) override
+	{
+		dv.drawBitmapRepeated(x, y, width, height, sourceX, sourceY, sourceWidth, sourceHeight, count, images[imageID]);
+	}
+};
\ No newline at end of file
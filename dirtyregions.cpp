@@ -0,0 +1,70 @@
+﻿#include <algorithm>
+#include "dirtyregions.h"
+
+DirtyRegions::DirtyRegions(World& world)
+	: world(world)
+{
+	world.dirtyRegions.push_back(this);
+}
+
+DirtyRegions::~DirtyRegions()
+{
+	auto& v = world.dirtyRegions;
+	v.erase(std::remove(v.begin(), v.end(), this), v.end());
+}
+
+void DirtyRegions::add(TileRect rect)
+{
+	if (rect.startX >= rect.endX || rect.startZ >= rect.endZ) return;
+
+	// Slå ihop med alla rektanglar som rektangeln överlappar eller rör vid. Den sammanslagna
+	// rektangeln kan i sin tur röra vid andra, så loopen börjar om tills inget mer slås ihop.
+	bool merged = true;
+	while (merged)
+	{
+		merged = false;
+		for (std::size_t i = 0; i < rects.size(); i++)
+		{
+			const TileRect& r = rects[i];
+			if (r.startX <= rect.endX && rect.startX <= r.endX && r.startZ <= rect.endZ && rect.startZ <= r.endZ)
+			{
+				rect.startX = std::min(rect.startX, r.startX);
+				rect.startZ = std::min(rect.startZ, r.startZ);
+				rect.endX = std::max(rect.endX, r.endX);
+				rect.endZ = std::max(rect.endZ, r.endZ);
+				rects[i] = rects.back();
+				rects.pop_back();
+				merged = true;
+				break;
+			}
+		}
+	}
+	rects.push_back(rect);
+
+	if (rects.size() > maxRects)
+	{
+		TileRect bounds = rects[0];
+		for (const TileRect& r : rects)
+		{
+			bounds.startX = std::min(bounds.startX, r.startX);
+			bounds.startZ = std::min(bounds.startZ, r.startZ);
+			bounds.endX = std::max(bounds.endX, r.endX);
+			bounds.endZ = std::max(bounds.endZ, r.endZ);
+		}
+		rects.clear();
+		rects.push_back(bounds);
+	}
+}
+
+void DirtyRegions::addAll()
+{
+	rects.clear();
+	rects.push_back({0, 0, static_cast<int>(world.getWidth()), static_cast<int>(world.getDepth())});
+}
+
+std::vector<TileRect> DirtyRegions::take()
+{
+	std::vector<TileRect> result;
+	result.swap(rects);
+	return result;
+}
\ No newline at end of file
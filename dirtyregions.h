@@ -0,0 +1,36 @@
+﻿#pragma once
+#include <vector>
+#include "world.h"
+
+/*
+ * Samlar ihop de delar av en värld som har ändrats sedan den senaste take(). Varje sak som cachar något
+ * som beror på världens höjder (renderingscacher, vägsökning o.d.) ska ha en egen DirtyRegions.
+ * Den registrerar sig hos världen när den skapas och avregistrerar sig när den förstörs, så världen
+ * måste leva längre än den.
+*/
+class DirtyRegions
+{
+private:
+	World& world;
+	std::vector<TileRect> rects;
+public:
+	// Så många rektanglar som sparas innan de slås ihop till en enda som täcker alla.
+	static constexpr std::size_t maxRects = 32;
+
+	DirtyRegions(World& world);
+	~DirtyRegions();
+
+	// Ingen kopiering.
+	DirtyRegions(const DirtyRegions&) = delete;
+	// Ingen kopiering.
+	DirtyRegions& operator=(const DirtyRegions&) = delete;
+
+	// Markerar en rektangel som ändrad. Rektanglar som överlappar eller rör vid varandra slås ihop.
+	void add(TileRect rect);
+	// Markerar hela världen som ändrad.
+	void addAll();
+	// Returnerar true om inget har ändrats.
+	bool empty() const noexcept {return rects.empty();}
+	// Returnerar de ändrade rektanglarna och glömmer dem.
+	std::vector<TileRect> take();
+};
\ No newline at end of file
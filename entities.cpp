@@ -0,0 +1,163 @@
+﻿#include <algorithm>
+#include <iterator>
+#include "entities.h"
+#include "physics.h"
+
+EntityID Entities::add(FixedPoint3D pos, const Hitbox& hitbox, const Image& sprite)
+{
+	EntityID id;
+	if (freeIDs.empty())
+	{
+		id = indices.size();
+		indices.push_back(0);
+	}
+	else
+	{
+		id = freeIDs.back();
+		freeIDs.pop_back();
+	}
+	indices[id] = ids.size();
+
+	posX.push_back(pos.x);
+	posY.push_back(pos.y);
+	posZ.push_back(pos.z);
+	velX.push_back(Fixed());
+	velZ.push_back(Fixed());
+	yVel.push_back(Fixed());
+	jumping.push_back(0);
+	hitboxes.push_back(hitbox);
+	sprites.push_back(sprite);
+	ids.push_back(id);
+	return id;
+}
+
+void Entities::remove(EntityID id)
+{
+	const unsigned i = indices.at(id);
+	if (i >= ids.size() || ids[i] != id) throw std::out_of_range("Entity does not exist");
+	const std::size_t last = ids.size() - 1;
+	posX[i] = posX[last];
+	posY[i] = posY[last];
+	posZ[i] = posZ[last];
+	velX[i] = velX[last];
+	velZ[i] = velZ[last];
+	yVel[i] = yVel[last];
+	jumping[i] = jumping[last];
+	hitboxes[i] = hitboxes[last];
+	sprites[i] = sprites[last];
+	ids[i] = ids[last];
+	indices[ids[i]] = i;
+
+	posX.pop_back();
+	posY.pop_back();
+	posZ.pop_back();
+	velX.pop_back();
+	velZ.pop_back();
+	yVel.pop_back();
+	jumping.pop_back();
+	hitboxes.pop_back();
+	sprites.pop_back();
+	ids.pop_back();
+	freeIDs.push_back(id);
+}
+
+void Entities::clear() noexcept
+{
+	posX.clear();
+	posY.clear();
+	posZ.clear();
+	velX.clear();
+	velZ.clear();
+	yVel.clear();
+	jumping.clear();
+	hitboxes.clear();
+	sprites.clear();
+	ids.clear();
+	indices.clear();
+	freeIDs.clear();
+}
+
+void Entities::updateRange(World& world, std::size_t start, std::size_t end)
+{
+	// Gravitationen läggs på i en egen loop utan förgreningar som kompilatorn kan vektorisera.
+	Fixed* yVels = yVel.data();
+	for (std::size_t i = start; i < end; i++)
+	{
+		yVels[i] = applyGravity(yVels[i]);
+	}
+
+	for (std::size_t i = start; i < end; i++)
+	{
+		FixedPoint3D pos = {posX[i], posY[i], posZ[i]};
+		moveActorHorizontally(pos, hitboxes[i], velX[i], velZ[i], world);
+		moveActorVertically(pos, yVels[i], hitboxes[i], jumping[i] != 0, world);
+		posX[i] = pos.x;
+		posY[i] = pos.y;
+		posZ[i] = pos.z;
+	}
+}
+
+void Entities::update(World& world)
+{
+	updateRange(world, 0, ids.size());
+}
+
+void Entities::update(World& world, ThreadPool& pool)
+{
+	pool.parallelFor(ids.size(), 256, [&](std::size_t start, std::size_t end) {
+		updateRange(world, start, end);
+	});
+}
+
+namespace
+{
+	// Sprider ut de 16 lägsta bitarna så att det blir en nolla mellan varje bit.
+	uint32_t spreadBits(uint32_t v) noexcept
+	{
+		v &= 0xffff;
+		v = (v | (v << 8)) & 0x00ff00ff;
+		v = (v | (v << 4)) & 0x0f0f0f0f;
+		v = (v | (v << 2)) & 0x33333333;
+		v = (v | (v << 1)) & 0x55555555;
+		return v;
+	}
+
+	// Flyttar om v i den ordning som order anger. Den gamla ordningen kopieras till arenan.
+	template <typename T>
+	void permute(std::vector<T>& v, const ArenaVector<std::pair<uint32_t, unsigned>>& order, FrameArena& arena)
+	{
+		ArenaVector<T> old(std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()), ArenaAllocator<T>(arena));
+		for (std::size_t i = 0; i < order.size(); i++)
+		{
+			v[i] = std::move(old[order[i].second]);
+		}
+	}
+}
+
+void Entities::sortSpatially(FrameArena& arena)
+{
+	// Sortera efter en Z-ordningskurva över tiles, så att närliggande tiles hamnar nära varandra.
+	ArenaVector<std::pair<uint32_t, unsigned>> order(ids.size(), ArenaAllocator<std::pair<uint32_t, unsigned>>(arena));
+	for (std::size_t i = 0; i < ids.size(); i++)
+	{
+		const uint32_t x = std::clamp<int64_t>(posX[i].floorShift(tileWidthShift), 0, 65535);
+		const uint32_t z = std::clamp<int64_t>(posZ[i].floorShift(tileTopHeightShift), 0, 65535);
+		order[i] = {spreadBits(x) | spreadBits(z) << 1, static_cast<unsigned>(i)};
+	}
+	std::sort(order.begin(), order.end());
+
+	permute(posX, order, arena);
+	permute(posY, order, arena);
+	permute(posZ, order, arena);
+	permute(velX, order, arena);
+	permute(velZ, order, arena);
+	permute(yVel, order, arena);
+	permute(jumping, order, arena);
+	permute(hitboxes, order, arena);
+	permute(sprites, order, arena);
+	permute(ids, order, arena);
+	for (std::size_t i = 0; i < ids.size(); i++)
+	{
+		indices[ids[i]] = i;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+﻿#pragma once
+#include <vector>
+#include "arena.h"
+#include "fixedpoint.h"
+#include "geoutils.h"
+#include "hitbox.h"
+#include "image.h"
+#include "world.h"
+#include "threadpool.h"
+
+// Ett id för en entitet. Id:t är giltigt tills entiteten tas bort, sedan kan det återanvändas.
+typedef unsigned EntityID;
+
+/*
+ * Lagrar många entiteter (NPC:er, projektiler o.d.) med en array per komponent, så att
+ * uppdateringar som bara rör några komponenter går igenom tät minne. Entiteterna ligger
+ * tätt packade i index [0, size()), men ett index kan ändras när en annan entitet tas bort,
+ * så den som vill hålla reda på en viss entitet ska spara dess EntityID.
+ *
+ * Positioner och hastigheter är fixtal, som spelarens, så att entiteterna rör sig likadant på alla plattformar.
+*/
+class Entities
+{
+private:
+	std::vector<Fixed> posX;
+	std::vector<Fixed> posY;
+	std::vector<Fixed> posZ;
+	std::vector<Fixed> velX; // Hastighet i x-led, per tick.
+	std::vector<Fixed> velZ; // Hastighet i z-led, per tick.
+	std::vector<Fixed> yVel;
+	std::vector<unsigned char> jumping; // 1 om entiteten hoppar när den landar.
+	std::vector<Hitbox> hitboxes;
+	std::vector<Image> sprites;
+	std::vector<EntityID> ids; // Index -> id.
+	std::vector<unsigned> indices; // Id -> index.
+	std::vector<EntityID> freeIDs;
+
+	// Flyttar entiteterna i [start, end) ett tick.
+	void updateRange(World& world, std::size_t start, std::size_t end);
+public:
+	// Lägger till en entitet och returnerar dess id.
+	EntityID add(FixedPoint3D pos, const Hitbox& hitbox, const Image& sprite);
+	// Tar bort en entitet. Den sista entiteten flyttas till det lediga indexet.
+	void remove(EntityID id);
+	// Tar bort alla entiteter.
+	void clear() noexcept;
+
+	// Returnerar antalet entiteter.
+	std::size_t size() const noexcept {return ids.size();}
+	// Returnerar indexet för en entitet.
+	unsigned indexOf(EntityID id) const {return indices.at(id);}
+	// Returnerar id:t för entiteten på ett index.
+	EntityID idAt(std::size_t i) const noexcept {return ids[i];}
+
+	FixedPoint3D getPos(std::size_t i) const noexcept {return {posX[i], posY[i], posZ[i]};}
+	void setPos(std::size_t i, FixedPoint3D pos) noexcept {posX[i] = pos.x; posY[i] = pos.y; posZ[i] = pos.z;}
+	// Sätter hastigheten i x- och z-led (i pixlar per tick).
+	void setVelocity(std::size_t i, Fixed x, Fixed z) noexcept {velX[i] = x; velZ[i] = z;}
+	Fixed getVelocityX(std::size_t i) const noexcept {return velX[i];}
+	Fixed getVelocityZ(std::size_t i) const noexcept {return velZ[i];}
+	// Om jumping är true hoppar entiteten varje gång den står på marken, som spelaren när mellanslag hålls ner.
+	void setJumping(std::size_t i, bool jumping) noexcept {this->jumping[i] = jumping;}
+	bool isJumping(std::size_t i) const noexcept {return jumping[i] != 0;}
+	// Returnerar den vertikala hastigheten (i pixlar per tick, uppåt är positivt).
+	Fixed getYVel(std::size_t i) const noexcept {return yVel[i];}
+	const Hitbox& getHitbox(std::size_t i) const noexcept {return hitboxes[i];}
+	const Image& getSprite(std::size_t i) const noexcept {return sprites[i];}
+
+	// Direkt tillgång till positionsarrayerna för kod som går igenom alla entiteter.
+	const Fixed* getPosX() const noexcept {return posX.data();}
+	const Fixed* getPosY() const noexcept {return posY.data();}
+	const Fixed* getPosZ() const noexcept {return posZ.data();}
+
+	// Flyttar alla entiteter ett tick med samma rörelse och kollisioner som spelaren.
+	void update(World& world);
+	/*
+	 * Som update(), men entiteterna delas upp i sammanhängande bitar som flyttas parallellt.
+	 * Kör sortSpatially() då och då så att varje bit motsvarar ett område i världen.
+	*/
+	void update(World& world, ThreadPool& pool);
+	// Sorterar entiteterna så att entiteter som är nära varandra i världen också ligger nära varandra i minnet. Tillfälliga buffertar tas från arena.
+	void sortSpatially(FrameArena& arena);
+};
\ No newline at end of file
@@ -0,0 +1,87 @@
+﻿#include <algorithm>
+#include "filewatcher.h"
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+FileWatcher::FileWatcher()
+	: inotify(-1),
+	  lastPoll(std::chrono::steady_clock::now())
+{
+#ifdef __linux__
+	inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+	if (inotify >= 0) close(inotify);
+#endif
+}
+
+std::filesystem::file_time_type FileWatcher::writeTime(const std::string& path) noexcept
+{
+	std::error_code error;
+	const std::filesystem::file_time_type time = std::filesystem::last_write_time(path, error);
+	return error ? std::filesystem::file_time_type::min() : time;
+}
+
+void FileWatcher::watch(const std::string& path)
+{
+	const std::filesystem::path p(path);
+	WatchedFile file = {path, p.has_parent_path() ? p.parent_path() : std::filesystem::path("."), p.filename(), -1, writeTime(path)};
+#ifdef __linux__
+	if (inotify >= 0)
+	{
+		// Program som sparar genom att skriva en ny fil och byta namn på den märks med IN_MOVED_TO.
+		file.watch = inotify_add_watch(inotify, file.directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+	}
+#endif
+	files.push_back(std::move(file));
+}
+
+std::vector<std::string> FileWatcher::takeChanged()
+{
+	std::vector<std::string> changed;
+	auto add = [&](const std::string& path) {
+		if (std::find(changed.begin(), changed.end(), path) == changed.end()) changed.push_back(path);
+	};
+
+#ifdef __linux__
+	if (inotify >= 0)
+	{
+		alignas(inotify_event) char buffer[4096];
+		ssize_t length;
+		while ((length = read(inotify, buffer, sizeof(buffer))) > 0)
+		{
+			for (char* p = buffer; p < buffer + length; p += sizeof(inotify_event) + reinterpret_cast<inotify_event*>(p)->len)
+			{
+				const inotify_event* event = reinterpret_cast<inotify_event*>(p);
+				if (event->len == 0) continue;
+				for (const WatchedFile& file : files)
+				{
+					if (file.watch == event->wd && file.name == event->name) add(file.path);
+				}
+			}
+		}
+	}
+#endif
+
+	// Filer som inte har något inotify-id jämförs med sin ändringstid.
+	const auto now = std::chrono::steady_clock::now();
+	if (now - lastPoll < pollInterval) return changed;
+	lastPoll = now;
+	for (WatchedFile& file : files)
+	{
+		if (file.watch >= 0) continue;
+		const std::filesystem::file_time_type time = writeTime(file.path);
+		if (time != file.lastWrite)
+		{
+			file.lastWrite = time;
+			add(file.path);
+		}
+	}
+	return changed;
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+﻿#pragma once
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+/*
+ * Håller koll på om några filer har ändrats. På Linux används inotify på filernas mappar, så att det
+ * märks direkt när en fil har skrivits klart eller ersatts. På andra plattformar jämförs filernas
+ * ändringstid högst en gång per pollInterval. takeChanged() väntar aldrig, så den kan köras varje frame.
+*/
+class FileWatcher
+{
+public:
+	static constexpr std::chrono::milliseconds pollInterval{500};
+private:
+	struct WatchedFile
+	{
+		std::string path;
+		std::filesystem::path directory;
+		std::filesystem::path name;
+		int watch; // inotify-id:t för mappen, eller -1.
+		std::filesystem::file_time_type lastWrite;
+	};
+	std::vector<WatchedFile> files;
+	int inotify; // -1 om inotify inte används.
+	std::chrono::steady_clock::time_point lastPoll;
+
+	// Returnerar filens ändringstid, eller det minsta värdet om den inte finns.
+	static std::filesystem::file_time_type writeTime(const std::string& path) noexcept;
+public:
+	FileWatcher();
+	~FileWatcher();
+
+	// Ingen kopiering.
+	FileWatcher(const FileWatcher&) = delete;
+	// Ingen kopiering.
+	FileWatcher& operator=(const FileWatcher&) = delete;
+
+	// Börjar hålla koll på en fil. Filen behöver inte finnas än, men det måste mappen den ligger i göra på Linux.
+	void watch(const std::string& path);
+	// Returnerar de filer (som de skrevs i watch()) som har ändrats sedan förra gången. Varje fil kommer med bara en gång.
+	std::vector<std::string> takeChanged();
+};
\ No newline at end of file
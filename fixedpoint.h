@@ -0,0 +1,73 @@
+﻿#pragma once
+#include <cstdint>
+#include "geoutils.h"
+
+/*
+ * Ett fixtal med 16 bitar efter binärpunkten, lagrat i ett 64-bitars heltal. Världskoordinater
+ * är i pixlar, så heltalsdelen räcker till långt större världar än vad en double klarar med
+ * samma precision, och all aritmetik är exakt och ger samma resultat på alla plattformar.
+ *
+ * Högerskift av negativa tal antas vara aritmetiska, vilket alla kompilatorer som används gör.
+*/
+class Fixed
+{
+private:
+	int64_t raw;
+
+	struct RawTag {};
+	constexpr Fixed(int64_t raw, RawTag) noexcept
+		: raw(raw) {}
+public:
+	static constexpr int fractionBits = 16;
+	static constexpr int64_t one = int64_t(1) << fractionBits;
+
+	// Skapar noll.
+	constexpr Fixed() noexcept
+		: raw(0) {}
+	// Skapar ett fixtal från ett heltal.
+	constexpr explicit Fixed(int v) noexcept
+		: raw(int64_t(v) * one) {}
+	// Skapar ett fixtal från en double. Avrundar till närmaste representerbara värde.
+	constexpr explicit Fixed(double v) noexcept
+		: raw(static_cast<int64_t>(v * one + (v < 0.0 ? -0.5 : 0.5))) {}
+
+	// Skapar ett fixtal direkt från dess interna representation.
+	static constexpr Fixed fromRaw(int64_t raw) noexcept {return Fixed(raw, RawTag{});}
+	// Returnerar den interna representationen.
+	constexpr int64_t getRaw() const noexcept {return raw;}
+	constexpr double toDouble() const noexcept {return double(raw) / one;}
+
+	// Returnerar floor(this / 2^bits) som ett heltal. Används för att göra om koordinater till tileindex.
+	constexpr int64_t floorShift(int bits) const noexcept {return raw >> (fractionBits + bits);}
+	// Returnerar 2^bits * i.
+	static constexpr Fixed shifted(int64_t i, int bits) noexcept {return fromRaw(i * (one << bits));}
+	// Returnerar det största fixtalet som är mindre än detta.
+	constexpr Fixed below() const noexcept {return fromRaw(raw - 1);}
+
+	constexpr Fixed operator-() const noexcept {return fromRaw(-raw);}
+	constexpr Fixed operator+(Fixed o) const noexcept {return fromRaw(raw + o.raw);}
+	constexpr Fixed operator-(Fixed o) const noexcept {return fromRaw(raw - o.raw);}
+	constexpr Fixed operator*(int i) const noexcept {return fromRaw(raw * i);}
+	Fixed& operator+=(Fixed o) noexcept {raw += o.raw; return *this;}
+	Fixed& operator-=(Fixed o) noexcept {raw -= o.raw; return *this;}
+
+	constexpr bool operator==(Fixed o) const noexcept {return raw == o.raw;}
+	constexpr bool operator!=(Fixed o) const noexcept {return raw != o.raw;}
+	constexpr bool operator<(Fixed o) const noexcept {return raw < o.raw;}
+	constexpr bool operator>(Fixed o) const noexcept {return raw > o.raw;}
+	constexpr bool operator<=(Fixed o) const noexcept {return raw <= o.raw;}
+	constexpr bool operator>=(Fixed o) const noexcept {return raw >= o.raw;}
+};
+
+// En världsposition med fixtal. Motsvarar Point3D.
+struct FixedPoint3D
+{
+	Fixed x;
+	Fixed y;
+	Fixed z;
+
+	static FixedPoint3D fromPoint3D(Point3D p) noexcept {return {Fixed(p.x), Fixed(p.y), Fixed(p.z)};}
+	Point3D toPoint3D() const noexcept {return {x.toDouble(), y.toDouble(), z.toDouble()};}
+	// Projicerar positionen på samma sätt som Point3D::project(). Subtraktionen görs innan omvandlingen till double.
+	Point project() const noexcept {return {x.toDouble(), (z - y).toDouble()};}
+};
\ No newline at end of file
@@ -0,0 +1,105 @@
+﻿#include <algorithm>
+#include <cmath>
+#include <random>
+#include "game.h"
+
+Game::Game(ThreadPool& threadPool, FrameArena& arena, uint32_t seed, unsigned npcCount)
+	: threadPool(threadPool),
+	  arena(arena),
+	  world(seed),
+	  plr({10.0 * tileWidth, 0.0, 10.0 * tileTopHeight}),
+	  ticksSinceSort(0),
+	  zoom(1.0f)
+{
+	/*
+	 * NPC:erna som går omkring. De slumpas från en egen ström så att de inte följer världens höjder.
+	 * Riktningen dras inom enhetscirkeln och normeras med sqrt, som till skillnad från cos och sin
+	 * avrundas likadant överallt.
+	*/
+	std::mt19937 rng(seed + 1);
+	for (unsigned i = 0; i < npcCount; i++)
+	{
+		const unsigned x = rng() % world.getWidth();
+		const unsigned z = rng() % world.getDepth();
+		const EntityID id = npcs.add(
+			FixedPoint3D::fromPoint3D({(x + 0.5) * tileWidth, 0.0, (z + 0.5) * tileTopHeight}),
+			Hitbox{16.0, 16.0, 16.0},
+			Image(ImageID::LOWERCASEMU, 16.0, 16.0)
+		);
+		double dx, dz, lengthSquared;
+		do
+		{
+			dx = rng() / 2147483648.0 - 1.0;
+			dz = rng() / 2147483648.0 - 1.0;
+			lengthSquared = dx * dx + dz * dz;
+		}
+		while (lengthSquared > 1.0 || lengthSquared < 1e-6);
+		const double speed = 2.0 / std::sqrt(lengthSquared);
+		npcs.setVelocity(npcs.indexOf(id), Fixed(dx * speed), Fixed(dz * speed));
+	}
+}
+
+void Game::tick(const KeySnapshot& keys)
+{
+	Direction d = DIR_NONE;
+	if (keys.keyDown('W'))
+	{
+		d = Direction(d | DIR_N);
+	}
+	if (keys.keyDown('A'))
+	{
+		d = Direction(d | DIR_W);
+	}
+	if (keys.keyDown('S'))
+	{
+		d = Direction(d | DIR_S);
+	}
+	if (keys.keyDown('D'))
+	{
+		d = Direction(d | DIR_E);
+	}
+	if (keys.keyDown(KEY_PAGE_UP))
+	{
+		zoom = std::min(zoom * 1.05f, 1.0f);
+	}
+	if (keys.keyDown(KEY_PAGE_DOWN))
+	{
+		zoom = std::max(zoom / 1.05f, 1.0f / 1024.0f);
+	}
+	plr.logic(d, world, keys);
+	if (++ticksSinceSort >= ticksPerSort)
+	{
+		npcs.sortSpatially(arena);
+		ticksSinceSort = 0;
+	}
+	npcs.update(world, threadPool);
+}
+
+Point Game::getCentrePos(double viewWidth, double viewHeight) const
+{
+	// Om världen är mindre än vyn hamnar den i mitten.
+	auto clampCentre = [](double v, double viewSize, double worldSize) -> double {
+		return viewSize >= worldSize ? worldSize / 2.0 : std::clamp(v, viewSize / 2.0, worldSize - viewSize / 2.0);
+	};
+	const Point projectedPlayerPos = plr.pos.project() - Point{0.0, plr.image.getHeight() / 2.0};
+	return {
+		clampCentre(projectedPlayerPos.x, viewWidth, world.getWidth() * tileWidth),
+		clampCentre(projectedPlayerPos.y, viewHeight, world.getDepth() * tileTopHeight)
+	};
+}
+
+Point Game::fillQueue(RenderTarget& target, RenderQueue& queue, bool terrain, bool overlays)
+{
+	const Point centrePos = getCentrePos(target.getEffWidth(), target.getEffHeight());
+	if (terrain)
+	{
+		world.draw(centrePos, target, queue, overlays);
+	}
+	queue.pushSprite(plr.image, plr.pos, plr.getHitbox().depth, centrePos, target);
+	for (std::size_t i = 0; i < npcs.size(); i++)
+	{
+		queue.pushSprite(npcs.getSprite(i), npcs.getPos(i), npcs.getHitbox(i).depth, centrePos, target);
+	}
+	queue.sort();
+	return centrePos;
+}
\ No newline at end of file
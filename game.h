@@ -0,0 +1,59 @@
+﻿#pragma once
+#include "arena.h"
+#include "entities.h"
+#include "geoutils.h"
+#include "input.h"
+#include "player.h"
+#include "rendertarget.h"
+#include "renderqueue.h"
+#include "threadpool.h"
+#include "world.h"
+
+/*
+ * Spelet utan fönster: världen, spelaren och eventuella NPC:er. Det beror inte på någon plattform, så samma
+ * simulering och rendering körs i fönstret (main.cpp) och i tools/headless.cpp.
+*/
+class Game
+{
+public:
+	// Så många ticks mellan varje gång NPC:erna sorteras efter var de är.
+	static constexpr unsigned ticksPerSort = 30;
+private:
+	ThreadPool& threadPool;
+	FrameArena& arena;
+	World world;
+	Player plr;
+	Entities npcs;
+	unsigned ticksSinceSort;
+	float zoom;
+public:
+	/*
+	 * Världen och npcCount NPC:er som går omkring slumpas från seed, så samma seed ger samma spel på alla
+	 * plattformar. Spelet har bara spelaren; NPC:erna används av tools/headless.cpp för att mäta och
+	 * jämföra renderingen med många sprites. Tillfälliga buffertar under ett tick tas från arena, som ska
+	 * vara plattformens FrameArena.
+	*/
+	Game(ThreadPool& threadPool, FrameArena& arena, uint32_t seed, unsigned npcCount = 0);
+
+	// Ingen kopiering.
+	Game(const Game&) = delete;
+	// Ingen kopiering.
+	Game& operator=(const Game&) = delete;
+
+	// Kör ett tick. WASD flyttar spelaren, mellanslag hoppar och page up och page down zoomar.
+	void tick(const KeySnapshot& keys);
+
+	// Returnerar den projicerade punkt som ska vara i mitten av en vy med storleken (viewWidth, viewHeight).
+	Point getCentrePos(double viewWidth, double viewHeight) const;
+	/*
+	 * Lägger allt som syns på target i kön och sorterar den. Om terrain är false läggs bara sprites i kön
+	 * och om overlays är false läggs tiles i kön utan kanter och hörn. Returnerar mitten av vyn.
+	*/
+	Point fillQueue(RenderTarget& target, RenderQueue& queue, bool terrain = true, bool overlays = true);
+
+	World& getWorld() noexcept {return world;}
+	const Player& getPlayer() const noexcept {return plr;}
+	const Entities& getNpcs() const noexcept {return npcs;}
+	// Returnerar zoomen. 1 är den vanliga storleken.
+	float getZoom() const noexcept {return zoom;}
+};
\ No newline at end of file
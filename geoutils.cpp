@@ -1,30 +1,5 @@
 ﻿#include "geoutils.h"
 
-Point operator+(const Point& a, const Point& b)
-{
-	return {a.x + b.x, a.y + b.y};
-}
-
-Point operator-(const Point& a, const Point& b)
-{
-	return {a.x - b.x, a.y - b.y};
-}
-
-Point operator*(const Point& p, double x)
-{
-	return {p.x * x, p.y * x};
-}
-
-Point operator*(double x, const Point& p)
-{
-	return {p.x * x, p.y * x};
-}
-
-Point Point3D::project() const noexcept
-{
-	return {x, z - y};
-}
-
 double angleAround(Point p, Point centre)
 {
 	return atan2(p.y - centre.y, p.x - centre.x);
@@ -35,17 +10,40 @@ Point moveAngle(Point p, double angle, double distance)
 	return {p.x + cos(angle) * distance, p.y + sin(angle) * distance};
 }
 
-Point rotateAround(Point p, Point centre, double angle)
+void rotateAround(const double* xs, const double* ys, double* outXs, double* outYs, std::size_t count, Point centre, double angle) noexcept
 {
-	return moveAngle(centre, angleAround(p, centre) + angle, distance(p, centre));
+	const double c = cos(angle);
+	const double s = sin(angle);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		const double dx = xs[i] - centre.x;
+		const double dy = ys[i] - centre.y;
+		outXs[i] = centre.x + dx * c - dy * s;
+		outYs[i] = centre.y + dx * s + dy * c;
+	}
 }
 
-double distance(Point a, Point b)
+void moveTowards(const double* xs, const double* ys, double* outXs, double* outYs, std::size_t count, Point dest, double distance) noexcept
 {
-	return hypot(a.x - b.x, a.y - b.y);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		const double dx = dest.x - xs[i];
+		const double dy = dest.y - ys[i];
+		const double length = sqrt(dx * dx + dy * dy);
+		// Samma specialfall som i den skalära versionen, men utan förgrening. Om punkterna är samma är dx och dy 0.
+		const bool same = length == 0.0;
+		const double scale = distance / (same ? 1.0 : length);
+		outXs[i] = xs[i] + dx * scale + (same ? distance : 0.0);
+		outYs[i] = ys[i] + dy * scale;
+	}
 }
 
-Point moveTowards(Point p, Point dest, double distance)
+void distance(const double* xs, const double* ys, double* out, std::size_t count, Point p) noexcept
 {
-	return moveAngle(p, angleAround(dest, p), distance);
+	for (std::size_t i = 0; i < count; i++)
+	{
+		const double dx = xs[i] - p.x;
+		const double dy = ys[i] - p.y;
+		out[i] = sqrt(dx * dx + dy * dy);
+	}
 }
\ No newline at end of file
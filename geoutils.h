@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include <cmath>
+#include <cstddef>
 
 const double invSqrt2 = 1.0 / sqrt(2.0);
 const double pi = acos(-1.0);
@@ -10,10 +11,10 @@ struct Point
 	double y;
 };
 
-Point operator+(const Point& a, const Point& b);
-Point operator-(const Point& a, const Point& b);
-Point operator*(const Point& p, double x);
-Point operator*(double x, const Point& p);
+constexpr Point operator+(const Point& a, const Point& b) noexcept {return {a.x + b.x, a.y + b.y};}
+constexpr Point operator-(const Point& a, const Point& b) noexcept {return {a.x - b.x, a.y - b.y};}
+constexpr Point operator*(const Point& p, double x) noexcept {return {p.x * x, p.y * x};}
+constexpr Point operator*(double x, const Point& p) noexcept {return {p.x * x, p.y * x};}
 
 struct Point3D
 {
@@ -21,7 +22,7 @@ struct Point3D
 	double y;
 	double z;
 
-	Point project() const noexcept;
+	constexpr Point project() const noexcept {return {x, z - y};}
 };
 
 enum Direction
@@ -39,6 +40,40 @@ enum Direction
 
 double angleAround(Point p, Point centre);
 Point moveAngle(Point p, double angle, double distance);
-Point rotateAround(Point p, Point centre, double angle);
-double distance(Point a, Point b);
-Point moveTowards(Point p, Point dest, double distance);
\ No newline at end of file
+
+inline double distance(Point a, Point b)
+{
+	const Point d = a - b;
+	return std::sqrt(d.x * d.x + d.y * d.y);
+}
+
+// Roterar p angle radianer runt centre. Vinkeln och avståndet behöver inte räknas ut.
+inline Point rotateAround(Point p, Point centre, double angle)
+{
+	const double c = std::cos(angle);
+	const double s = std::sin(angle);
+	const Point d = p - centre;
+	return {centre.x + d.x * c - d.y * s, centre.y + d.x * s + d.y * c};
+}
+
+// Flyttar p distance mot dest. Om p och dest är samma punkt flyttas p i positiv x-led, som atan2(0, 0) = 0 ger.
+inline Point moveTowards(Point p, Point dest, double distance)
+{
+	const Point d = dest - p;
+	const double length = std::sqrt(d.x * d.x + d.y * d.y);
+	if (length == 0.0) return {p.x + distance, p.y};
+	return p + d * (distance / length);
+}
+
+/*
+ * Versioner av funktionerna ovan för många punkter i taget, med x och y i separata arrayer.
+ * Resultatet får skrivas till samma arrayer som indata. Looparna har inga förgreningar,
+ * så kompilatorn kan vektorisera dem.
+*/
+
+// Roterar count punkter angle radianer runt centre.
+void rotateAround(const double* xs, const double* ys, double* outXs, double* outYs, std::size_t count, Point centre, double angle) noexcept;
+// Flyttar count punkter distance mot dest.
+void moveTowards(const double* xs, const double* ys, double* outXs, double* outYs, std::size_t count, Point dest, double distance) noexcept;
+// Räknar ut avståndet från count punkter till p.
+void distance(const double* xs, const double* ys, double* out, std::size_t count, Point p) noexcept;
\ No newline at end of file
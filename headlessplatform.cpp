@@ -0,0 +1,23 @@
+﻿#include <stdexcept>
+#include "headlessplatform.h"
+
+HeadlessPlatform::HeadlessPlatform(unsigned width, unsigned height)
+	: target(width, height),
+	  running(true),
+	  frameCount(0) {}
+
+RenderTarget& HeadlessPlatform::beginFrame()
+{
+	frameArena.reset();
+	target.setScale(1.0f);
+	target.clear();
+	return target;
+}
+
+void HeadlessPlatform::postKey(unsigned char key, bool down)
+{
+	if (!inputEvents.push({down ? InputEvent::KEY_DOWN : InputEvent::KEY_UP, InputClock::now(), key, L'\0', 0, 0}))
+	{
+		throw std::runtime_error("Input queue is full.");
+	}
+}
\ No newline at end of file
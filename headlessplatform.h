@@ -0,0 +1,46 @@
+﻿#pragma once
+#include "platform.h"
+#include "softwaretarget.h"
+
+/*
+ * En plattform utan fönster, som ritar med en SoftwareTarget. Input kommer bara från postKey(), så
+ * den kan styras av ett skript. Används för att köra och mäta spelet på datorer utan Windows.
+*/
+class HeadlessPlatform : public Platform
+{
+private:
+	SoftwareTarget target;
+	InputQueue inputEvents;
+	FrameArena frameArena;
+	bool running;
+	unsigned frameCount;
+public:
+	// Laddar bilderna. Kastar std::runtime_error om det inte går.
+	HeadlessPlatform(unsigned width, unsigned height);
+
+	// Ingen kopiering.
+	HeadlessPlatform(const HeadlessPlatform&) = delete;
+	// Ingen kopiering.
+	HeadlessPlatform& operator=(const HeadlessPlatform&) = delete;
+
+	bool update() override {return running;}
+	InputQueue& getInputQueue() noexcept override {return inputEvents;}
+	FrameArena& getFrameArena() noexcept override {return frameArena;}
+
+	RenderTarget& beginFrame() override;
+	void endFrame() override {frameCount++;}
+
+	void reloadImage(ImageID imageID, const PixelImage& image) override {target.setImage(imageID, image);}
+
+	int getWidth() const noexcept override {return target.getFrame().width;}
+	int getHeight() const noexcept override {return target.getFrame().height;}
+
+	// Lägger en tangenttryckning eller ett släpp i kön, som om användaren hade gjort det.
+	void postKey(unsigned char key, bool down);
+	// Gör så att update() returnerar false.
+	void quit() noexcept {running = false;}
+
+	// Returnerar den senaste framen.
+	const PixelImage& getFrame() const noexcept {return target.getFrame();}
+	unsigned getFrameCount() const noexcept {return frameCount;}
+};
\ No newline at end of file
@@ -0,0 +1,181 @@
+﻿#include <algorithm>
+#include <limits>
+#include "heightpyramid.h"
+
+namespace
+{
+	// Klipper [tMin, tMax] till det intervall där o + t * d ligger i [lo, hi]. Returnerar false om intervallet blir tomt.
+	bool clipSlab(double o, double d, double lo, double hi, double& tMin, double& tMax) noexcept
+	{
+		if (d == 0.0) return o >= lo && o < hi;
+		double t0 = (lo - o) / d;
+		double t1 = (hi - o) / d;
+		if (t0 > t1) std::swap(t0, t1);
+		if (t0 > tMin) tMin = t0;
+		if (t1 < tMax) tMax = t1;
+		return tMin <= tMax;
+	}
+}
+
+HeightPyramid::HeightPyramid(const Matrix<uint16_t>& heights)
+	: heights(&heights) {}
+
+void HeightPyramid::updateCell(unsigned level, unsigned x, unsigned z) noexcept
+{
+	const unsigned childWidth = getLevelWidth(level - 1);
+	const unsigned childDepth = getLevelDepth(level - 1);
+	MinMax mm = {std::numeric_limits<uint16_t>::max(), 0};
+	for (unsigned cx = x * 2; cx < x * 2 + 2 && cx < childWidth; cx++)
+	{
+		for (unsigned cz = z * 2; cz < z * 2 + 2 && cz < childDepth; cz++)
+		{
+			const MinMax child = cellAt(level - 1, cx, cz);
+			if (child.min < mm.min) mm.min = child.min;
+			if (child.max > mm.max) mm.max = child.max;
+		}
+	}
+	levels[level - 1][x][z] = mm;
+}
+
+void HeightPyramid::rebuild() noexcept
+{
+	levels.clear();
+	unsigned width = heights->getWidth();
+	unsigned depth = heights->getHeight();
+	if (width == 0 || depth == 0) return;
+	while (width > 1 || depth > 1)
+	{
+		width = (width + 1) / 2;
+		depth = (depth + 1) / 2;
+		levels.emplace_back(width, depth);
+	}
+	for (unsigned level = 1; level < getLevelCount(); level++)
+	{
+		for (unsigned x = 0; x < getLevelWidth(level); x++)
+		{
+			for (unsigned z = 0; z < getLevelDepth(level); z++)
+			{
+				updateCell(level, x, z);
+			}
+		}
+	}
+}
+
+void HeightPyramid::update(int startX, int startZ, int endX, int endZ) noexcept
+{
+	startX = std::max(startX, 0);
+	startZ = std::max(startZ, 0);
+	endX = std::min(endX, static_cast<int>(heights->getWidth()));
+	endZ = std::min(endZ, static_cast<int>(heights->getHeight()));
+	if (startX >= endX || startZ >= endZ) return;
+	for (unsigned level = 1; level < getLevelCount(); level++)
+	{
+		for (unsigned x = startX >> level; x <= unsigned(endX - 1) >> level; x++)
+		{
+			for (unsigned z = startZ >> level; z <= unsigned(endZ - 1) >> level; z++)
+			{
+				updateCell(level, x, z);
+			}
+		}
+	}
+}
+
+void HeightPyramid::queryCell(unsigned level, unsigned x, unsigned z, int startX, int startZ, int endX, int endZ, MinMax& result) const noexcept
+{
+	const int cellStartX = x << level;
+	const int cellStartZ = z << level;
+	const int cellEndX = std::min<int>((x + 1) << level, heights->getWidth());
+	const int cellEndZ = std::min<int>((z + 1) << level, heights->getHeight());
+	if (cellEndX <= startX || cellStartX >= endX || cellEndZ <= startZ || cellStartZ >= endZ) return;
+	if (cellStartX >= startX && cellEndX <= endX && cellStartZ >= startZ && cellEndZ <= endZ)
+	{
+		const MinMax mm = cellAt(level, x, z);
+		if (mm.min < result.min) result.min = mm.min;
+		if (mm.max > result.max) result.max = mm.max;
+		return;
+	}
+	// Cellen är bara delvis inuti rektangeln, så barnen måste undersökas.
+	for (unsigned cx = x * 2; cx < x * 2 + 2 && cx < getLevelWidth(level - 1); cx++)
+	{
+		for (unsigned cz = z * 2; cz < z * 2 + 2 && cz < getLevelDepth(level - 1); cz++)
+		{
+			queryCell(level - 1, cx, cz, startX, startZ, endX, endZ, result);
+		}
+	}
+}
+
+HeightPyramid::MinMax HeightPyramid::minMax(int startX, int startZ, int endX, int endZ) const noexcept
+{
+	MinMax result = {std::numeric_limits<uint16_t>::max(), 0};
+	startX = std::max(startX, 0);
+	startZ = std::max(startZ, 0);
+	endX = std::min(endX, static_cast<int>(heights->getWidth()));
+	endZ = std::min(endZ, static_cast<int>(heights->getHeight()));
+	if (startX >= endX || startZ >= endZ) return result;
+	queryCell(getLevelCount() - 1, 0, 0, startX, startZ, endX, endZ, result);
+	return result;
+}
+
+bool HeightPyramid::raycastCell(unsigned level, unsigned x, unsigned z, const double (&origin)[3], const double (&dir)[3], double tMin, double tMax, RayHit& result) const noexcept
+{
+	const double cellStartX = x << level;
+	const double cellStartZ = z << level;
+	const double cellEndX = std::min<unsigned>((x + 1) << level, heights->getWidth());
+	const double cellEndZ = std::min<unsigned>((z + 1) << level, heights->getHeight());
+	if (!clipSlab(origin[0], dir[0], cellStartX, cellEndX, tMin, tMax)) return false;
+	if (!clipSlab(origin[2], dir[2], cellStartZ, cellEndZ, tMin, tMax)) return false;
+
+	// Strålen är linjär, så dess lägsta höjd i cellen är vid en av ändpunkterna.
+	const double yStart = origin[1] + dir[1] * tMin;
+	const double yEnd = origin[1] + dir[1] * tMax;
+	const MinMax mm = cellAt(level, x, z);
+	if (std::min(yStart, yEnd) > mm.max) return false;
+
+	if (level == 0)
+	{
+		result.hit = true;
+		result.x = x;
+		result.z = z;
+		result.t = yStart <= mm.max ? tMin : (mm.max - origin[1]) / dir[1];
+		return true;
+	}
+
+	// Barnen undersöks i den ordning strålen går in i dem, så den första träffen är den närmaste.
+	struct Child
+	{
+		unsigned x;
+		unsigned z;
+		double entry;
+	} children[4];
+	unsigned childCount = 0;
+	for (unsigned cx = x * 2; cx < x * 2 + 2 && cx < getLevelWidth(level - 1); cx++)
+	{
+		for (unsigned cz = z * 2; cz < z * 2 + 2 && cz < getLevelDepth(level - 1); cz++)
+		{
+			double entry = tMin;
+			double exit = tMax;
+			if (clipSlab(origin[0], dir[0], double(cx << (level - 1)), double((cx + 1) << (level - 1)), entry, exit) &&
+				clipSlab(origin[2], dir[2], double(cz << (level - 1)), double((cz + 1) << (level - 1)), entry, exit))
+			{
+				unsigned i = childCount++;
+				for (; i > 0 && children[i - 1].entry > entry; i--) children[i] = children[i - 1];
+				children[i] = {cx, cz, entry};
+			}
+		}
+	}
+	for (unsigned i = 0; i < childCount; i++)
+	{
+		if (raycastCell(level - 1, children[i].x, children[i].z, origin, dir, tMin, tMax, result)) return true;
+	}
+	return false;
+}
+
+HeightPyramid::RayHit HeightPyramid::raycast(double originX, double originY, double originZ, double dirX, double dirY, double dirZ, double maxT) const noexcept
+{
+	RayHit result = {false, 0, 0, 0.0};
+	if (levels.empty() && (heights->getWidth() == 0 || heights->getHeight() == 0)) return result;
+	const double origin[3] = {originX, originY, originZ};
+	const double dir[3] = {dirX, dirY, dirZ};
+	raycastCell(getLevelCount() - 1, 0, 0, origin, dir, 0.0, maxT, result);
+	return result;
+}
\ No newline at end of file
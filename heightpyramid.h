@@ -0,0 +1,86 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+#include "matrix.h"
+
+/*
+ * En min/max-pyramid över en höjdmatris. Nivå 0 är själva höjdmatrisen och varje cell på nivå n
+ * täcker 2^n * 2^n tiles. Den översta nivån har en enda cell som täcker hela matrisen.
+ *
+ * Alla rektanglar är halvöppna, [startX, endX) * [startZ, endZ), i tilekoordinater och klipps mot
+ * matrisen. Pyramiden läser höjdmatrisen direkt, så den måste leva kortare än matrisen och
+ * update() måste köras när matrisen ändras.
+*/
+class HeightPyramid
+{
+public:
+	struct MinMax
+	{
+		uint16_t min;
+		uint16_t max;
+	};
+	struct RayHit
+	{
+		bool hit;
+		int x;
+		int z;
+		double t;
+	};
+private:
+	const Matrix<uint16_t>* heights;
+	std::vector<Matrix<MinMax>> levels; // levels[0] är nivå 1, eftersom nivå 0 är höjdmatrisen.
+
+	void updateCell(unsigned level, unsigned x, unsigned z) noexcept;
+	void queryCell(unsigned level, unsigned x, unsigned z, int startX, int startZ, int endX, int endZ, MinMax& result) const noexcept;
+	bool raycastCell(unsigned level, unsigned x, unsigned z, const double (&origin)[3], const double (&dir)[3], double tMin, double tMax, RayHit& result) const noexcept;
+public:
+	// Skapar en pyramid över heights. rebuild() måste köras innan pyramiden används.
+	explicit HeightPyramid(const Matrix<uint16_t>& heights);
+
+	// Ingen kopiering, eftersom pyramiden pekar på en specifik höjdmatris.
+	HeightPyramid(const HeightPyramid&) = delete;
+	// Ingen kopiering.
+	HeightPyramid& operator=(const HeightPyramid&) = delete;
+
+	// Räknar om hela pyramiden.
+	void rebuild() noexcept;
+	// Räknar om de delar av pyramiden som påverkas av rektangeln. Tar tid proportionellt mot rektangelns area.
+	void update(int startX, int startZ, int endX, int endZ) noexcept;
+
+	// Returnerar antalet nivåer, inklusive nivå 0.
+	unsigned getLevelCount() const noexcept {return levels.size() + 1;}
+	// Returnerar bredden (i celler) på en nivå.
+	unsigned getLevelWidth(unsigned level) const noexcept {return level == 0 ? heights->getWidth() : levels[level - 1].getWidth();}
+	// Returnerar djupet (i celler) på en nivå.
+	unsigned getLevelDepth(unsigned level) const noexcept {return level == 0 ? heights->getHeight() : levels[level - 1].getHeight();}
+	// Returnerar min och max för en cell. Ingen gränskontroll.
+	MinMax cellAt(unsigned level, unsigned x, unsigned z) const noexcept
+	{
+		if (level == 0)
+		{
+			const uint16_t h = (*heights)[x][z];
+			return {h, h};
+		}
+		return levels[level - 1][x][z];
+	}
+
+	// Returnerar min och max i rektangeln. En tom rektangel ger {65535, 0}.
+	MinMax minMax(int startX, int startZ, int endX, int endZ) const noexcept;
+	// Returnerar den högsta höjden i rektangeln, eller 0 om rektangeln är tom.
+	uint16_t maxHeight(int startX, int startZ, int endX, int endZ) const noexcept {return minMax(startX, startZ, endX, endZ).max;}
+	// Returnerar den lägsta höjden i rektangeln, eller 65535 om rektangeln är tom.
+	uint16_t minHeight(int startX, int startZ, int endX, int endZ) const noexcept {return minMax(startX, startZ, endX, endZ).min;}
+	// Returnerar true om alla tiles i rektangeln har samma höjd.
+	bool isFlat(int startX, int startZ, int endX, int endZ) const noexcept
+	{
+		const MinMax mm = minMax(startX, startZ, endX, endZ);
+		return mm.min >= mm.max;
+	}
+
+	/*
+	 * Skjuter en stråle origin + t * dir, där x och z är i tiles och y är i höjdenheter, och returnerar
+	 * den första tile vars kolumn strålen går in i för t i [0, maxT]. Celler som ligger helt under
+	 * strålen hoppas över, så strålar ovanför terrängen tar ungefär O(log n) tid.
+	*/
+	RayHit raycast(double originX, double originY, double originZ, double dirX, double dirY, double dirZ, double maxT) const noexcept;
+};
\ No newline at end of file
@@ -0,0 +1,155 @@
+﻿#include <algorithm>
+#include <cstdlib>
+#include "heightqueries.h"
+
+TileRect clipToHeights(const Matrix<uint16_t>& heights, TileRect area) noexcept
+{
+	TileRect clipped = {
+		std::max(area.startX, 0),
+		std::max(area.startZ, 0),
+		std::min(area.endX, static_cast<int>(heights.getWidth())),
+		std::min(area.endZ, static_cast<int>(heights.getHeight()))
+	};
+	if (clipped.startX >= clipped.endX || clipped.startZ >= clipped.endZ) return {0, 0, 0, 0};
+	return clipped;
+}
+
+TileRect copyHeights(const Matrix<uint16_t>& heights, TileRect area, uint16_t* out, uint16_t outside) noexcept
+{
+	if (area.startX >= area.endX || area.startZ >= area.endZ) return {0, 0, 0, 0};
+	const TileRect clipped = clipToHeights(heights, area);
+	const std::size_t depth = area.endZ - area.startZ;
+	for (int x = area.startX; x < area.endX; x++)
+	{
+		uint16_t* column = out + (x - area.startX) * depth;
+		if (x < clipped.startX || x >= clipped.endX)
+		{
+			std::fill(column, column + depth, outside);
+			continue;
+		}
+		// Kolumnerna ligger tätt i matrisen, så varje kolumn är en enda kopiering.
+		uint16_t* inside = column + (clipped.startZ - area.startZ);
+		std::fill(column, inside, outside);
+		inside = std::copy(heights[x] + clipped.startZ, heights[x] + clipped.endZ, inside);
+		std::fill(inside, column + depth, outside);
+	}
+	return clipped;
+}
+
+HeightPyramid::MinMax heightRange(const Matrix<uint16_t>& heights, TileRect area) noexcept
+{
+	const TileRect clipped = clipToHeights(heights, area);
+	uint16_t low = 0xffff;
+	uint16_t high = 0;
+	for (int x = clipped.startX; x < clipped.endX; x++)
+	{
+		const uint16_t* column = heights[x];
+		for (int z = clipped.startZ; z < clipped.endZ; z++)
+		{
+			low = std::min(low, column[z]);
+			high = std::max(high, column[z]);
+		}
+	}
+	return {low, high};
+}
+
+unsigned char walkableNeighbours(const Matrix<uint16_t>& heights, int x, int z) noexcept
+{
+	const int width = heights.getWidth();
+	const int depth = heights.getHeight();
+	if (x < 0 || z < 0 || x >= width || z >= depth) return 0;
+	const uint16_t h = heights[x][z];
+	auto step = [&](int nx, int nz) -> bool {
+		return nx >= 0 && nz >= 0 && nx < width && nz < depth && canStep(h, heights[nx][nz]);
+	};
+	const bool n = step(x, z - 1);
+	const bool s = step(x, z + 1);
+	const bool e = step(x + 1, z);
+	const bool w = step(x - 1, z);
+	unsigned char mask = 0;
+	if (n) mask |= NEIGHBOUR_N;
+	if (s) mask |= NEIGHBOUR_S;
+	if (e) mask |= NEIGHBOUR_E;
+	if (w) mask |= NEIGHBOUR_W;
+	if (n && e && step(x + 1, z - 1)) mask |= NEIGHBOUR_NE;
+	if (n && w && step(x - 1, z - 1)) mask |= NEIGHBOUR_NW;
+	if (s && e && step(x + 1, z + 1)) mask |= NEIGHBOUR_SE;
+	if (s && w && step(x - 1, z + 1)) mask |= NEIGHBOUR_SW;
+	return mask;
+}
+
+void walkableNeighbours(const Matrix<uint16_t>& heights, TileRect area, unsigned char* out) noexcept
+{
+	if (area.startX >= area.endX || area.startZ >= area.endZ) return;
+	const std::size_t depth = area.endZ - area.startZ;
+	std::fill(out, out + (area.endX - area.startX) * depth, 0);
+	const TileRect clipped = clipToHeights(heights, area);
+	const int lastX = heights.getWidth() - 1;
+	const int lastZ = heights.getHeight() - 1;
+	for (int x = clipped.startX; x < clipped.endX; x++)
+	{
+		unsigned char* column = out + (x - area.startX) * depth - area.startZ;
+		if (x == 0 || x == lastX)
+		{
+			for (int z = clipped.startZ; z < clipped.endZ; z++) column[z] = walkableNeighbours(heights, x, z);
+			continue;
+		}
+		// Tiles vid världens kanter kollas en och en, så att loopen i mitten inte behöver några gränskontroller.
+		const int innerStart = std::max(clipped.startZ, 1);
+		const int innerEnd = std::max(std::min(clipped.endZ, lastZ), innerStart);
+		for (int z = clipped.startZ; z < innerStart; z++) column[z] = walkableNeighbours(heights, x, z);
+		for (int z = innerEnd; z < clipped.endZ; z++) column[z] = walkableNeighbours(heights, x, z);
+
+		const uint16_t* west = heights[x - 1];
+		const uint16_t* centre = heights[x];
+		const uint16_t* east = heights[x + 1];
+		for (int z = innerStart; z < innerEnd; z++)
+		{
+			const uint16_t h = centre[z];
+			const unsigned n = centre[z - 1] <= h;
+			const unsigned s = centre[z + 1] <= h;
+			const unsigned e = east[z] <= h;
+			const unsigned w = west[z] <= h;
+			const unsigned ne = n & e & (east[z - 1] <= h);
+			const unsigned nw = n & w & (west[z - 1] <= h);
+			const unsigned se = s & e & (east[z + 1] <= h);
+			const unsigned sw = s & w & (west[z + 1] <= h);
+			column[z] = static_cast<unsigned char>(
+				n * NEIGHBOUR_N | s * NEIGHBOUR_S | e * NEIGHBOUR_E | w * NEIGHBOUR_W |
+				ne * NEIGHBOUR_NE | nw * NEIGHBOUR_NW | se * NEIGHBOUR_SE | sw * NEIGHBOUR_SW
+			);
+		}
+	}
+}
+
+std::size_t sampleLine(const Matrix<uint16_t>& heights, int startX, int startZ, int endX, int endZ, uint16_t* out, std::size_t maxCount, uint16_t outside) noexcept
+{
+	const int dx = std::abs(endX - startX);
+	const int dz = std::abs(endZ - startZ);
+	const int stepX = startX < endX ? 1 : -1;
+	const int stepZ = startZ < endZ ? 1 : -1;
+	const std::size_t count = std::max(dx, dz) + 1;
+	const std::size_t written = std::min(count, maxCount);
+	const unsigned width = heights.getWidth();
+	const unsigned depth = heights.getHeight();
+
+	int x = startX;
+	int z = startZ;
+	int error = dx - dz;
+	for (std::size_t i = 0; i < written; i++)
+	{
+		out[i] = unsigned(x) < width && unsigned(z) < depth ? heights[x][z] : outside;
+		const int error2 = error * 2;
+		if (error2 > -dz)
+		{
+			error -= dz;
+			x += stepX;
+		}
+		if (error2 < dx)
+		{
+			error += dx;
+			z += stepZ;
+		}
+	}
+	return count;
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include "heightpyramid.h"
+#include "matrix.h"
+#include "world.h"
+
+/*
+ * Frågor om många tiles i taget, för AI och spellogik som annars skulle anropa World::tileAt() för varje
+ * tile. Funktionerna tar en höjdmatris, så de fungerar både på World::getHeights() och på en kopia som
+ * en annan tråd läser. Allt klipps mot matrisen och inget kastar. Looparna går längs z, som ligger
+ * tätt i matrisen, och har inga förgreningar, så kompilatorn kan vektorisera dem.
+*/
+
+// Klipper en rektangel mot matrisen. En rektangel som är helt utanför blir tom.
+TileRect clipToHeights(const Matrix<uint16_t>& heights, TileRect area) noexcept;
+
+/*
+ * Kopierar höjderna i area till out, som måste ha plats för en höjd per tile i area. Tilen (x, z) hamnar i
+ * out[(x - area.startX) * (area.endZ - area.startZ) + (z - area.startZ)], alltså samma ordning som i
+ * matrisen. Tiles utanför världen får höjden outside. Returnerar den del av area som låg i världen.
+*/
+TileRect copyHeights(const Matrix<uint16_t>& heights, TileRect area, uint16_t* out, uint16_t outside = 0) noexcept;
+
+/*
+ * Returnerar min och max i area. En tom rektangel ger {65535, 0}. Tar tid proportionellt mot arean, så
+ * för världen själv är World::getPyramid().minMax() snabbare för stora rektanglar.
+*/
+HeightPyramid::MinMax heightRange(const Matrix<uint16_t>& heights, TileRect area) noexcept;
+
+/*
+ * Regeln för att gå från en tile till en granne, samma som i kollisionskoden: en sida kolliderar om
+ * tilen är högre än man står, så man kan gå till tiles som är lika höga eller lägre men aldrig uppåt.
+ * Ett diagonalt steg går över båda tilesen bredvid, så de måste också gå att gå till.
+*/
+constexpr bool canStep(uint16_t from, uint16_t to) noexcept {return to <= from;}
+
+// Returnerar en mask med NeighbourBit för de grannar som går att gå till från (x, z). 0 om (x, z) är utanför världen.
+unsigned char walkableNeighbours(const Matrix<uint16_t>& heights, int x, int z) noexcept;
+// Skriver masken från walkableNeighbours() för varje tile i area till out, i samma ordning som copyHeights(). Tiles utanför världen får 0.
+void walkableNeighbours(const Matrix<uint16_t>& heights, TileRect area, unsigned char* out) noexcept;
+
+/*
+ * Går längs linjen från (startX, startZ) till (endX, endZ) med Bresenhams algoritm och skriver höjden för
+ * varje tile till out, högst maxCount stycken. Tiles utanför världen får höjden outside. Returnerar antalet
+ * tiles på linjen, max(|endX - startX|, |endZ - startZ|) + 1, även om det är fler än maxCount.
+*/
+std::size_t sampleLine(const Matrix<uint16_t>& heights, int startX, int startZ, int endX, int endZ, uint16_t* out, std::size_t maxCount, uint16_t outside = 0) noexcept;
\ No newline at end of file
@@ -1,151 +1,76 @@
 ﻿#include "hitbox.h"
 
-Hitbox::CollisionData Hitbox::collidingNorth(Point3D pos, World& w)
+template <typename P>
+Hitbox::BasicCollisionData<CoordinateOf<P>> Hitbox::collidingBottom(P pos, const World& w) const noexcept
 {
-	CollisionData currCollision = {CollisionType::None, 0.0};
-	const int startX = floor((pos.x - width / 2.0) / tileWidth);
-	const int stopX = floor((pos.x + width / 2.0) / tileWidth);
-	const int z = floor((pos.z - depth / 2.0) / tileTopHeight);
-	for (int i = startX; i <= stopX; i++)
-	{
-		try
-		{
-			const double snapHeight = w.tileAt(i, z).height * tileHeight;
-			const double heightDiff = snapHeight - pos.y;
-			if (heightDiff > /* tileHeight */ 0.0)
-			{
-				currCollision.collisionType = CollisionType::Colliding;
-			}
-			// else if (heightDiff > 0.0 && currCollision.collisionType != CollisionType::Colliding)
-			// {
-			// 	currCollision.collisionType = CollisionType::SnapUp;
-			// 	if (snapHeight > currCollision.snapHeight)
-			// 	{
-			// 		currCollision.snapHeight = snapHeight;
-			// 	}
-			// }
-		}
-		catch (...) {}
-	}
-	return currCollision;
+	typedef CoordinateOf<P> T;
+	typedef CoordinateTraits<T> Traits;
+	const T halfWidth = Traits::fromSize(width / 2.0);
+	const T halfDepth = Traits::fromSize(depth / 2.0);
+	const int startX = Traits::template tileIndex<AXIS_X>(pos.x - halfWidth);
+	const int stopX = Traits::template tileIndex<AXIS_X>(pos.x + halfWidth);
+	const int startZ = Traits::template tileIndex<AXIS_Z>(pos.z - halfDepth);
+	const int stopZ = Traits::template tileIndex<AXIS_Z>(pos.z + halfDepth);
+	if (stopX < 0 || stopZ < 0 || startX >= static_cast<int>(w.getWidth()) || startZ >= static_cast<int>(w.getDepth()))
+		return {CollisionType::None, T()};
+	// Pyramiden klipper mot världen, så tiles utanför världen räknas inte.
+	const T snapHeight = Traits::surface(w.getPyramid().maxHeight(startX, startZ, stopX + 1, stopZ + 1));
+	if (snapHeight > pos.y)
+		return {CollisionType::SnapUp, snapHeight};
+	else
+		return {CollisionType::None, T()};
 }
 
-Hitbox::CollisionData Hitbox::collidingWest(Point3D pos, World& w)
+template <typename P>
+Hitbox::BasicProbe<CoordinateOf<P>> Hitbox::probeAll(P pos, const World& w, CoordinateOf<P> dx) const noexcept
 {
-	CollisionData currCollision = {CollisionType::None, 0.0};
-	const int x = floor((pos.x - width / 2.0) / tileWidth);
-	const int startZ = floor((pos.z - depth / 2.0) / tileTopHeight);
-	const int stopZ = floor((pos.z + depth / 2.0) / tileTopHeight);
-	for (int i = startZ; i <= stopZ; i++)
-	{
-		try
-		{
-			const double snapHeight = w.tileAt(x, i).height * tileHeight;
-			const double heightDiff = snapHeight - pos.y;
-			if (heightDiff > /* tileHeight */ 0.0)
-			{
-				currCollision.collisionType = CollisionType::Colliding;
-			}
-			// else if (heightDiff > 0.0 && currCollision.collisionType != CollisionType::Colliding)
-			// {
-			// 	currCollision.collisionType = CollisionType::SnapUp;
-			// 	if (snapHeight > currCollision.snapHeight)
-			// 	{
-			// 		currCollision.snapHeight = snapHeight;
-			// 	}
-			// }
-		}
-		catch (...) {}
-	}
-	return currCollision;
-}
+	typedef CoordinateOf<P> T;
+	typedef CoordinateTraits<T> Traits;
+	const T halfWidth = Traits::fromSize(width / 2.0);
+	const T halfDepth = Traits::fromSize(depth / 2.0);
+	const int startX = Traits::template tileIndex<AXIS_X>(pos.x - halfWidth);
+	const int stopX = Traits::template tileIndex<AXIS_X>(pos.x + halfWidth);
+	const int westX = Traits::template tileIndex<AXIS_X>(pos.x + dx - halfWidth);
+	const int eastX = Traits::template tileIndex<AXIS_X>(pos.x + dx + halfWidth);
+	const int startZ = Traits::template tileIndex<AXIS_Z>(pos.z - halfDepth);
+	const int stopZ = Traits::template tileIndex<AXIS_Z>(pos.z + halfDepth);
 
-Hitbox::CollisionData Hitbox::collidingSouth(Point3D pos, World& w)
-{
-	CollisionData currCollision = {CollisionType::None, 0.0};
-	const int startX = floor((pos.x - width / 2.0) / tileWidth);
-	const int stopX = floor((pos.x + width / 2.0) / tileWidth);
-	const int z = floor((pos.z + depth / 2.0) / tileTopHeight);
-	for (int i = startX; i <= stopX; i++)
-	{
-		try
-		{
-			const double snapHeight = w.tileAt(i, z).height * tileHeight;
-			const double heightDiff = snapHeight - pos.y;
-			if (heightDiff > /* tileHeight */ 0.0)
-			{
-				currCollision.collisionType = CollisionType::Colliding;
-			}
-			// else if (heightDiff > 0.0 && currCollision.collisionType != CollisionType::Colliding)
-			// {
-			// 	currCollision.collisionType = CollisionType::SnapUp;
-			// 	if (snapHeight > currCollision.snapHeight)
-			// 	{
-			// 		currCollision.snapHeight = snapHeight;
-			// 	}
-			// }
-		}
-		catch (...) {}
-	}
-	return currCollision;
-}
+	const int firstX = std::max(std::min(startX, westX), 0);
+	const int lastX = std::min<int>(std::max(stopX, eastX), w.getWidth() - 1);
+	const int firstZ = std::max(startZ, 0);
+	const int lastZ = std::min<int>(stopZ, w.getDepth() - 1);
 
-Hitbox::CollisionData Hitbox::collidingEast(Point3D pos, World& w)
-{
-	CollisionData currCollision = {CollisionType::None, 0.0};
-	const int x = floor((pos.x + width / 2.0) / tileWidth);
-	const int startZ = floor((pos.z - depth / 2.0) / tileTopHeight);
-	const int stopZ = floor((pos.z + depth / 2.0) / tileTopHeight);
-	for (int i = startZ; i <= stopZ; i++)
+	// Höjderna görs om till höjd + 1 så att 0 kan betyda att ingen tile var med.
+	const Matrix<uint16_t>& heights = w.getHeights();
+	int north = 0, west = 0, south = 0, east = 0, bottom = 0;
+	for (int x = firstX; x <= lastX; x++)
 	{
-		try
+		const bool underBox = x >= startX && x <= stopX;
+		for (int z = firstZ; z <= lastZ; z++)
 		{
-			const double snapHeight = w.tileAt(x, i).height * tileHeight;
-			const double heightDiff = snapHeight - pos.y;
-			if (heightDiff > /* tileHeight */ 0.0)
-			{
-				currCollision.collisionType = CollisionType::Colliding;
-			}
-			// else if (heightDiff > 0.0 && currCollision.collisionType != CollisionType::Colliding)
-			// {
-			// 	currCollision.collisionType = CollisionType::SnapUp;
-			// 	if (snapHeight > currCollision.snapHeight)
-			// 	{
-			// 		currCollision.snapHeight = snapHeight;
-			// 	}
-			// }
+			const int h = heights[x][z] + 1;
+			north = std::max(north, underBox && z == startZ ? h : 0);
+			south = std::max(south, underBox && z == stopZ ? h : 0);
+			bottom = std::max(bottom, underBox ? h : 0);
+			west = std::max(west, x == westX ? h : 0);
+			east = std::max(east, x == eastX ? h : 0);
 		}
-		catch (...) {}
 	}
-	return currCollision;
+
+	auto side = [&](int h) -> BasicCollisionData<T> {
+		return {h > 0 && Traits::surface(h - 1) > pos.y ? CollisionType::Colliding : CollisionType::None, T()};
+	};
+	const T snapHeight = bottom > 0 ? Traits::surface(bottom - 1) : T();
+	return {
+		side(north),
+		side(west),
+		side(south),
+		side(east),
+		snapHeight > pos.y ? BasicCollisionData<T>{CollisionType::SnapUp, snapHeight} : BasicCollisionData<T>{CollisionType::None, T()}
+	};
 }
 
-Hitbox::CollisionData Hitbox::collidingBottom(Point3D pos, World& w)
-{
-	CollisionData currCollision = {CollisionType::None, 0.0};
-	const int startX = floor((pos.x - width / 2.0) / tileWidth);
-	const int stopX = floor((pos.x + width / 2.0) / tileWidth);
-	const int startZ = floor((pos.z - depth / 2.0) / tileTopHeight);
-	const int stopZ = floor((pos.z + depth / 2.0) / tileTopHeight);
-	for (int x = startX; x <= stopX; x++)
-	{
-		for (int z = startZ; z <= stopZ; z++)
-		{
-			try
-			{
-				const double snapHeight = w.tileAt(x, z).height * tileHeight;
-				const double heightDiff = snapHeight - pos.y;
-				if (heightDiff > 0.0)
-				{
-					currCollision.collisionType = CollisionType::SnapUp;
-					if (snapHeight > currCollision.snapHeight)
-					{
-						currCollision.snapHeight = snapHeight;
-					}
-				}
-			}
-			catch (...) {}
-		}
-	}
-	return currCollision;
-}
\ No newline at end of file
+template Hitbox::CollisionData Hitbox::collidingBottom(Point3D pos, const World& w) const noexcept;
+template Hitbox::BasicCollisionData<Fixed> Hitbox::collidingBottom(FixedPoint3D pos, const World& w) const noexcept;
+template Hitbox::Probe Hitbox::probeAll(Point3D pos, const World& w, double dx) const noexcept;
+template Hitbox::BasicProbe<Fixed> Hitbox::probeAll(FixedPoint3D pos, const World& w, Fixed dx) const noexcept;
\ No newline at end of file
@@ -1,6 +1,13 @@
 ﻿#pragma once
+#include <algorithm>
+#include <cmath>
+#include "fixedpoint.h"
 #include "world.h"
 
+// Koordinattypen i en position, double för Point3D och Fixed för FixedPoint3D.
+template <typename P>
+using CoordinateOf = decltype(P::x);
+
 class Hitbox
 {
 public:
@@ -10,19 +17,128 @@ public:
 		SnapUp,
 		Colliding
 	};
-	struct CollisionData
+	template <typename T>
+	struct BasicCollisionData
 	{
 		CollisionType collisionType;
-		double snapHeight;
+		T snapHeight;
+	};
+	// Resultatet av probeAll().
+	template <typename T>
+	struct BasicProbe
+	{
+		BasicCollisionData<T> north;
+		BasicCollisionData<T> west;
+		BasicCollisionData<T> south;
+		BasicCollisionData<T> east;
+		BasicCollisionData<T> bottom;
+	};
+	typedef BasicCollisionData<double> CollisionData;
+	typedef BasicProbe<double> Probe;
+	enum Axis
+	{
+		AXIS_X,
+		AXIS_Z
 	};
 
 	double width;
 	double height;
 	double depth;
 
-	CollisionData collidingNorth(Point3D pos, World& w);
-	CollisionData collidingWest(Point3D pos, World& w);
-	CollisionData collidingSouth(Point3D pos, World& w);
-	CollisionData collidingEast(Point3D pos, World& w);
-	CollisionData collidingBottom(Point3D pos, World& w);
-};
\ No newline at end of file
+	/*
+	 * Alla kollisionsfrågor tar antingen en Point3D eller en FixedPoint3D. Med fixtal räknas tileindex
+	 * ut med skift och resultatet blir exakt.
+	*/
+
+	/*
+	 * Kollar om sidan av hitboxen som är vänd åt sign (-1 eller 1) längs axis kolliderar med terrängen.
+	 * Tilestorlekarna är konstanter, så kompilatorn kan göra om divisionerna till multiplikationer och
+	 * loopen över tiles blir en max-reduktion utan förgreningar.
+	*/
+	template <Axis axis, int sign, typename P>
+	BasicCollisionData<CoordinateOf<P>> collidingSide(P pos, const World& w) const noexcept;
+
+	template <typename P>
+	BasicCollisionData<CoordinateOf<P>> collidingNorth(P pos, const World& w) const noexcept {return collidingSide<AXIS_Z, -1>(pos, w);}
+	template <typename P>
+	BasicCollisionData<CoordinateOf<P>> collidingWest(P pos, const World& w) const noexcept {return collidingSide<AXIS_X, -1>(pos, w);}
+	template <typename P>
+	BasicCollisionData<CoordinateOf<P>> collidingSouth(P pos, const World& w) const noexcept {return collidingSide<AXIS_Z, 1>(pos, w);}
+	template <typename P>
+	BasicCollisionData<CoordinateOf<P>> collidingEast(P pos, const World& w) const noexcept {return collidingSide<AXIS_X, 1>(pos, w);}
+	// Finns för Point3D och FixedPoint3D.
+	template <typename P>
+	BasicCollisionData<CoordinateOf<P>> collidingBottom(P pos, const World& w) const noexcept;
+
+	/*
+	 * Svarar på alla fem kollisionsfrågor i ett svep över tilesen under hitboxen. North, south och bottom
+	 * gäller hitboxen på pos och west och east gäller hitboxen flyttad dx i x-led, så att ett diagonalt
+	 * steg bara behöver ett svep. Finns för Point3D och FixedPoint3D.
+	*/
+	template <typename P>
+	BasicProbe<CoordinateOf<P>> probeAll(P pos, const World& w, CoordinateOf<P> dx = CoordinateOf<P>()) const noexcept;
+};
+
+// Omvandlingar mellan en koordinattyp och tiles.
+template <typename T>
+struct CoordinateTraits;
+
+template <>
+struct CoordinateTraits<double>
+{
+	static double fromSize(double size) noexcept {return size;}
+	// Returnerar indexet för tilen som koordinaten är i längs axeln.
+	template <Hitbox::Axis axis>
+	static int tileIndex(double v) noexcept
+	{
+		constexpr double invTileSize = 1.0 / (axis == Hitbox::AXIS_X ? tileWidth : tileTopHeight);
+		return static_cast<int>(std::floor(v * invTileSize));
+	}
+	// Returnerar koordinaten där tilen med index i börjar längs axeln.
+	template <Hitbox::Axis axis>
+	static double tileStart(int i) noexcept {return i * double(axis == Hitbox::AXIS_X ? tileWidth : tileTopHeight);}
+	// Returnerar y-koordinaten för toppen av en tile med höjden h.
+	static double surface(int h) noexcept {return h * tileHeight;}
+	// Returnerar den största koordinaten som är mindre än v.
+	static double below(double v) noexcept {return std::nextafter(v, -INFINITY);}
+};
+
+template <>
+struct CoordinateTraits<Fixed>
+{
+	static Fixed fromSize(double size) noexcept {return Fixed(size);}
+	template <Hitbox::Axis axis>
+	static int tileIndex(Fixed v) noexcept {return static_cast<int>(v.floorShift(axis == Hitbox::AXIS_X ? tileWidthShift : tileTopHeightShift));}
+	template <Hitbox::Axis axis>
+	static Fixed tileStart(int i) noexcept {return Fixed::shifted(i, axis == Hitbox::AXIS_X ? tileWidthShift : tileTopHeightShift);}
+	static Fixed surface(int h) noexcept {return Fixed::shifted(h, tileHeightShift);}
+	static Fixed below(Fixed v) noexcept {return v.below();}
+};
+
+template <Hitbox::Axis axis, int sign, typename P>
+Hitbox::BasicCollisionData<CoordinateOf<P>> Hitbox::collidingSide(P pos, const World& w) const noexcept
+{
+	typedef CoordinateOf<P> T;
+	typedef CoordinateTraits<T> Traits;
+	constexpr Axis otherAxis = axis == AXIS_X ? AXIS_Z : AXIS_X;
+	const T along = axis == AXIS_X ? pos.x : pos.z;
+	const T across = axis == AXIS_X ? pos.z : pos.x;
+	const T alongHalf = Traits::fromSize((axis == AXIS_X ? width : depth) / 2.0);
+	const T acrossHalf = Traits::fromSize((axis == AXIS_X ? depth : width) / 2.0);
+	const int alongLimit = axis == AXIS_X ? w.getWidth() : w.getDepth();
+	const int acrossLimit = axis == AXIS_X ? w.getDepth() : w.getWidth();
+
+	// Tiles utanför världen räknas inte.
+	const int fixed = Traits::template tileIndex<axis>(sign < 0 ? along - alongHalf : along + alongHalf);
+	const int start = std::max(Traits::template tileIndex<otherAxis>(across - acrossHalf), 0);
+	const int stop = std::min(Traits::template tileIndex<otherAxis>(across + acrossHalf), acrossLimit - 1);
+	if (fixed < 0 || fixed >= alongLimit) return {CollisionType::None, T()};
+
+	const Matrix<uint16_t>& heights = w.getHeights();
+	uint16_t maxHeight = 0;
+	for (int i = start; i <= stop; i++)
+	{
+		maxHeight = std::max(maxHeight, axis == AXIS_X ? heights[fixed][i] : heights[i][fixed]);
+	}
+	return {start <= stop && Traits::surface(maxHeight) > pos.y ? CollisionType::Colliding : CollisionType::None, T()};
+}
\ No newline at end of file
@@ -0,0 +1,136 @@
+﻿#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include "hotreload.h"
+#include "worldfile.h"
+
+HotReload::HotReload(World& world, ThreadPool& threadPool, const std::string& worldFile)
+	: world(world),
+	  threadPool(threadPool),
+	  worldFile(worldFile),
+	  reloadCount(0)
+{
+	for (const char* file : imageFiles)
+	{
+		watcher.watch(file);
+	}
+	if (!worldFile.empty())
+	{
+		watcher.watch(worldFile);
+		std::error_code error;
+		if (std::filesystem::exists(worldFile, error)) changedFiles.push_back(worldFile);
+	}
+}
+
+bool HotReload::collect(Platform& platform)
+{
+	std::vector<std::pair<ImageID, PixelImage>> images;
+	std::vector<HeightChange> heights;
+	std::vector<std::string> errors;
+	{
+		std::lock_guard<std::mutex> lock(running->mutex);
+		if (!running->finished) return false;
+		images = std::move(running->images);
+		heights = std::move(running->heights);
+		errors = std::move(running->errors);
+	}
+	running.reset();
+
+	for (const auto& [imageID, image] : images)
+	{
+		platform.reloadImage(imageID, image);
+	}
+	if (!heights.empty())
+	{
+		world.beginEdit();
+		for (const HeightChange& change : heights)
+		{
+			world.setHeight(change.x, change.z, change.height);
+		}
+		world.endEdit();
+	}
+	if (!errors.empty()) lastError = errors.back();
+	reloadCount += images.size() + (heights.empty() ? 0 : 1);
+	return !images.empty() || !heights.empty();
+}
+
+void HotReload::start()
+{
+	// Höjderna kopieras här, så att jobbet inte läser världen medan den ändras.
+	Matrix<uint16_t> snapshot;
+	if (std::find(changedFiles.begin(), changedFiles.end(), worldFile) != changedFiles.end())
+	{
+		snapshot = world.getHeights();
+	}
+
+	running = std::make_shared<Shared>();
+	threadPool.submit([shared = running, files = std::move(changedFiles), worldFile = worldFile, snapshot = std::move(snapshot)] {
+		std::vector<std::pair<ImageID, PixelImage>> images;
+		std::vector<HeightChange> heights;
+		std::vector<std::string> errors;
+		for (const std::string& file : files)
+		{
+			try
+			{
+				if (file == worldFile)
+				{
+					const Matrix<uint16_t> loaded = loadWorldFile(file);
+					if (loaded.getWidth() != snapshot.getWidth() || loaded.getHeight() != snapshot.getHeight())
+					{
+						throw std::runtime_error(file + " is not the same size as the world.");
+					}
+					for (unsigned x = 0; x < loaded.getWidth(); x++)
+					{
+						for (unsigned z = 0; z < loaded.getHeight(); z++)
+						{
+							if (loaded[x][z] != snapshot[x][z]) heights.push_back({int(x), int(z), loaded[x][z]});
+						}
+					}
+					continue;
+				}
+				for (std::size_t i = 0; i < imageCount; i++)
+				{
+					if (file == imageFiles[i]) images.emplace_back(ImageID(i), loadImageFile(file));
+				}
+			}
+			catch (const std::exception& e)
+			{
+				// Det gamla behålls, och filen laddas igen nästa gång den ändras.
+				errors.push_back(e.what());
+			}
+		}
+		std::lock_guard<std::mutex> lock(shared->mutex);
+		shared->images = std::move(images);
+		shared->heights = std::move(heights);
+		shared->errors = std::move(errors);
+		shared->finished = true;
+		shared->finishedChanged.notify_all();
+	});
+	changedFiles.clear();
+}
+
+bool HotReload::update(Platform& platform)
+{
+	for (std::string& file : watcher.takeChanged())
+	{
+		if (std::find(changedFiles.begin(), changedFiles.end(), file) == changedFiles.end()) changedFiles.push_back(std::move(file));
+	}
+	const bool changed = running && collect(platform);
+	if (!running && !changedFiles.empty()) start();
+	return changed;
+}
+
+bool HotReload::wait(Platform& platform)
+{
+	bool changed = false;
+	while (running || !changedFiles.empty())
+	{
+		if (!running) start();
+		{
+			std::unique_lock<std::mutex> lock(running->mutex);
+			running->finishedChanged.wait(lock, [&] {return running->finished;});
+		}
+		changed = collect(platform) || changed;
+	}
+	return changed;
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+﻿#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "filewatcher.h"
+#include "image.h"
+#include "imagefile.h"
+#include "platform.h"
+#include "threadpool.h"
+#include "world.h"
+
+/*
+ * Laddar om bilderna i imageFiles och en världsfil när de ändras på disken, utan att starta om spelet.
+ * Filerna läses och avkodas av ett jobb i trådpoolen. update() kör inga långsamma saker, utan lämnar
+ * de ändrade filerna till jobbet och byter in det som jobbet har laddat klart, allt på en gång mellan
+ * två frames. Bara ett jobb körs åt gången, så filer som ändras under tiden laddas av nästa jobb.
+ *
+ * En bild byts ut i sin helhet. För världsfilen jämför jobbet filen med världens höjder och bara de
+ * tiles som skiljer sig ändras, som en ändring som kan ångras, så att bara de bitar av terrängen och
+ * minikartan som berörs ritas om.
+*/
+class HotReload
+{
+private:
+	// En tile som har en annan höjd i världsfilen.
+	struct HeightChange
+	{
+		int x;
+		int z;
+		uint16_t height;
+	};
+	// Delas med jobbet, så att jobbet kan bli klart även om HotReload har förstörts.
+	struct Shared
+	{
+		std::mutex mutex;
+		std::condition_variable finishedChanged;
+		std::vector<std::pair<ImageID, PixelImage>> images;
+		std::vector<HeightChange> heights;
+		std::vector<std::string> errors;
+		bool finished = false;
+	};
+
+	World& world;
+	ThreadPool& threadPool;
+	FileWatcher watcher;
+	std::string worldFile;
+	std::vector<std::string> changedFiles; // Filer som har ändrats men inte lämnats till något jobb än.
+	std::shared_ptr<Shared> running;
+	std::string lastError;
+	unsigned reloadCount;
+
+	// Byter in det som ett klart jobb har laddat. Returnerar true om något har bytts ut.
+	bool collect(Platform& platform);
+	// Startar ett jobb för filerna i changedFiles.
+	void start();
+public:
+	// Håller koll på alla filer i imageFiles och worldFile, om den inte är tom. Om worldFile finns laddas den vid första update().
+	HotReload(World& world, ThreadPool& threadPool, const std::string& worldFile = "");
+	// Väntar inte på jobbet, utan låter det bli klart i bakgrunden.
+	~HotReload() = default;
+
+	// Ingen kopiering.
+	HotReload(const HotReload&) = delete;
+	// Ingen kopiering.
+	HotReload& operator=(const HotReload&) = delete;
+
+	// Ska köras mellan frames. Returnerar true om någon bild eller världen har ändrats.
+	bool update(Platform& platform);
+	// Laddar filerna som har ändrats och väntar tills de är inbytta, t.ex. innan första framen. Returnerar true om något har ändrats.
+	bool wait(Platform& platform);
+
+	// Returnerar felet från den senaste filen som inte gick att ladda, eller en tom sträng.
+	const std::string& getLastError() const noexcept {return lastError;}
+	// Returnerar antalet filer som har laddats om.
+	unsigned getReloadCount() const noexcept {return reloadCount;}
+};
\ No newline at end of file
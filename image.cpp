@@ -1,10 +1,5 @@
 ﻿#include "image.h"
-
-void loadImages(DirectV& dv, images_t& images)
-{
-	images[LOWERCASEMU] = std::make_unique<Bitmap>(dv.createBitmap(L"gfx/lowercaseMu.bmp"));
-	images[TILES] = std::make_unique<Bitmap>(dv.createBitmap(L"gfx/tiles.png"));
-}
+#include "rendertarget.h"
 
 Image::Image() noexcept
 	: imageID(LOWERCASEMU),
@@ -42,14 +37,30 @@ Image::Image(ImageID imageID, float dispWidth, float dispHeight, float x, float
 	  dispWidth(dispWidth),
 	  dispHeight(dispHeight) {}
 
-void Image::draw(float x, float y, DirectV& dv, images_t& images) const
+void Image::draw(float x, float y, RenderTarget& target) const
+{
+	if (entireImage)
+	{
+		target.drawImage(imageID, int(x), int(y), dispWidth, dispHeight);
+	}
+	else
+	{
+		target.drawImage(imageID, int(x), int(y), dispWidth, dispHeight, this->x, this->y, width, height);
+	}
+}
+
+void Image::drawRepeated(float x, float y, unsigned count, RenderTarget& target) const
 {
 	if (entireImage)
 	{
-		dv.drawBitmap(int(x), int(y), dispWidth, dispHeight, *images[imageID]);
+		// Hela bilden har ingen källrektangel att upprepa, så den ritas en gång i taget.
+		for (unsigned i = 0; i < count; i++)
+		{
+			draw(x + i * dispWidth, y, target);
+		}
 	}
 	else
 	{
-		dv.drawBitmap(int(x), int(y), dispWidth, dispHeight, this->x, this->y, width, height, *images[imageID]);
+		target.drawImageRepeated(imageID, int(x), int(y), dispWidth, dispHeight, this->x, this->y, width, height, count);
 	}
 }
\ No newline at end of file
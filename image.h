@@ -1,13 +1,10 @@
 ﻿#pragma once
-#include <array>
-#include <memory>
-#include "directv.h"
+#include <cstddef>
 
 /*
  * För att lägga till en ny bild ska du:
  * - Lägga till ett ID i ImageID
- * - Ändra storleken av images_t
- * - Lägga till en rad i loadImages() som laddar bilden
+ * - Lägga till filen i imageFiles, på samma plats som ID:t
 */
 
 enum ImageID
@@ -15,9 +12,14 @@ enum ImageID
 	LOWERCASEMU,
 	TILES
 };
-typedef std::array<std::unique_ptr<Bitmap>, 2 /* <-- ska vara antalet bilder */> images_t;
+// Filerna som bilderna laddas från, i samma ordning som ImageID.
+constexpr const char* imageFiles[] = {
+	"gfx/lowercaseMu.bmp",
+	"gfx/tiles.png"
+};
+constexpr std::size_t imageCount = sizeof(imageFiles) / sizeof(imageFiles[0]);
 
-void loadImages(DirectV& dv, images_t& images);
+class RenderTarget; // Forward-declarea för att Image ska kunna ritas på en RenderTarget.
 
 class Image
 {
@@ -36,10 +38,11 @@ public:
 	Image(ImageID imageID, float dispWidth, float dispHeight) noexcept;
 	Image(ImageID imageID, float dispWidth, float dispHeight, float x, float y, float width, float height) noexcept;
 
-	void draw(float x, float y, DirectV& dv, images_t& images) const;
+	void draw(float x, float y, RenderTarget& target) const;
+	// Ritar bilden count gånger bredvid varandra, med den första på (x, y).
+	void drawRepeated(float x, float y, unsigned count, RenderTarget& target) const;
 
-	Bitmap& getBitmap(images_t& images) const {return *images[imageID];}
-	const Bitmap& getBitmap(const images_t& images) const {return *images[imageID];}
+	ImageID getImageID() const noexcept {return imageID;}
 
 	float getWidth() const noexcept {return dispWidth;}
 	float getHeight() const noexcept {return dispHeight;}
@@ -0,0 +1,506 @@
+﻿#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include "imagefile.h"
+
+namespace
+{
+	std::vector<uint8_t> readFile(const std::string& filename)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file) throw std::runtime_error("Failed to open " + filename + ".");
+		return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+	}
+
+	void writeFile(const std::string& filename, const std::vector<uint8_t>& data)
+	{
+		std::ofstream file(filename, std::ios::binary);
+		if (!file) throw std::runtime_error("Failed to create " + filename + ".");
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		if (!file) throw std::runtime_error("Failed to write " + filename + ".");
+	}
+
+	uint32_t readBE32(const uint8_t* p) noexcept {return uint32_t(p[0]) << 24 | uint32_t(p[1]) << 16 | uint32_t(p[2]) << 8 | p[3];}
+	uint32_t readLE32(const uint8_t* p) noexcept {return uint32_t(p[3]) << 24 | uint32_t(p[2]) << 16 | uint32_t(p[1]) << 8 | p[0];}
+	uint16_t readLE16(const uint8_t* p) noexcept {return uint16_t(p[1] << 8 | p[0]);}
+
+	void writeBE32(std::vector<uint8_t>& out, uint32_t v)
+	{
+		out.push_back(v >> 24);
+		out.push_back(v >> 16);
+		out.push_back(v >> 8);
+		out.push_back(v);
+	}
+
+	uint32_t crc32(const uint8_t* data, std::size_t size) noexcept
+	{
+		static const auto table = [] {
+			std::vector<uint32_t> t(256);
+			for (uint32_t i = 0; i < 256; i++)
+			{
+				uint32_t c = i;
+				for (int k = 0; k < 8; k++) c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+				t[i] = c;
+			}
+			return t;
+		}();
+		uint32_t c = 0xffffffff;
+		for (std::size_t i = 0; i < size; i++) c = table[(c ^ data[i]) & 0xff] ^ (c >> 8);
+		return c ^ 0xffffffff;
+	}
+
+	/*
+	 * Inflate (RFC 1951), för IDAT-datan i PNG-filer.
+	*/
+
+	class BitReader
+	{
+	private:
+		const std::vector<uint8_t>& data;
+		std::size_t pos;
+		uint32_t buffer;
+		int count;
+	public:
+		BitReader(const std::vector<uint8_t>& data, std::size_t pos)
+			: data(data),
+			  pos(pos),
+			  buffer(0),
+			  count(0) {}
+
+		unsigned bits(int n)
+		{
+			while (count < n)
+			{
+				if (pos >= data.size()) throw std::runtime_error("Compressed data ended too early.");
+				buffer |= uint32_t(data[pos++]) << count;
+				count += 8;
+			}
+			const unsigned v = buffer & ((1u << n) - 1);
+			buffer >>= n;
+			count -= n;
+			return v;
+		}
+		// Hoppar över resten av den nuvarande byten.
+		void align() noexcept
+		{
+			buffer = 0;
+			count = 0;
+		}
+		uint8_t byte()
+		{
+			if (pos >= data.size()) throw std::runtime_error("Compressed data ended too early.");
+			return data[pos++];
+		}
+	};
+
+	// En kanonisk Huffmankod, avkodad en bit i taget.
+	struct Huffman
+	{
+		uint16_t counts[16];
+		uint16_t symbols[288];
+
+		Huffman(const uint8_t* lengths, int n)
+			: counts{},
+			  symbols{}
+		{
+			for (int i = 0; i < n; i++) counts[lengths[i]]++;
+			counts[0] = 0;
+			uint16_t offsets[16] = {};
+			for (int len = 1; len < 15; len++) offsets[len + 1] = offsets[len] + counts[len];
+			for (int i = 0; i < n; i++)
+			{
+				if (lengths[i] != 0) symbols[offsets[lengths[i]]++] = i;
+			}
+		}
+
+		int decode(BitReader& in) const
+		{
+			int code = 0;
+			int first = 0;
+			int index = 0;
+			for (int len = 1; len < 16; len++)
+			{
+				code |= in.bits(1);
+				const int count = counts[len];
+				if (code - count < first) return symbols[index + (code - first)];
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+			throw std::runtime_error("Invalid Huffman code.");
+		}
+	};
+
+	void inflateBlock(BitReader& in, std::vector<uint8_t>& out, const Huffman& literals, const Huffman& distances)
+	{
+		static constexpr uint16_t lengthBase[] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+		static constexpr uint8_t lengthExtra[] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+		static constexpr uint16_t distanceBase[] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+		static constexpr uint8_t distanceExtra[] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+		while (true)
+		{
+			const int symbol = literals.decode(in);
+			if (symbol < 256)
+			{
+				out.push_back(symbol);
+				continue;
+			}
+			if (symbol == 256) return;
+			if (symbol > 285) throw std::runtime_error("Invalid length code.");
+			const unsigned length = lengthBase[symbol - 257] + in.bits(lengthExtra[symbol - 257]);
+			const int distanceSymbol = distances.decode(in);
+			if (distanceSymbol > 29) throw std::runtime_error("Invalid distance code.");
+			const std::size_t distance = distanceBase[distanceSymbol] + in.bits(distanceExtra[distanceSymbol]);
+			if (distance > out.size()) throw std::runtime_error("Distance too far back.");
+			// Kopian kan överlappa sig själv, så den görs en byte i taget.
+			for (unsigned i = 0; i < length; i++) out.push_back(out[out.size() - distance]);
+		}
+	}
+
+	// Packar upp en zlib-ström (RFC 1950). Checksumman kontrolleras inte.
+	std::vector<uint8_t> inflateZlib(const std::vector<uint8_t>& data)
+	{
+		if (data.size() < 2 || (data[0] & 0x0f) != 8 || (data[0] << 8 | data[1]) % 31 != 0)
+			throw std::runtime_error("Invalid zlib header.");
+		BitReader in(data, 2);
+		std::vector<uint8_t> out;
+		bool last = false;
+		while (!last)
+		{
+			last = in.bits(1);
+			switch (in.bits(2))
+			{
+				case 0:
+				{
+					in.align();
+					// Byten läses i var sin sats, eftersom ordningen mellan två anrop i samma uttryck inte är bestämd.
+					const unsigned lengthLow = in.byte();
+					const unsigned lengthHigh = in.byte();
+					const unsigned inverseLow = in.byte();
+					const unsigned inverseHigh = in.byte();
+					const unsigned length = lengthLow | lengthHigh << 8;
+					if ((inverseLow | inverseHigh << 8) != (~length & 0xffff)) throw std::runtime_error("Invalid stored block length.");
+					for (unsigned i = 0; i < length; i++) out.push_back(in.byte());
+				}
+				break;
+				case 1:
+				{
+					uint8_t lengths[288 + 30];
+					std::fill(lengths, lengths + 144, 8);
+					std::fill(lengths + 144, lengths + 256, 9);
+					std::fill(lengths + 256, lengths + 280, 7);
+					std::fill(lengths + 280, lengths + 288, 8);
+					std::fill(lengths + 288, lengths + 318, 5);
+					inflateBlock(in, out, Huffman(lengths, 288), Huffman(lengths + 288, 30));
+				}
+				break;
+				case 2:
+				{
+					static constexpr uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+					const int literalCount = in.bits(5) + 257;
+					const int distanceCount = in.bits(5) + 1;
+					const int codeLengthCount = in.bits(4) + 4;
+					uint8_t codeLengths[19] = {};
+					for (int i = 0; i < codeLengthCount; i++) codeLengths[order[i]] = in.bits(3);
+					const Huffman codeLengthCode(codeLengths, 19);
+
+					uint8_t lengths[288 + 32] = {};
+					int n = 0;
+					while (n < literalCount + distanceCount)
+					{
+						const int symbol = codeLengthCode.decode(in);
+						if (symbol < 16)
+						{
+							lengths[n++] = symbol;
+							continue;
+						}
+						uint8_t value = 0;
+						int repeat;
+						if (symbol == 16)
+						{
+							if (n == 0) throw std::runtime_error("Repeat without a previous length.");
+							value = lengths[n - 1];
+							repeat = 3 + in.bits(2);
+						}
+						else if (symbol == 17)
+						{
+							repeat = 3 + in.bits(3);
+						}
+						else
+						{
+							repeat = 11 + in.bits(7);
+						}
+						if (n + repeat > literalCount + distanceCount) throw std::runtime_error("Too many code lengths.");
+						while (repeat-- > 0) lengths[n++] = value;
+					}
+					inflateBlock(in, out, Huffman(lengths, literalCount), Huffman(lengths + literalCount, distanceCount));
+				}
+				break;
+				default:
+				throw std::runtime_error("Invalid block type.");
+			}
+		}
+		return out;
+	}
+
+	PixelImage decodePNG(const std::vector<uint8_t>& data)
+	{
+		PixelImage image = {0, 0, {}};
+		unsigned bitDepth = 0;
+		unsigned colourType = 0;
+		std::vector<uint8_t> compressed;
+		std::size_t pos = 8;
+		while (pos + 12 <= data.size())
+		{
+			const uint32_t length = readBE32(&data[pos]);
+			const std::string type(data.begin() + pos + 4, data.begin() + pos + 8);
+			const uint8_t* chunk = &data[pos + 8];
+			if (pos + 12 + length > data.size()) throw std::runtime_error("PNG chunk extends past the end of the file.");
+			if (type == "IHDR")
+			{
+				image.width = readBE32(chunk);
+				image.height = readBE32(chunk + 4);
+				bitDepth = chunk[8];
+				colourType = chunk[9];
+				if (chunk[12] != 0) throw std::runtime_error("Interlaced PNG files are not supported.");
+			}
+			else if (type == "IDAT")
+			{
+				compressed.insert(compressed.end(), chunk, chunk + length);
+			}
+			else if (type == "IEND")
+			{
+				break;
+			}
+			pos += 12 + length;
+		}
+
+		unsigned channels;
+		switch (colourType)
+		{
+			case 0: channels = 1; break;
+			case 2: channels = 3; break;
+			case 4: channels = 2; break;
+			case 6: channels = 4; break;
+			default: throw std::runtime_error("Unsupported PNG colour type.");
+		}
+		if (bitDepth != 8) throw std::runtime_error("Only PNG files with 8 bits per channel are supported.");
+
+		const std::vector<uint8_t> raw = inflateZlib(compressed);
+		const std::size_t stride = std::size_t(image.width) * channels;
+		if (raw.size() < (stride + 1) * image.height) throw std::runtime_error("PNG image data is too short.");
+
+		// Filtren tas bort på plats, rad för rad.
+		std::vector<uint8_t> current(stride);
+		std::vector<uint8_t> previous(stride);
+		image.pixels.resize(std::size_t(image.width) * image.height);
+		for (unsigned y = 0; y < image.height; y++)
+		{
+			const uint8_t filter = raw[y * (stride + 1)];
+			const uint8_t* line = &raw[y * (stride + 1) + 1];
+			for (std::size_t i = 0; i < stride; i++)
+			{
+				const int a = i >= channels ? current[i - channels] : 0;
+				const int b = previous[i];
+				const int c = i >= channels ? previous[i - channels] : 0;
+				int predicted;
+				switch (filter)
+				{
+					case 0: predicted = 0; break;
+					case 1: predicted = a; break;
+					case 2: predicted = b; break;
+					case 3: predicted = (a + b) / 2; break;
+					case 4:
+					{
+						const int pa = std::abs(b - c);
+						const int pb = std::abs(a - c);
+						const int pc = std::abs(a + b - 2 * c);
+						predicted = pa <= pb && pa <= pc ? a : pb <= pc ? b : c;
+					}
+					break;
+					default: throw std::runtime_error("Invalid PNG filter.");
+				}
+				current[i] = line[i] + predicted;
+			}
+			for (unsigned x = 0; x < image.width; x++)
+			{
+				const uint8_t* p = &current[x * channels];
+				const uint32_t r = p[0];
+				const uint32_t g = channels >= 3 ? p[1] : p[0];
+				const uint32_t b = channels >= 3 ? p[2] : p[0];
+				const uint32_t alpha = channels == 4 ? p[3] : channels == 2 ? p[1] : 255;
+				image.pixels[x + y * image.width] = alpha << 24 | r << 16 | g << 8 | b;
+			}
+			std::swap(current, previous);
+		}
+		return image;
+	}
+
+	// Returnerar kanalen som mask väljer ut ur v, som 8 bitar.
+	uint32_t maskedChannel(uint32_t v, uint32_t mask, uint32_t ifNoMask) noexcept
+	{
+		if (mask == 0) return ifNoMask;
+		int shift = 0;
+		while (!(mask >> shift & 1)) shift++;
+		const uint32_t max = mask >> shift;
+		return ((v & mask) >> shift) * 255 / max;
+	}
+
+	PixelImage decodeBMP(const std::vector<uint8_t>& data)
+	{
+		if (data.size() < 54) throw std::runtime_error("BMP file is too short.");
+		const uint32_t offset = readLE32(&data[10]);
+		const uint32_t headerSize = readLE32(&data[14]);
+		const int32_t width = readLE32(&data[18]);
+		const int32_t height = readLE32(&data[22]);
+		const unsigned bitsPerPixel = readLE16(&data[28]);
+		const uint32_t compression = readLE32(&data[30]);
+		if (width <= 0 || height == 0) throw std::runtime_error("Invalid BMP size.");
+		if ((bitsPerPixel != 24 && bitsPerPixel != 32) || (compression != 0 && compression != 3))
+			throw std::runtime_error("Only uncompressed 24- and 32-bit BMP files are supported.");
+
+		uint32_t redMask = 0x00ff0000, greenMask = 0x0000ff00, blueMask = 0x000000ff, alphaMask = 0;
+		if (compression == 3)
+		{
+			if (data.size() < 66) throw std::runtime_error("BMP file is too short.");
+			redMask = readLE32(&data[54]);
+			greenMask = readLE32(&data[58]);
+			blueMask = readLE32(&data[62]);
+			if (headerSize >= 56 && data.size() >= 70) alphaMask = readLE32(&data[66]);
+		}
+
+		// Rader lagras nerifrån och upp om höjden är positiv och är utfyllda till 4 bytes.
+		PixelImage image = {unsigned(width), unsigned(std::abs(height)), {}};
+		const std::size_t stride = (std::size_t(width) * bitsPerPixel + 31) / 32 * 4;
+		if (offset + stride * image.height > data.size()) throw std::runtime_error("BMP image data is too short.");
+		image.pixels.resize(std::size_t(image.width) * image.height);
+		for (unsigned y = 0; y < image.height; y++)
+		{
+			const uint8_t* row = &data[offset + stride * (height > 0 ? image.height - 1 - y : y)];
+			for (unsigned x = 0; x < image.width; x++)
+			{
+				const uint8_t* p = row + x * (bitsPerPixel / 8);
+				const uint32_t v = bitsPerPixel == 32 ? readLE32(p) : uint32_t(p[2]) << 16 | uint32_t(p[1]) << 8 | p[0];
+				image.pixels[x + y * image.width] =
+					maskedChannel(v, alphaMask, 255) << 24 |
+					maskedChannel(v, redMask, 0) << 16 |
+					maskedChannel(v, greenMask, 0) << 8 |
+					maskedChannel(v, blueMask, 0);
+			}
+		}
+		return image;
+	}
+
+	PixelImage decodePPM(const std::vector<uint8_t>& data)
+	{
+		std::size_t pos = 2;
+		// Läser nästa tal i huvudet. Kommentarer börjar med # och går till radslutet.
+		auto readNumber = [&]() -> unsigned {
+			while (pos < data.size() && (std::isspace(data[pos]) || data[pos] == '#'))
+			{
+				if (data[pos] == '#')
+					while (pos < data.size() && data[pos] != '\n') pos++;
+				else
+					pos++;
+			}
+			unsigned v = 0;
+			if (pos >= data.size() || !std::isdigit(data[pos])) throw std::runtime_error("Invalid PPM header.");
+			while (pos < data.size() && std::isdigit(data[pos])) v = v * 10 + (data[pos++] - '0');
+			return v;
+		};
+		PixelImage image = {0, 0, {}};
+		image.width = readNumber();
+		image.height = readNumber();
+		if (readNumber() != 255) throw std::runtime_error("Only PPM files with a maximum value of 255 are supported.");
+		pos++;
+		if (pos + std::size_t(image.width) * image.height * 3 > data.size()) throw std::runtime_error("PPM image data is too short.");
+		image.pixels.resize(std::size_t(image.width) * image.height);
+		for (uint32_t& pixel : image.pixels)
+		{
+			pixel = 0xff000000 | uint32_t(data[pos]) << 16 | uint32_t(data[pos + 1]) << 8 | data[pos + 2];
+			pos += 3;
+		}
+		return image;
+	}
+}
+
+PixelImage loadImageFile(const std::string& filename)
+{
+	const std::vector<uint8_t> data = readFile(filename);
+	static const uint8_t pngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	if (data.size() >= 8 && std::equal(pngSignature, pngSignature + 8, data.begin())) return decodePNG(data);
+	if (data.size() >= 2 && data[0] == 'B' && data[1] == 'M') return decodeBMP(data);
+	if (data.size() >= 2 && data[0] == 'P' && data[1] == '6') return decodePPM(data);
+	throw std::runtime_error(filename + " has an unsupported image format.");
+}
+
+void savePPM(const std::string& filename, const PixelImage& image)
+{
+	const std::string header = "P6\n" + std::to_string(image.width) + " " + std::to_string(image.height) + "\n255\n";
+	std::vector<uint8_t> data(header.begin(), header.end());
+	data.reserve(data.size() + image.pixels.size() * 3);
+	for (uint32_t pixel : image.pixels)
+	{
+		data.push_back(pixel >> 16);
+		data.push_back(pixel >> 8);
+		data.push_back(pixel);
+	}
+	writeFile(filename, data);
+}
+
+void savePNG(const std::string& filename, const PixelImage& image)
+{
+	// Raderna får filtret 0 och läggs i okomprimerade deflate-block.
+	std::vector<uint8_t> raw;
+	raw.reserve((std::size_t(image.width) * 4 + 1) * image.height);
+	for (unsigned y = 0; y < image.height; y++)
+	{
+		raw.push_back(0);
+		for (unsigned x = 0; x < image.width; x++)
+		{
+			const uint32_t pixel = image.pixels[x + y * image.width];
+			raw.push_back(pixel >> 16);
+			raw.push_back(pixel >> 8);
+			raw.push_back(pixel);
+			raw.push_back(pixel >> 24);
+		}
+	}
+	std::vector<uint8_t> zlib = {0x78, 0x01};
+	for (std::size_t pos = 0; pos == 0 || pos < raw.size(); pos += 65535)
+	{
+		const std::size_t length = std::min<std::size_t>(raw.size() - pos, 65535);
+		zlib.push_back(pos + length >= raw.size() ? 1 : 0);
+		zlib.push_back(length);
+		zlib.push_back(length >> 8);
+		zlib.push_back(~length);
+		zlib.push_back(~length >> 8);
+		zlib.insert(zlib.end(), raw.begin() + pos, raw.begin() + pos + length);
+	}
+	uint32_t a = 1, b = 0;
+	for (uint8_t byte : raw)
+	{
+		a = (a + byte) % 65521;
+		b = (b + a) % 65521;
+	}
+	writeBE32(zlib, b << 16 | a);
+
+	std::vector<uint8_t> data = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+	auto writeChunk = [&](const char* type, const std::vector<uint8_t>& content) -> void {
+		writeBE32(data, content.size());
+		const std::size_t start = data.size();
+		data.insert(data.end(), type, type + 4);
+		data.insert(data.end(), content.begin(), content.end());
+		writeBE32(data, crc32(&data[start], data.size() - start));
+	};
+	std::vector<uint8_t> header;
+	writeBE32(header, image.width);
+	writeBE32(header, image.height);
+	header.insert(header.end(), {8, 6, 0, 0, 0});
+	writeChunk("IHDR", header);
+	writeChunk("IDAT", zlib);
+	writeChunk("IEND", {});
+	writeFile(filename, data);
+}
\ No newline at end of file
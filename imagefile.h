@@ -0,0 +1,25 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Läsning och skrivning av bildfiler utan Windows, för SoftwareTarget och verktyg. Bara det som
+ * bilderna i gfx och verktygen behöver stöds: PNG med 8 bitar per kanal utan interlacing, BMP med
+ * 24 eller 32 bitar per pixel och binär PPM.
+*/
+
+// En bild i minnet. Pixlarna är rad för rad, uppifrån och ner, i formatet 0xAARRGGBB utan förmultiplicerad alfa.
+struct PixelImage
+{
+	unsigned width;
+	unsigned height;
+	std::vector<uint32_t> pixels;
+};
+
+// Läser en PNG-, BMP- eller PPM-fil. Formatet avgörs av innehållet. Kastar std::runtime_error om det inte går.
+PixelImage loadImageFile(const std::string& filename);
+// Skriver bilden som binär PPM. Alfa tas bort. Kastar std::runtime_error om det inte går.
+void savePPM(const std::string& filename, const PixelImage& image);
+// Skriver bilden som PNG. Datan komprimeras inte. Kastar std::runtime_error om det inte går.
+void savePNG(const std::string& filename, const PixelImage& image);
\ No newline at end of file
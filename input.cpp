@@ -0,0 +1,121 @@
+﻿#include <algorithm>
+#include "input.h"
+
+KeySnapshot::KeySnapshot() noexcept
+	: mouseX(0),
+	  mouseY(0),
+	  latency(InputClock::duration::zero()) {}
+
+InputWriter::InputWriter(InputQueue& queue) noexcept
+	: queue(queue),
+	  pendingTimes{},
+	  pendingMouse{},
+	  mousePending(false),
+	  droppedChars(0) {}
+
+bool InputWriter::pushAbove(const InputEvent& e, std::size_t reserved) noexcept
+{
+	return queue.freeSlots() > reserved && queue.push(e);
+}
+
+void InputWriter::post(const InputEvent& e) noexcept
+{
+	flush();
+	switch (e.type)
+	{
+		case InputEvent::KEY_DOWN:
+		case InputEvent::KEY_UP:
+		{
+			// Så länge några tangenter väntar väntar alla, så att händelserna för samma tangent kommer i ordning.
+			if (pendingKeys.none() && queue.push(e)) break;
+			if (!pendingKeys[e.key]) pendingTimes[e.key] = e.time;
+			pendingKeys[e.key] = true;
+			if (e.type == InputEvent::KEY_DOWN) pendingPressed[e.key] = true;
+			else pendingReleased[e.key] = true;
+			pendingDown[e.key] = e.type == InputEvent::KEY_DOWN;
+		}
+		break;
+		case InputEvent::CHAR:
+		{
+			if (!pushAbove(e, reservedForKeys)) droppedChars++;
+		}
+		break;
+		case InputEvent::MOUSE_MOVE:
+		{
+			// En nyare musrörelse ersätter den som väntar.
+			mousePending = !pushAbove(e, reservedForKeys);
+			if (mousePending) pendingMouse = e;
+		}
+		break;
+	}
+}
+
+void InputWriter::flush() noexcept
+{
+	for (unsigned key = 0; key < 256 && pendingKeys.any(); key++)
+	{
+		if (!pendingKeys[key]) continue;
+		/*
+		 * Läsaren vet inte om tangenten var nere innan, så ett släpp och en tryckning läggs i kön i den
+		 * ordningen om båda har hänt, och sedan ett släpp om tangenten är uppe till sist. Det som har
+		 * lagts i kön tas bort från det som väntar, så att inget läggs i kön två gånger om den blir full.
+		*/
+		const unsigned char k = static_cast<unsigned char>(key);
+		if (pendingReleased[key] && pendingPressed[key])
+		{
+			if (!queue.push({InputEvent::KEY_UP, pendingTimes[key], k, L'\0', 0, 0})) return;
+			pendingReleased[key] = false;
+		}
+		if (pendingPressed[key])
+		{
+			if (!queue.push({InputEvent::KEY_DOWN, pendingTimes[key], k, L'\0', 0, 0})) return;
+			pendingPressed[key] = false;
+		}
+		if (!pendingDown[key] && !queue.push({InputEvent::KEY_UP, pendingTimes[key], k, L'\0', 0, 0})) return;
+		pendingReleased[key] = false;
+		pendingKeys[key] = false;
+	}
+	if (mousePending && pushAbove(pendingMouse, reservedForKeys)) mousePending = false;
+}
+
+const KeySnapshot& InputState::tick(InputQueue& queue, InputClock::time_point until)
+{
+	snapshot.pressed.reset();
+	snapshot.released.reset();
+	snapshot.typed.clear();
+	snapshot.latency = InputClock::duration::zero();
+	while (const InputEvent* e = queue.front())
+	{
+		if (e->time > until) break;
+		snapshot.latency = std::max(snapshot.latency, until - e->time);
+		switch (e->type)
+		{
+			case InputEvent::KEY_DOWN:
+			{
+				// Windows skickar KEY_DOWN om och om igen när en tangent hålls ner, men det räknas bara som en tryckning.
+				if (!snapshot.down[e->key]) snapshot.pressed[e->key] = true;
+				snapshot.down[e->key] = true;
+			}
+			break;
+			case InputEvent::KEY_UP:
+			{
+				if (snapshot.down[e->key]) snapshot.released[e->key] = true;
+				snapshot.down[e->key] = false;
+			}
+			break;
+			case InputEvent::CHAR:
+			{
+				snapshot.typed.append(e->c);
+			}
+			break;
+			case InputEvent::MOUSE_MOVE:
+			{
+				snapshot.mouseX = e->x;
+				snapshot.mouseY = e->y;
+			}
+			break;
+		}
+		queue.pop();
+	}
+	return snapshot;
+}
\ No newline at end of file
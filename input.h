@@ -0,0 +1,135 @@
+﻿#pragma once
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include "spscqueue.h"
+#include "textbuffer.h"
+
+using InputClock = std::chrono::steady_clock;
+
+// Tangentkoder. De är samma som Windows virtual-key codes, och bokstäver och siffror är deras ASCII-kod i versaler.
+enum KeyCode : unsigned char
+{
+	KEY_LBUTTON = 0x01,
+	KEY_RBUTTON = 0x02,
+	KEY_ESCAPE = 0x1b,
+	KEY_SPACE = 0x20,
+	KEY_PAGE_UP = 0x21,
+	KEY_PAGE_DOWN = 0x22
+};
+
+// Något som användaren har gjort, med tiden då fönstret fick det.
+struct InputEvent
+{
+	enum Type
+	{
+		KEY_DOWN,
+		KEY_UP,
+		CHAR,
+		MOUSE_MOVE
+	};
+
+	Type type;
+	InputClock::time_point time;
+	unsigned char key; // För KEY_DOWN och KEY_UP.
+	wchar_t c;         // För CHAR.
+	int x;             // För MOUSE_MOVE, i fönstrets pixlar.
+	int y;
+};
+
+// Så många händelser får plats i kön. Använd en InputWriter för att skriva i den, så att inga tangenter tappas.
+typedef SpscQueue<InputEvent, 1024> InputQueue;
+
+/*
+ * Skriver händelser från fönstrets tråd till en InputQueue utan att tappa tangenter när kön är full.
+ * Musrörelser och tecken får bara fylla kön tills reservedForKeys platser är kvar. Därefter slås
+ * musrörelserna ihop till den senaste, som läggs i kön när det finns plats, och tecknen tappas. Om kön
+ * ändå blir full av tangenter sparas varje tangents senaste läge, och om den trycktes ner eller släpptes,
+ * tills det finns plats. Då kan en tangent inte fastna för att dess KEY_UP inte fick plats, och en
+ * tryckning syns fortfarande i KeySnapshot::wasPressed().
+*/
+class InputWriter
+{
+public:
+	static constexpr std::size_t reservedForKeys = 256;
+private:
+	InputQueue& queue;
+	// Tangenter som har händelser som inte har fått plats i kön.
+	std::bitset<256> pendingKeys;
+	// Tangenter som trycktes ner eller släpptes medan de väntade, så att inga tryckningar eller släpp försvinner.
+	std::bitset<256> pendingPressed;
+	std::bitset<256> pendingReleased;
+	// Det senaste läget för de väntande tangenterna.
+	std::bitset<256> pendingDown;
+	// Tiden för varje väntande tangents första händelse, så att latensen blir rätt.
+	InputClock::time_point pendingTimes[256];
+	InputEvent pendingMouse;
+	bool mousePending;
+	std::size_t droppedChars;
+
+	// Lägger e i kön om det finns fler än reserved lediga platser. Returnerar false annars.
+	bool pushAbove(const InputEvent& e, std::size_t reserved) noexcept;
+public:
+	explicit InputWriter(InputQueue& queue) noexcept;
+
+	// Ingen kopiering.
+	InputWriter(const InputWriter&) = delete;
+	// Ingen kopiering.
+	InputWriter& operator=(const InputWriter&) = delete;
+
+	// Lägger e i kön, eller sparar den tills det finns plats.
+	void post(const InputEvent& e) noexcept;
+	// Lägger det som väntar i kön så långt det finns plats. Körs när läsaren kan ha tagit händelser.
+	void flush() noexcept;
+	// Returnerar true om något väntar på att få plats i kön.
+	bool hasPending() const noexcept {return mousePending || pendingKeys.any();}
+	// Returnerar hur många tecken som har tappats för att kön var nästan full.
+	std::size_t getDroppedChars() const noexcept {return droppedChars;}
+};
+
+// Tangenternas och musens tillstånd under ett tick.
+class KeySnapshot
+{
+private:
+	std::bitset<256> down;
+	std::bitset<256> pressed;
+	std::bitset<256> released;
+	int mouseX;
+	int mouseY;
+	TextBuffer<32> typed;
+	InputClock::duration latency;
+
+	friend class InputState;
+public:
+	KeySnapshot() noexcept;
+
+	// Returnerar true om tangenten är nedtryckt i slutet av ticket.
+	bool keyDown(unsigned char key) const noexcept {return down[key];}
+	// Returnerar true om tangenten trycktes ner under ticket, även om den har släppts igen.
+	bool wasPressed(unsigned char key) const noexcept {return pressed[key];}
+	// Returnerar true om tangenten släpptes under ticket, även om den har tryckts ner igen.
+	bool wasReleased(unsigned char key) const noexcept {return released[key];}
+	// Returnerar musens position i fönstrets pixlar.
+	int getMouseX() const noexcept {return mouseX;}
+	int getMouseY() const noexcept {return mouseY;}
+	// Returnerar tecknen som skrevs under ticket.
+	const wchar_t* getTyped() const noexcept {return typed.c_str();}
+	// Returnerar hur länge den äldsta händelsen under ticket väntade i kön.
+	InputClock::duration getLatency() const noexcept {return latency;}
+};
+
+/*
+ * Läser händelser från en InputQueue en gång per tick och gör om dem till en KeySnapshot. Tryckningar
+ * som börjar och slutar under samma tick syns fortfarande i wasPressed(), så inget försvinner även om
+ * ticken är långa.
+*/
+class InputState
+{
+private:
+	KeySnapshot snapshot;
+public:
+	// Tar alla händelser i kön som har hänt före until och returnerar tillståndet efter dem.
+	const KeySnapshot& tick(InputQueue& queue, InputClock::time_point until = InputClock::now());
+	// Returnerar tillståndet efter den senaste tick().
+	const KeySnapshot& getSnapshot() const noexcept {return snapshot;}
+};
\ No newline at end of file
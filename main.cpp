@@ -1,95 +1,143 @@
 ﻿#include <sstream>
-#include <iomanip>
 #include <algorithm>
-#include "directv.h"
-#include "player.h"
-#include "image.h"
-#include "world.h"
+#include "win32platform.h"
+#include "game.h"
+#include "hotreload.h"
+#include "renderqueue.h"
+#include "terrainlod.h"
+#include "minimap.h"
+#include "damage.h"
+#include "textbuffer.h"
 
 int WINAPI wWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, PWSTR pCmdLine, int nCmdShow)
 {
 	try
 	{
-		srand(time(0));
-
-		DirectV dv(hInstance, L"Terrain");
+		Win32Platform platform(hInstance, L"Terrain");
+		DirectV& dv = platform.getDirectV();
+		// Spelet ritas i ungefär denna upplösning och skalas upp med ett heltal till fönstret, så att det
+		// kostar lika mycket att rita oavsett skärmens storlek. 0 * 0 ritar i fönstrets upplösning.
+		const int internalWidth = 683;
+		const int internalHeight = 384;
+		dv.setInternalResolution(internalWidth, internalHeight);
 		Timer t(30.0);
 
-		SolidBrush blackBrush = dv.createSolidBrush(D2D1::ColorF(D2D1::ColorF::Black));
-		SolidBrush whiteBrush = dv.createSolidBrush(D2D1::ColorF(D2D1::ColorF::White));
+		const BrushHandle blackBrush = dv.addSolidBrush(D2D1::ColorF(D2D1::ColorF::Black));
+		const BrushHandle whiteBrush = dv.addSolidBrush(D2D1::ColorF(D2D1::ColorF::White));
 		Font font = dv.createFont(L"Consolas", 16.0f, L"sv-se");
-		images_t images;
-		loadImages(dv, images);
-
-		Player plr({10.0 * tileWidth, 0.0, 10.0 * tileTopHeight});
-		World world;
+		GlyphAtlas hudGlyphs = dv.createGlyphAtlas(font, D2D1::ColorF(D2D1::ColorF::White));
+		ThreadPool threadPool;
+		// Det som bara behövs under en frame tas från arenan, så att en vanlig frame inte allokerar från heapen.
+		FrameArena& frameArena = platform.getFrameArena();
+		Game game(threadPool, frameArena, static_cast<uint32_t>(time(0)));
+		World& world = game.getWorld();
+		RenderQueue renderQueue(frameArena);
+		TerrainLod terrainLod(world);
+		Minimap minimap(world, threadPool);
+		// Bilderna och världsfilen laddas om när de ändras. Om världsfilen finns ersätter den den slumpade världen.
+		HotReload hotReload(world, threadPool, "world.twd");
+		hotReload.wait(platform);
+		// Bara det som har ändrats sedan förra framen ritas om.
+		DamageTracker damage;
+		Point lastCentrePos = {0.0, 0.0};
+		float lastScreenScale = 0.0f;
+		TextBuffer<128> hudText;
+		unsigned ticksSinceHud = 0;
 
-		while (dv.windowExists() && !dv.keyDown(VK_ESCAPE))
+		// Tangenterna läses från plattformens kö en gång per tick.
+		InputState input;
+		while (true)
 		{
-			Direction d = DIR_NONE;
-			if (dv.keyDown('W'))
+			const KeySnapshot& keys = input.tick(platform.getInputQueue());
+			if (keys.keyDown(KEY_ESCAPE))
 			{
-				d = Direction(d | DIR_N);
+				break;
 			}
-			if (dv.keyDown('A'))
+			game.tick(keys);
+			const bool reloaded = hotReload.update(platform);
+
+			const bool minimapChanged = minimap.update(dv);
+
+			RenderTarget& target = platform.beginFrame();
+
+			// Med en intern upplösning är en tile alltid lika många pixlar, annars skalas den efter fönstret.
+			const float screenScale = (internalWidth > 0 ? 1.0f : sqrtf((dv.getWidth() * dv.getHeight()) / (1366.0f * 768.0f)) * 2.0f) * game.getZoom();
+			target.setScale(screenScale);
+
+			renderQueue.clear();
+			const TerrainLod::Detail detail = TerrainLod::detailFor(screenScale);
+			const Point centrePos = game.fillQueue(target, renderQueue, detail != TerrainLod::DETAIL_CHUNKS, detail == TerrainLod::DETAIL_FULL);
+
+			const double viewWidth = target.getEffWidth();
+			const double viewHeight = target.getEffHeight();
+			target.setScale(1.0f);
+
+			// Minikartan i övre högra hörnet, med en rektangel runt det som syns på skärmen.
+			const float mapWidth = 160.0f;
+			const float mapHeight = mapWidth * minimap.getDepth() / minimap.getWidth();
+			const float mapX = dv.getWidth() - mapWidth - 8.0f;
+			const float mapY = 27.0f;
+			const double mapWorldWidth = double(minimap.getWidth() << minimap.getLevel()) * tileWidth;
+			const double mapWorldDepth = double(minimap.getDepth() << minimap.getLevel()) * tileTopHeight;
+
+			// Om kameran har flyttats har allt flyttats, och om en bild har laddats om kan den synas överallt, så då ritas allt om.
+			damage.beginFrame(dv.getWidth(), dv.getHeight());
+			if (!dv.preservesFrame() || reloaded || detail == TerrainLod::DETAIL_CHUNKS || centrePos.x != lastCentrePos.x || centrePos.y != lastCentrePos.y || screenScale != lastScreenScale)
 			{
-				d = Direction(d | DIR_W);
+				damage.addAll();
 			}
-			if (dv.keyDown('S'))
+			lastCentrePos = centrePos;
+			lastScreenScale = screenScale;
+			damage.addQueue(renderQueue, screenScale);
+			if (minimapChanged)
 			{
-				d = Direction(d | DIR_S);
+				damage.add({int(mapX), int(mapY), int(mapX + mapWidth) + 1, int(mapY + mapHeight) + 1});
 			}
-			if (dv.keyDown('D'))
+			// Texten uppdateras två gånger per sekund, så att den inte behöver ritas om varje frame.
+			if (hudText.size() == 0 || ++ticksSinceHud >= 15)
 			{
-				d = Direction(d | DIR_E);
+				hudText.clear();
+				hudText.append(t.getFramerate(), 2).append(L" FPS    ");
+				hudText.append(damage.getRedrawnFraction() * 100.0, 0).append(L"% omritat");
+				hudText.append(L"    Tryck på escape för att avsluta.");
+				damage.resetStats();
+				damage.add({0, 0, dv.getWidth(), 19});
+				ticksSinceHud = 0;
 			}
-			plr.logic(d, world, dv);
-
-			dv.beginDraw();
-			dv.clear();
-
-			const float screenScale = sqrtf((dv.getWidth() * dv.getHeight()) / (1366.0f * 768.0f)) * 2.0f;
-			dv.scaleTransform(screenScale, screenScale, 0.0f, 0.0f);
-
-			const Point projectedPlayerPos = plr.pos.project() - Point{0.0, plr.image.getHeight() / 2.0};
-			const Point centrePos = {
-				std::clamp(projectedPlayerPos.x, dv.getEffWidth() / 2.0, world.getWidth() * tileWidth - dv.getEffWidth() / 2.0),
-				std::clamp(projectedPlayerPos.y, dv.getEffHeight() / 2.0, world.getDepth() * tileTopHeight - dv.getEffHeight() / 2.0)
-			};
-			int worldStartX = world.calculateStartX(centrePos, dv);
-			int worldEndX = world.calculateEndX(centrePos, dv);
-			for (int z = 0; z < world.getDepth(); z++)
+
+			for (const ScreenRect& r : damage.finishFrame())
 			{
-				int worldStartY = world.calculateStartY(centrePos, z, dv);
-				int worldEndY = world.calculateEndY(centrePos, z, dv);
-				for (int y = worldStartY; y < worldEndY; y++)
+				dv.pushClip(r.startX, r.startY, r.endX - r.startX, r.endY - r.startY);
+				dv.clear();
+
+				target.setScale(screenScale);
+				if (detail == TerrainLod::DETAIL_CHUNKS)
 				{
-					for (int x = worldStartX; x < worldEndX; x++)
-					{
-						world.drawTile(x, y, z, centrePos, dv, images);
-					}
-					if (z == floor(plr.pos.z / tileTopHeight) && y == floor(plr.pos.y / tileHeight))
-					{
-						plr.image.draw(
-							(dv.getEffWidth() - plr.image.getWidth()) / 2.0f - (centrePos.x - projectedPlayerPos.x),
-							(dv.getEffHeight() - plr.image.getHeight()) / 2.0f - (centrePos.y - projectedPlayerPos.y),
-							dv,
-							images
-						);
-					}
+					terrainLod.draw(centrePos, screenScale, dv);
 				}
-			}
-			
-			dv.scaleTransform(1.0f, 1.0f, 0.0f, 0.0f);
+				renderQueue.draw(target, r.startX / screenScale, r.startY / screenScale, (r.endX - r.startX) / screenScale, (r.endY - r.startY) / screenScale);
+				target.setScale(1.0f);
+
+				minimap.draw(mapX, mapY, mapWidth, mapHeight, dv);
+				dv.drawRectangle(
+					mapX + (centrePos.x - viewWidth / 2.0) / mapWorldWidth * mapWidth,
+					mapY + (centrePos.y - viewHeight / 2.0) / mapWorldDepth * mapHeight,
+					viewWidth / mapWorldWidth * mapWidth,
+					viewHeight / mapWorldDepth * mapHeight,
+					whiteBrush
+				);
 
-			dv.fillRectangle(0.0f, 0.0f, dv.getWidth(), 19.0f, blackBrush);
-			std::wstringstream ss;
-			ss << std::fixed << std::setprecision(2) << t.getFramerate();
-			ss << L" FPS    Tryck på escape för att avsluta.";
-			dv.drawText(0.0f, 1.0f, dv.getWidth(), 17.0, ss.str().c_str(), font, whiteBrush);
+				dv.fillRectangle(0.0f, 0.0f, dv.getWidth(), 19.0f, blackBrush);
+				dv.drawText(0.0f, 1.0f, hudText.c_str(), hudGlyphs, frameArena);
 
-			dv.endDraw();
-			dv.updateWindow();
+				dv.popClip();
+			}
+
+			platform.endFrame();
+			if (!platform.update())
+			{
+				break;
+			}
 			t.wait();
 		}
 	}
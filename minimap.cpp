@@ -0,0 +1,143 @@
+﻿#include <algorithm>
+#include "minimap.h"
+
+namespace
+{
+	// Höjderna i ett område plus en rad och en kolumn före det, som behövs för skuggningen.
+	struct Snapshot
+	{
+		TileRect rect;
+		std::vector<uint16_t> heights;
+	};
+
+	// Returnerar färgen för en höjd. Låga delar är gröna, sedan bruna och högst upp vita.
+	uint32_t heightColour(int height, int slope) noexcept
+	{
+		static constexpr int stops[][3] = {
+			{40, 110, 40},
+			{120, 170, 70},
+			{140, 110, 70},
+			{220, 220, 220}
+		};
+		constexpr int band = 16;
+		const int i = std::min(height / band, 2);
+		const int t = std::min(height - i * band, band);
+		// Sluttningar som vetter mot nordväst blir ljusare och de andra mörkare.
+		const int shade = 256 + std::clamp(slope, -8, 8) * 16;
+		uint32_t colour = 0xff000000;
+		for (int c = 0; c < 3; c++)
+		{
+			const int v = (stops[i][c] * (band - t) + stops[i + 1][c] * t) / band;
+			colour |= uint32_t(std::min(v * shade / 256, 255)) << (16 - c * 8);
+		}
+		return colour;
+	}
+}
+
+Minimap::Minimap(World& world, ThreadPool& threadPool, unsigned maxSize)
+	: world(world),
+	  threadPool(threadPool),
+	  dirtyRegions(world),
+	  level(0)
+{
+	const HeightPyramid& pyramid = world.getPyramid();
+	while (level + 1 < pyramid.getLevelCount() && std::max(pyramid.getLevelWidth(level), pyramid.getLevelDepth(level)) > maxSize)
+	{
+		level++;
+	}
+	width = pyramid.getLevelWidth(level);
+	depth = pyramid.getLevelDepth(level);
+	pixels.resize(std::size_t(width) * depth);
+	dirtyRegions.addAll();
+}
+
+bool Minimap::collect(DirectV& dv)
+{
+	std::vector<Patch> done;
+	{
+		std::lock_guard<std::mutex> lock(running->mutex);
+		if (!running->finished) return false;
+		done = std::move(running->done);
+	}
+	running.reset();
+
+	for (const Patch& patch : done)
+	{
+		const unsigned patchWidth = patch.rect.endX - patch.rect.startX;
+		for (int z = patch.rect.startZ; z < patch.rect.endZ; z++)
+		{
+			std::copy_n(&patch.pixels[(z - patch.rect.startZ) * patchWidth], patchWidth, &pixels[patch.rect.startX + z * width]);
+		}
+		if (bitmap)
+		{
+			bitmap->copyFromMemory(patch.rect.startX, patch.rect.startZ, patchWidth, patch.rect.endZ - patch.rect.startZ, &pixels[patch.rect.startX + patch.rect.startZ * width], width);
+		}
+	}
+	if (!bitmap && width > 0 && depth > 0)
+	{
+		bitmap = std::make_unique<Bitmap>(dv.createBitmap(width, depth, pixels.data()));
+	}
+	return !done.empty();
+}
+
+void Minimap::start()
+{
+	// Höjderna kopieras här, så att jobbet inte läser världen medan den ändras.
+	const HeightPyramid& pyramid = world.getPyramid();
+	std::vector<Snapshot> snapshots;
+	for (const TileRect& area : dirtyRegions.take())
+	{
+		// Skuggningen beror på cellen snett uppåt till vänster, så cellerna efter området påverkas också.
+		Snapshot s;
+		s.rect.startX = std::max(area.startX, 0) >> level;
+		s.rect.startZ = std::max(area.startZ, 0) >> level;
+		s.rect.endX = std::min(((area.endX - 1) >> level) + 2, int(width));
+		s.rect.endZ = std::min(((area.endZ - 1) >> level) + 2, int(depth));
+		if (s.rect.startX >= s.rect.endX || s.rect.startZ >= s.rect.endZ) continue;
+		for (int z = s.rect.startZ - 1; z < s.rect.endZ; z++)
+		{
+			for (int x = s.rect.startX - 1; x < s.rect.endX; x++)
+			{
+				// Utanför världen används kantens höjd.
+				s.heights.push_back(pyramid.cellAt(level, std::max(x, 0), std::max(z, 0)).max);
+			}
+		}
+		snapshots.push_back(std::move(s));
+	}
+	if (snapshots.empty()) return;
+
+	running = std::make_shared<Shared>();
+	threadPool.submit([shared = running, snapshots = std::move(snapshots)] {
+		std::vector<Patch> patches;
+		for (const Snapshot& s : snapshots)
+		{
+			const int stride = s.rect.endX - s.rect.startX + 1;
+			Patch patch = {s.rect, {}};
+			patch.pixels.reserve(std::size_t(stride - 1) * (s.rect.endZ - s.rect.startZ));
+			for (int z = 1; z <= s.rect.endZ - s.rect.startZ; z++)
+			{
+				for (int x = 1; x < stride; x++)
+				{
+					const int h = s.heights[x + z * stride];
+					patch.pixels.push_back(heightColour(h, h - s.heights[(x - 1) + (z - 1) * stride]));
+				}
+			}
+			patches.push_back(std::move(patch));
+		}
+		std::lock_guard<std::mutex> lock(shared->mutex);
+		shared->done = std::move(patches);
+		shared->finished = true;
+	});
+}
+
+bool Minimap::update(DirectV& dv)
+{
+	const bool changed = running && collect(dv);
+	if (!running && !dirtyRegions.empty()) start();
+	return changed;
+}
+
+void Minimap::draw(float x, float y, float width, float height, DirectV& dv)
+{
+	if (bitmap) dv.drawBitmap(x, y, width, height, *bitmap);
+}
\ No newline at end of file
@@ -0,0 +1,75 @@
+﻿#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "directv.h"
+#include "dirtyregions.h"
+#include "threadpool.h"
+#include "world.h"
+
+/*
+ * En karta över hela världen, färgad efter höjden. Varje pixel är en cell på en nivå i höjdpyramiden,
+ * vald så att kartan inte blir större än maxSize pixlar åt något håll.
+ *
+ * Kartan ritas i bakgrunden. update() kopierar höjderna i de områden som har ändrats sedan förra gången
+ * och lämnar dem till ett jobb i trådpoolen, och när jobbet är klart kopieras de nya pixlarna till
+ * bitmapen. Bara ett jobb körs åt gången, så ändringar som görs under tiden samlas ihop till nästa jobb.
+*/
+class Minimap
+{
+public:
+	static constexpr unsigned defaultMaxSize = 512;
+private:
+	// Ett område av kartan som har ritats om, i pixlar.
+	struct Patch
+	{
+		TileRect rect;
+		std::vector<uint32_t> pixels;
+	};
+	// Delas med jobbet, så att jobbet kan bli klart även om kartan har förstörts.
+	struct Shared
+	{
+		std::mutex mutex;
+		std::vector<Patch> done;
+		bool finished = false;
+	};
+
+	World& world;
+	ThreadPool& threadPool;
+	DirtyRegions dirtyRegions;
+	unsigned level;
+	unsigned width;
+	unsigned depth;
+	std::vector<uint32_t> pixels;
+	std::unique_ptr<Bitmap> bitmap;
+	std::shared_ptr<Shared> running;
+
+	// Tar hand om resultatet från ett klart jobb. Returnerar true om bitmapen har ändrats.
+	bool collect(DirectV& dv);
+	// Startar ett jobb för de områden som har ändrats.
+	void start();
+public:
+	Minimap(World& world, ThreadPool& threadPool, unsigned maxSize = defaultMaxSize);
+	// Väntar inte på jobbet, utan låter det bli klart i bakgrunden.
+	~Minimap() = default;
+
+	// Ingen kopiering.
+	Minimap(const Minimap&) = delete;
+	// Ingen kopiering.
+	Minimap& operator=(const Minimap&) = delete;
+
+	// Ska köras varje frame. Tiden beror på hur mycket av världen som har ändrats, inte på hur stor den är. Returnerar true om bitmapen har ändrats.
+	bool update(DirectV& dv);
+	// Ritar kartan, om den har hunnit ritas än.
+	void draw(float x, float y, float width, float height, DirectV& dv);
+
+	// Returnerar pyramidnivån som kartan använder. En pixel är 2^getLevel() tiles bred.
+	unsigned getLevel() const noexcept {return level;}
+	unsigned getWidth() const noexcept {return width;}
+	unsigned getDepth() const noexcept {return depth;}
+	// Returnerar kartans pixlar rad för rad i formatet 0xAARRGGBB. Uppdateras av update().
+	const std::vector<uint32_t>& getPixels() const noexcept {return pixels;}
+	// Returnerar bitmapen, eller nullptr om den inte har ritats än.
+	Bitmap* getBitmap() noexcept {return bitmap.get();}
+};
\ No newline at end of file
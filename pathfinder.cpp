@@ -0,0 +1,753 @@
+﻿#include <algorithm>
+#include <cstdlib>
+#include "heightqueries.h"
+#include "pathfinder.h"
+
+namespace
+{
+	struct Step
+	{
+		NeighbourBit bit;
+		int dx;
+		int dz;
+		uint32_t cost;
+	};
+	const Step steps[] = {
+		{NEIGHBOUR_N, 0, -1, Pathfinder::straightCost},
+		{NEIGHBOUR_S, 0, 1, Pathfinder::straightCost},
+		{NEIGHBOUR_E, 1, 0, Pathfinder::straightCost},
+		{NEIGHBOUR_W, -1, 0, Pathfinder::straightCost},
+		{NEIGHBOUR_NE, 1, -1, Pathfinder::diagonalCost},
+		{NEIGHBOUR_NW, -1, -1, Pathfinder::diagonalCost},
+		{NEIGHBOUR_SE, 1, 1, Pathfinder::diagonalCost},
+		{NEIGHBOUR_SW, -1, 1, Pathfinder::diagonalCost}
+	};
+
+	// Den kortaste möjliga kostnaden från (x, z) till goal om alla tiles gick att gå på.
+	uint32_t heuristic(int x, int z, TilePos goal) noexcept
+	{
+		const uint32_t dx = std::abs(x - goal.x);
+		const uint32_t dz = std::abs(z - goal.z);
+		return Pathfinder::straightCost * std::max(dx, dz) + (Pathfinder::diagonalCost - Pathfinder::straightCost) * std::min(dx, dz);
+	}
+
+	// Ordningen i den öppna listan: lägst uppskattning först, och vid lika den som har kommit längst.
+	struct OpenOrder
+	{
+		template <typename T>
+		bool operator()(const T& a, const T& b) const noexcept
+		{
+			return a.estimate > b.estimate || (a.estimate == b.estimate && a.cost < b.cost);
+		}
+	};
+
+	/*
+	 * Returnerar true om steget från (x, z) går att ta, som walkableNeighbours() men för ett enda steg. Båda
+	 * tilesen måste vara i världen.
+	*/
+	bool canTake(const Matrix<uint16_t>& heights, int x, int z, const Step& step) noexcept
+	{
+		const uint16_t from = heights[x][z];
+		if (heights[x + step.dx][z + step.dz] > from) return false;
+		return step.dx == 0 || step.dz == 0 || (heights[x + step.dx][z] <= from && heights[x][z + step.dz] <= from);
+	}
+
+	bool contains(TileRect rect, int x, int z) noexcept
+	{
+		return x >= rect.startX && z >= rect.startZ && x < rect.endX && z < rect.endZ;
+	}
+
+	/*
+	 * Returnerar true om det diagonala steget från (x, z) går och inte kan ersättas med två raka steg. Det
+	 * första raka steget går alltid när det diagonala gör det, så det andra avgör.
+	*/
+	bool diagonalOnly(const Matrix<uint16_t>& heights, int x, int z, const Step& step) noexcept
+	{
+		if (!(walkableNeighbours(heights, x, z) & step.bit)) return false;
+		const uint16_t to = heights[x + step.dx][z + step.dz];
+		return to > heights[x + step.dx][z] && to > heights[x][z + step.dz];
+	}
+}
+
+void PathGraph::Search::run(const Matrix<uint16_t>& heights, TileRect area, TilePos source, bool backward, TilePos target)
+{
+	bounds = area;
+	const int areaDepth = area.endZ - area.startZ;
+	std::fill(costs, costs + (area.endX - area.startX) * areaDepth, unreached);
+	open.clear();
+	expanded = 0;
+	const bool toTarget = !backward && contains(area, target.x, target.z);
+
+	const unsigned sourceLocal = local(source);
+	costs[sourceLocal] = 0;
+	parents[sourceLocal] = sourceLocal;
+	open.push_back({toTarget ? heuristic(source.x, source.z, target) : 0, 0, uint16_t(sourceLocal)});
+	while (!open.empty())
+	{
+		std::pop_heap(open.begin(), open.end(), OpenOrder());
+		const OpenEntry entry = open.back();
+		open.pop_back();
+		// Heuristiken är konsekvent, så den första posten för en tile har den lägsta kostnaden.
+		if (entry.cost != costs[entry.tile]) continue;
+		expanded++;
+		const int x = area.startX + entry.tile / areaDepth;
+		const int z = area.startZ + entry.tile % areaDepth;
+		if (toTarget && x == target.x && z == target.z) return;
+
+		for (const Step& step : steps)
+		{
+			// Bakåt går sökningen till de tiles som kan ta steget hit. Tilesen vid ett diagonalt steg ligger i samma rektangel.
+			const int nx = backward ? x - step.dx : x + step.dx;
+			const int nz = backward ? z - step.dz : z + step.dz;
+			if (!contains(area, nx, nz)) continue;
+			if (!(backward ? canTake(heights, nx, nz, step) : canTake(heights, x, z, step))) continue;
+			const unsigned neighbour = local({nx, nz});
+			const uint32_t cost = entry.cost + step.cost;
+			if (cost >= costs[neighbour]) continue;
+			costs[neighbour] = cost;
+			parents[neighbour] = entry.tile;
+			open.push_back({cost + (toTarget ? heuristic(nx, nz, target) : 0), cost, uint16_t(neighbour)});
+			std::push_heap(open.begin(), open.end(), OpenOrder());
+		}
+	}
+}
+
+void PathGraph::Search::appendPath(TilePos p, std::vector<TilePos>& path) const
+{
+	const std::size_t first = path.size();
+	const int areaDepth = bounds.endZ - bounds.startZ;
+	for (unsigned i = local(p); parents[i] != i; i = parents[i])
+	{
+		path.push_back({bounds.startX + int(i) / areaDepth, bounds.startZ + int(i) % areaDepth});
+	}
+	std::reverse(path.begin() + first, path.end());
+}
+
+PathGraph::PathGraph(World& world)
+	: world(world),
+	  dirtyRegions(world),
+	  width(world.getWidth()),
+	  depth(world.getDepth()),
+	  clustersX((width + clusterSize - 1) / clusterSize),
+	  clustersZ((depth + clusterSize - 1) / clusterSize),
+	  clusters(std::size_t(clustersX) * clustersZ),
+	  nodeSlots(std::size_t(width) * depth, noSlot),
+	  rebuiltClusters(0)
+{
+	const Matrix<uint16_t>& heights = world.getHeights();
+	for (int clusterX = 0; clusterX < clustersX; clusterX++)
+	{
+		for (int clusterZ = 0; clusterZ < clustersZ; clusterZ++)
+		{
+			rebuildCluster(heights, clusterX, clusterZ);
+		}
+	}
+}
+
+TileRect PathGraph::bounds(int clusterX, int clusterZ) const noexcept
+{
+	return {
+		clusterX * clusterSize,
+		clusterZ * clusterSize,
+		std::min((clusterX + 1) * clusterSize, width),
+		std::min((clusterZ + 1) * clusterSize, depth)
+	};
+}
+
+void PathGraph::addStraightCrossings(const Matrix<uint16_t>& heights, TilePos first, int alongX, int alongZ, int count, int step)
+{
+	const Step& s = steps[step];
+	// Början på gruppen som pågår, eller -1.
+	int groupStart = -1;
+	for (int i = 0; i <= count; i++)
+	{
+		const int x = first.x + alongX * i;
+		const int z = first.z + alongZ * i;
+		bool continues = false;
+		bool crosses = false;
+		if (i < count)
+		{
+			crosses = (walkableNeighbours(heights, x, z) & s.bit) != 0;
+			continues = crosses && groupStart >= 0 && heights[x][z] == heights[x - alongX][z - alongZ] &&
+				heights[x + s.dx][z + s.dz] == heights[x + s.dx - alongX][z + s.dz - alongZ];
+		}
+		if (continues) continue;
+		if (groupStart >= 0)
+		{
+			// Korta grupper får en nod i mitten och långa en i varje ände, så att vägarna inte behöver gå omvägar.
+			const int length = i - groupStart;
+			const int ends[2] = {length <= 5 ? groupStart + length / 2 : groupStart, i - 1};
+			for (int e = 0; e < (length <= 5 ? 1 : 2); e++)
+			{
+				const int fromX = first.x + alongX * ends[e];
+				const int fromZ = first.z + alongZ * ends[e];
+				crossings.push_back({uint32_t(fromX) * depth + fromZ, uint32_t(fromX + s.dx) * depth + (fromZ + s.dz), s.cost});
+			}
+		}
+		groupStart = crosses ? i : -1;
+	}
+}
+
+void PathGraph::findCrossings(const Matrix<uint16_t>& heights, int clusterX, int clusterZ)
+{
+	const TileRect b = bounds(clusterX, clusterZ);
+	const int clusterWidth = b.endX - b.startX;
+	const int clusterDepth = b.endZ - b.startZ;
+	// Stegen är i samma ordning som steps: N, S, E, W. Båda riktningarna över varje gräns.
+	if (b.startZ > 0)
+	{
+		addStraightCrossings(heights, {b.startX, b.startZ}, 1, 0, clusterWidth, 0);
+		addStraightCrossings(heights, {b.startX, b.startZ - 1}, 1, 0, clusterWidth, 1);
+	}
+	if (b.endZ < depth)
+	{
+		addStraightCrossings(heights, {b.startX, b.endZ - 1}, 1, 0, clusterWidth, 1);
+		addStraightCrossings(heights, {b.startX, b.endZ}, 1, 0, clusterWidth, 0);
+	}
+	if (b.endX < width)
+	{
+		addStraightCrossings(heights, {b.endX - 1, b.startZ}, 0, 1, clusterDepth, 2);
+		addStraightCrossings(heights, {b.endX, b.startZ}, 0, 1, clusterDepth, 3);
+	}
+	if (b.startX > 0)
+	{
+		addStraightCrossings(heights, {b.startX, b.startZ}, 0, 1, clusterDepth, 3);
+		addStraightCrossings(heights, {b.startX - 1, b.startZ}, 0, 1, clusterDepth, 2);
+	}
+
+	// Diagonala steg ut från och in till tilesen längs kanten.
+	for (int x = b.startX; x < b.endX; x++)
+	{
+		for (int z = b.startZ; z < b.endZ; z++)
+		{
+			if (x != b.startX && x != b.endX - 1 && z != b.startZ && z != b.endZ - 1) continue;
+			for (const Step& step : steps)
+			{
+				if (step.cost != Pathfinder::diagonalCost) continue;
+				const int outX = x + step.dx;
+				const int outZ = z + step.dz;
+				if (!contains(b, outX, outZ) && diagonalOnly(heights, x, z, step))
+				{
+					crossings.push_back({uint32_t(x) * depth + z, uint32_t(outX) * depth + outZ, step.cost});
+				}
+				const int inX = x - step.dx;
+				const int inZ = z - step.dz;
+				if (!contains(b, inX, inZ) && inX >= 0 && inZ >= 0 && inX < width && inZ < depth && diagonalOnly(heights, inX, inZ, step))
+				{
+					crossings.push_back({uint32_t(inX) * depth + inZ, uint32_t(x) * depth + z, step.cost});
+				}
+			}
+		}
+	}
+}
+
+void PathGraph::rebuildCluster(const Matrix<uint16_t>& heights, int clusterX, int clusterZ)
+{
+	rebuiltClusters++;
+	const TileRect b = bounds(clusterX, clusterZ);
+	auto inCluster = [&](uint32_t tile) {return contains(b, int(tile) / depth, int(tile) % depth);};
+	Cluster& cluster = clusters[std::size_t(clusterX) * clustersZ + clusterZ];
+	for (uint32_t tile : cluster.nodes)
+	{
+		nodeSlots[tile] = noSlot;
+	}
+	cluster.nodes.clear();
+	cluster.edges.clear();
+	cluster.edgeStart.clear();
+	cluster.incoming.clear();
+	cluster.incomingStart.clear();
+
+	crossings.clear();
+	findCrossings(heights, clusterX, clusterZ);
+	for (const Crossing& crossing : crossings)
+	{
+		cluster.nodes.push_back(inCluster(crossing.from) ? crossing.from : crossing.to);
+	}
+	std::sort(cluster.nodes.begin(), cluster.nodes.end());
+	cluster.nodes.erase(std::unique(cluster.nodes.begin(), cluster.nodes.end()), cluster.nodes.end());
+	std::sort(crossings.begin(), crossings.end(), [](const Crossing& a, const Crossing& b) {return a.from < b.from;});
+
+	auto crossing = crossings.begin();
+	for (std::size_t i = 0; i < cluster.nodes.size(); i++)
+	{
+		const uint32_t tile = cluster.nodes[i];
+		nodeSlots[tile] = uint16_t(i);
+		cluster.edgeStart.push_back(cluster.edges.size());
+		while (crossing != crossings.end() && crossing->from < tile) ++crossing;
+		for (; crossing != crossings.end() && crossing->from == tile; ++crossing)
+		{
+			cluster.edges.push_back({crossing->to, crossing->cost});
+		}
+		search.run(heights, b, {int(tile) / depth, int(tile) % depth}, false);
+		for (uint32_t other : cluster.nodes)
+		{
+			const uint32_t cost = search.cost({int(other) / depth, int(other) % depth});
+			if (other != tile && cost != Search::unreached) cluster.edges.push_back({other, cost});
+		}
+	}
+	cluster.edgeStart.push_back(cluster.edges.size());
+
+	// Kanterna till noderna är kanterna inom klustret åt andra hållet och stegen in från andra kluster.
+	crossings.erase(std::remove_if(crossings.begin(), crossings.end(), [&](const Crossing& c) {return inCluster(c.from);}), crossings.end());
+	for (std::size_t i = 0; i < cluster.nodes.size(); i++)
+	{
+		for (uint32_t e = cluster.edgeStart[i]; e < cluster.edgeStart[i + 1]; e++)
+		{
+			if (inCluster(cluster.edges[e].tile)) crossings.push_back({cluster.nodes[i], cluster.edges[e].tile, cluster.edges[e].cost});
+		}
+	}
+	std::sort(crossings.begin(), crossings.end(), [](const Crossing& a, const Crossing& b) {return a.to < b.to || (a.to == b.to && a.from < b.from);});
+	crossing = crossings.begin();
+	for (uint32_t tile : cluster.nodes)
+	{
+		cluster.incomingStart.push_back(cluster.incoming.size());
+		for (; crossing != crossings.end() && crossing->to == tile; ++crossing)
+		{
+			cluster.incoming.push_back({crossing->from, crossing->cost});
+		}
+	}
+	cluster.incomingStart.push_back(cluster.incoming.size());
+}
+
+void PathGraph::update()
+{
+	if (dirtyRegions.empty()) return;
+	const Matrix<uint16_t>& heights = world.getHeights();
+	std::vector<bool> rebuild(clusters.size(), false);
+	for (const TileRect& rect : dirtyRegions.take())
+	{
+		/*
+		 * Ett steg över en gräns beror bara på tilesen i rutan på 2 * 2 tiles runt steget, så det är bara
+		 * klustren som har en tile bredvid en ändrad tile som får andra noder eller kanter. Världen har redan
+		 * lagt till en tile runt det ändrade, så det räcker med klustren som rektangeln överlappar.
+		*/
+		const int startX = rect.startX / clusterSize;
+		const int startZ = rect.startZ / clusterSize;
+		const int endX = (rect.endX - 1) / clusterSize + 1;
+		const int endZ = (rect.endZ - 1) / clusterSize + 1;
+		for (int clusterX = startX; clusterX < endX; clusterX++)
+		{
+			for (int clusterZ = startZ; clusterZ < endZ; clusterZ++)
+			{
+				rebuild[std::size_t(clusterX) * clustersZ + clusterZ] = true;
+			}
+		}
+	}
+	for (int clusterX = 0; clusterX < clustersX; clusterX++)
+	{
+		for (int clusterZ = 0; clusterZ < clustersZ; clusterZ++)
+		{
+			if (rebuild[std::size_t(clusterX) * clustersZ + clusterZ]) rebuildCluster(heights, clusterX, clusterZ);
+		}
+	}
+}
+
+std::pair<const PathGraph::Edge*, const PathGraph::Edge*> PathGraph::edgesFrom(uint32_t tile) const noexcept
+{
+	const uint16_t slot = nodeSlots[tile];
+	if (slot == noSlot) return {nullptr, nullptr};
+	const Cluster& cluster = clusters[std::size_t(tile / depth / clusterSize) * clustersZ + tile % depth / clusterSize];
+	const Edge* edges = cluster.edges.data();
+	return {edges + cluster.edgeStart[slot], edges + cluster.edgeStart[slot + 1]};
+}
+
+std::pair<const PathGraph::Edge*, const PathGraph::Edge*> PathGraph::edgesTo(uint32_t tile) const noexcept
+{
+	const uint16_t slot = nodeSlots[tile];
+	if (slot == noSlot) return {nullptr, nullptr};
+	const Cluster& cluster = clusters[std::size_t(tile / depth / clusterSize) * clustersZ + tile % depth / clusterSize];
+	const Edge* edges = cluster.incoming.data();
+	return {edges + cluster.incomingStart[slot], edges + cluster.incomingStart[slot + 1]};
+}
+
+std::size_t PathGraph::getNodeCount() const noexcept
+{
+	std::size_t count = 0;
+	for (const Cluster& cluster : clusters) count += cluster.nodes.size();
+	return count;
+}
+
+std::size_t PathGraph::getEdgeCount() const noexcept
+{
+	std::size_t count = 0;
+	for (const Cluster& cluster : clusters) count += cluster.edges.size();
+	return count;
+}
+
+PathCache::PathCache(World& world, std::size_t capacity)
+	: dirtyRegions(world),
+	  capacity(capacity),
+	  hits(0),
+	  misses(0) {}
+
+uint64_t PathCache::key(TilePos start, TilePos goal) noexcept
+{
+	return uint64_t(uint16_t(start.x)) << 48 | uint64_t(uint16_t(start.z)) << 32 | uint64_t(uint16_t(goal.x)) << 16 | uint16_t(goal.z);
+}
+
+void PathCache::removeChanged()
+{
+	if (dirtyRegions.empty()) return;
+	for (const TileRect& rect : dirtyRegions.take())
+	{
+		for (auto it = entries.begin(); it != entries.end();)
+		{
+			const TileRect& b = it->bounds;
+			if (b.startX < rect.endX && rect.startX < b.endX && b.startZ < rect.endZ && rect.startZ < b.endZ)
+			{
+				index.erase(it->key);
+				it = entries.erase(it);
+			}
+			else
+			{
+				++it;
+			}
+		}
+	}
+}
+
+bool PathCache::find(TilePos start, TilePos goal, std::vector<TilePos>& path)
+{
+	removeChanged();
+	const auto found = index.find(key(start, goal));
+	if (found == index.end())
+	{
+		misses++;
+		return false;
+	}
+	entries.splice(entries.begin(), entries, found->second);
+	path = found->second->path;
+	hits++;
+	return true;
+}
+
+void PathCache::store(const std::vector<TilePos>& path)
+{
+	if (path.empty() || capacity == 0) return;
+	removeChanged();
+
+	// Ett steg beror bara på höjderna i rektangeln mellan dess två tiles, så vägen beror bara på rektangeln runt den.
+	TileRect bounds = {path[0].x, path[0].z, path[0].x + 1, path[0].z + 1};
+	for (const TilePos& p : path)
+	{
+		bounds.startX = std::min(bounds.startX, p.x);
+		bounds.startZ = std::min(bounds.startZ, p.z);
+		bounds.endX = std::max(bounds.endX, p.x + 1);
+		bounds.endZ = std::max(bounds.endZ, p.z + 1);
+	}
+
+	const uint64_t k = key(path.front(), path.back());
+	const auto found = index.find(k);
+	if (found != index.end())
+	{
+		found->second->bounds = bounds;
+		found->second->path = path;
+		entries.splice(entries.begin(), entries, found->second);
+		return;
+	}
+	if (entries.size() >= capacity)
+	{
+		index.erase(entries.back().key);
+		entries.pop_back();
+	}
+	entries.push_front({k, bounds, path});
+	index[k] = entries.begin();
+}
+
+void PathCache::clear() noexcept
+{
+	entries.clear();
+	index.clear();
+	dirtyRegions.take();
+}
+
+Pathfinder::Pathfinder(unsigned maxExpanded)
+	: floodNext(0),
+	  generation(0),
+	  maxExpanded(maxExpanded),
+	  lastExpanded(0) {}
+
+Pathfinder::Node& Pathfinder::node(uint32_t index) noexcept
+{
+	Node& n = nodes[index];
+	if (n.generation != generation) n = {generation, UINT32_MAX, UINT32_MAX, false, false};
+	return n;
+}
+
+void Pathfinder::beginSearch(std::size_t nodeCount)
+{
+	if (nodes.size() != nodeCount)
+	{
+		nodes.assign(nodeCount, {0, 0, 0, false, false});
+		generation = 0;
+	}
+	// Efter att generationen har slagit runt kan gamla noder ha samma generation, så alla nollställs.
+	if (++generation == 0)
+	{
+		for (Node& n : nodes) n.generation = 0;
+		generation = 1;
+	}
+	open.clear();
+}
+
+Pathfinder::FloodResult Pathfinder::floodStep(const Matrix<uint16_t>& heights, uint32_t startIndex)
+{
+	if (floodNext >= flood.size()) return FLOOD_EXHAUSTED;
+	if (floodNext >= maxFlood) return FLOOD_STOPPED;
+	const int depth = heights.getHeight();
+	const int x = flood[floodNext] / depth;
+	const int z = flood[floodNext] % depth;
+	floodNext++;
+	for (const Step& step : steps)
+	{
+		// Grannen på andra sidan steget kan gå hit om den har steget i sin mask.
+		const int nx = x - step.dx;
+		const int nz = z - step.dz;
+		if (!(walkableNeighbours(heights, nx, nz) & step.bit)) continue;
+		const uint32_t neighbourIndex = uint32_t(nx) * depth + nz;
+		if (neighbourIndex == startIndex) return FLOOD_STOPPED;
+		Node& neighbour = node(neighbourIndex);
+		if (neighbour.flooded) continue;
+		neighbour.flooded = true;
+		flood.push_back(neighbourIndex);
+	}
+	return floodNext < flood.size() ? FLOOD_CONTINUE : FLOOD_EXHAUSTED;
+}
+
+Pathfinder::Status Pathfinder::findPath(const Matrix<uint16_t>& heights, TilePos start, TilePos goal, std::vector<TilePos>& path, PathCache* cache, PathGraph* graph)
+{
+	path.clear();
+	lastExpanded = 0;
+	const int width = heights.getWidth();
+	const int depth = heights.getHeight();
+	auto inside = [&](TilePos p) -> bool {return p.x >= 0 && p.z >= 0 && p.x < width && p.z < depth;};
+	if (!inside(start) || !inside(goal)) return INVALID;
+	if (start == goal)
+	{
+		path.push_back(start);
+		return FOUND;
+	}
+	// Nycklarna i cachen har 16 bitar per koordinat.
+	if (width > 0x10000 || depth > 0x10000) cache = nullptr;
+	if (cache && cache->find(start, goal, path)) return FOUND;
+
+	if (graph && graph->matches(heights) && std::max(std::abs(goal.x - start.x), std::abs(goal.z - start.z)) >= minHierarchicalDistance)
+	{
+		graph->update();
+		const Status status = findGraphPath(heights, start, goal, path, *graph);
+		if (cache && status == FOUND) cache->store(path);
+		return status;
+	}
+
+	beginSearch(std::size_t(width) * depth);
+
+	const uint32_t startIndex = uint32_t(start.x) * depth + start.z;
+	const uint32_t goalIndex = uint32_t(goal.x) * depth + goal.z;
+	node(startIndex).cost = 0;
+	open.push_back({heuristic(start.x, start.z, goal), 0, startIndex});
+	flood.clear();
+	flood.push_back(goalIndex);
+	floodNext = 0;
+	node(goalIndex).flooded = true;
+	bool flooding = true;
+	while (!open.empty())
+	{
+		if (flooding)
+		{
+			const FloodResult result = floodStep(heights, startIndex);
+			if (result == FLOOD_EXHAUSTED) return UNREACHABLE;
+			flooding = result == FLOOD_CONTINUE;
+		}
+
+		std::pop_heap(open.begin(), open.end(), OpenOrder());
+		const OpenEntry entry = open.back();
+		open.pop_back();
+		Node& current = nodes[entry.node];
+		// En nod läggs till igen när en kortare väg till den hittas, och de gamla posterna hoppas över.
+		if (current.closed || entry.cost != current.cost) continue;
+		current.closed = true;
+
+		if (entry.node == goalIndex)
+		{
+			for (uint32_t i = goalIndex; i != UINT32_MAX; i = nodes[i].parent)
+			{
+				path.push_back({int(i / depth), int(i % depth)});
+			}
+			std::reverse(path.begin(), path.end());
+			if (cache) cache->store(path);
+			return FOUND;
+		}
+		if (++lastExpanded > maxExpanded) return GAVE_UP;
+
+		const int x = entry.node / depth;
+		const int z = entry.node % depth;
+		const unsigned char mask = walkableNeighbours(heights, x, z);
+		for (const Step& step : steps)
+		{
+			if (!(mask & step.bit)) continue;
+			const int nx = x + step.dx;
+			const int nz = z + step.dz;
+			const uint32_t neighbourIndex = uint32_t(nx) * depth + nz;
+			Node& neighbour = node(neighbourIndex);
+			const uint32_t cost = entry.cost + step.cost;
+			if (neighbour.closed || cost >= neighbour.cost) continue;
+			neighbour.cost = cost;
+			neighbour.parent = entry.node;
+			open.push_back({cost + heuristic(nx, nz, goal), cost, neighbourIndex});
+			std::push_heap(open.begin(), open.end(), OpenOrder());
+		}
+	}
+	return UNREACHABLE;
+}
+
+Pathfinder::FloodResult Pathfinder::floodGraphStep(const PathGraph& graph, int depth, TileRect startBounds)
+{
+	if (floodNext >= flood.size()) return FLOOD_EXHAUSTED;
+	if (floodNext >= maxGraphFlood) return FLOOD_STOPPED;
+	const auto edges = graph.edgesTo(flood[floodNext++]);
+	for (const PathGraph::Edge* edge = edges.first; edge != edges.second; ++edge)
+	{
+		const TilePos p = {int(edge->tile) / depth, int(edge->tile) % depth};
+		if (contains(startBounds, p.x, p.z) && startSearch.cost(p) != PathGraph::Search::unreached) return FLOOD_STOPPED;
+		Node& n = node(edge->tile);
+		if (n.flooded) continue;
+		n.flooded = true;
+		flood.push_back(edge->tile);
+	}
+	return floodNext < flood.size() ? FLOOD_CONTINUE : FLOOD_EXHAUSTED;
+}
+
+Pathfinder::Status Pathfinder::findGraphPath(const Matrix<uint16_t>& heights, TilePos start, TilePos goal, std::vector<TilePos>& path, PathGraph& graph)
+{
+	const int depth = heights.getHeight();
+	const TileRect startBounds = graph.clusterBounds(start);
+	const TileRect goalBounds = graph.clusterBounds(goal);
+	startSearch.run(heights, startBounds, start, false);
+	goalSearch.run(heights, goalBounds, goal, true);
+	lastExpanded = startSearch.getExpanded() + goalSearch.getExpanded();
+	beginSearch(std::size_t(heights.getWidth()) * depth);
+
+	/*
+	 * En väg till målet från ett annat kluster kommer sist in i målets kluster över en gräns, och tilen
+	 * där når en nod i klustret. Floodingen bakåt börjar därför i noderna som når målet, och om det inte
+	 * finns några finns det ingen väg. På samma sätt måste start nå någon nod.
+	*/
+	flood.clear();
+	floodNext = 0;
+	bool startReachesNode = false;
+	for (uint32_t tile : graph.clusterNodes(start))
+	{
+		startReachesNode |= startSearch.cost({int(tile) / depth, int(tile) % depth}) != PathGraph::Search::unreached;
+	}
+	for (uint32_t tile : graph.clusterNodes(goal))
+	{
+		if (goalSearch.cost({int(tile) / depth, int(tile) % depth}) == PathGraph::Search::unreached) continue;
+		node(tile).flooded = true;
+		flood.push_back(tile);
+	}
+	if (!startReachesNode || flood.empty()) return UNREACHABLE;
+
+	const uint32_t startIndex = uint32_t(start.x) * depth + start.z;
+	const uint32_t goalIndex = uint32_t(goal.x) * depth + goal.z;
+	node(startIndex).cost = 0;
+	open.push_back({heuristic(start.x, start.z, goal), 0, startIndex});
+	auto relax = [&](uint32_t from, uint32_t to, uint32_t cost) {
+		Node& n = node(to);
+		if (n.closed || cost >= n.cost) return;
+		n.cost = cost;
+		n.parent = from;
+		open.push_back({cost + heuristic(int(to) / depth, int(to) % depth, goal), cost, to});
+		std::push_heap(open.begin(), open.end(), OpenOrder());
+	};
+
+	unsigned expandedNodes = 0;
+	bool flooding = true;
+	while (!open.empty())
+	{
+		if (flooding)
+		{
+			const FloodResult result = floodGraphStep(graph, depth, startBounds);
+			if (result == FLOOD_EXHAUSTED)
+			{
+				lastExpanded += expandedNodes;
+				return UNREACHABLE;
+			}
+			flooding = result == FLOOD_CONTINUE;
+		}
+
+		std::pop_heap(open.begin(), open.end(), OpenOrder());
+		const OpenEntry entry = open.back();
+		open.pop_back();
+		Node& current = nodes[entry.node];
+		if (current.closed || entry.cost != current.cost) continue;
+		current.closed = true;
+		if (entry.node == goalIndex) break;
+		if (++expandedNodes > maxExpanded)
+		{
+			lastExpanded += expandedNodes;
+			return GAVE_UP;
+		}
+
+		const TilePos p = {int(entry.node) / depth, int(entry.node) % depth};
+		// Start och mål är inte noder i grafen, så de kopplas till noderna i sina kluster här.
+		if (entry.node == startIndex)
+		{
+			for (uint32_t tile : graph.clusterNodes(start))
+			{
+				const uint32_t cost = startSearch.cost({int(tile) / depth, int(tile) % depth});
+				if (cost != PathGraph::Search::unreached) relax(entry.node, tile, cost);
+			}
+		}
+		const auto edges = graph.edgesFrom(entry.node);
+		for (const PathGraph::Edge* edge = edges.first; edge != edges.second; ++edge)
+		{
+			relax(entry.node, edge->tile, entry.cost + edge->cost);
+		}
+		if (contains(goalBounds, p.x, p.z))
+		{
+			const uint32_t cost = goalSearch.cost(p);
+			if (cost != PathGraph::Search::unreached) relax(entry.node, goalIndex, entry.cost + cost);
+		}
+	}
+	lastExpanded += expandedNodes;
+	if (!node(goalIndex).closed) return UNREACHABLE;
+
+	graphPath.clear();
+	for (uint32_t i = goalIndex; i != UINT32_MAX; i = nodes[i].parent)
+	{
+		graphPath.push_back(i);
+	}
+	std::reverse(graphPath.begin(), graphPath.end());
+
+	/*
+	 * Varje del av vägen genom grafen ligger i ett kluster, så en sökning inom klustren som några tiles i
+	 * rad ligger i hittar alltid en väg mellan dem, och den får gå över gränserna var som helst.
+	*/
+	path.push_back(start);
+	std::size_t from = 0;
+	while (from + 1 < graphPath.size())
+	{
+		TileRect window = graph.clusterBounds({int(graphPath[from]) / depth, int(graphPath[from]) % depth});
+		std::size_t to = from;
+		while (to + 1 < graphPath.size())
+		{
+			const TileRect next = graph.clusterBounds({int(graphPath[to + 1]) / depth, int(graphPath[to + 1]) % depth});
+			const TileRect merged = {
+				std::min(window.startX, next.startX),
+				std::min(window.startZ, next.startZ),
+				std::max(window.endX, next.endX),
+				std::max(window.endZ, next.endZ)
+			};
+			if (merged.endX - merged.startX > 2 * PathGraph::clusterSize || merged.endZ - merged.startZ > 2 * PathGraph::clusterSize) break;
+			window = merged;
+			to++;
+		}
+		const TilePos fromPos = {int(graphPath[from]) / depth, int(graphPath[from]) % depth};
+		const TilePos toPos = {int(graphPath[to]) / depth, int(graphPath[to]) % depth};
+		refineSearch.run(heights, window, fromPos, false, toPos);
+		refineSearch.appendPath(toPos, path);
+		lastExpanded += refineSearch.getExpanded();
+		from = to;
+	}
+	return FOUND;
+}
\ No newline at end of file
@@ -0,0 +1,306 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "dirtyregions.h"
+#include "matrix.h"
+#include "world.h"
+
+// En tile i världen.
+struct TilePos
+{
+	int x;
+	int z;
+
+	bool operator==(TilePos o) const noexcept {return x == o.x && z == o.z;}
+	bool operator!=(TilePos o) const noexcept {return !(*this == o);}
+};
+
+/*
+ * Sparar vägar som har hittats, så att samma väg inte behöver sökas igen. När det blir fullt tas den väg
+ * som användes för längst sedan bort. Cachen har en egen DirtyRegions och tar bort de vägar vars
+ * rektangel överlappar något som har ändrats i världen. Vägar som fortfarande går att gå behålls, även
+ * om ändringen har gjort en kortare väg möjlig. Den är inte trådsäker.
+*/
+class PathCache
+{
+private:
+	struct Entry
+	{
+		uint64_t key;
+		TileRect bounds; // Tilesen som vägen beror på.
+		std::vector<TilePos> path;
+	};
+	DirtyRegions dirtyRegions;
+	std::list<Entry> entries; // Den senast använda först.
+	std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+	std::size_t capacity;
+	unsigned hits;
+	unsigned misses;
+
+	// Tar bort vägarna som går genom något som har ändrats sedan förra gången.
+	void removeChanged();
+	// Returnerar nyckeln för vägen från start till goal. Koordinaterna måste vara mindre än 65536.
+	static uint64_t key(TilePos start, TilePos goal) noexcept;
+public:
+	static constexpr std::size_t defaultCapacity = 1024;
+
+	explicit PathCache(World& world, std::size_t capacity = defaultCapacity);
+
+	// Ingen kopiering.
+	PathCache(const PathCache&) = delete;
+	// Ingen kopiering.
+	PathCache& operator=(const PathCache&) = delete;
+
+	// Kopierar en sparad väg från start till goal till path. Returnerar false om ingen finns.
+	bool find(TilePos start, TilePos goal, std::vector<TilePos>& path);
+	// Sparar en väg. Den första tilen i path måste vara start och den sista goal.
+	void store(const std::vector<TilePos>& path);
+	// Glömmer alla vägar.
+	void clear() noexcept;
+
+	std::size_t size() const noexcept {return entries.size();}
+	unsigned getHits() const noexcept {return hits;}
+	unsigned getMisses() const noexcept {return misses;}
+};
+
+/*
+ * En grov graf över världen för långa vägar, som i HPA*. Världen delas i kluster med clusterSize *
+ * clusterSize tiles. Noderna är tiles vid klustrens kanter där man kan gå över till ett grannkluster, och
+ * kanterna är stegen över gränserna och de kortaste vägarna mellan två noder i samma kluster.
+ *
+ * Raka steg över en gräns som ligger bredvid varandra slås ihop så länge tilesen på var sida är lika
+ * höga, eftersom man då kan gå längs gränsen mellan dem åt båda hållen, och bara en eller två av dem blir
+ * noder. Ett diagonalt steg över en gräns blir bara en kant när det inte går att ta två raka steg
+ * istället. Därför når grafen samma tiles som en sökning över alla tiles, men en väg genom den kan bli
+ * lite längre än den kortaste.
+ *
+ * Grafen byggs från världens höjder och har en egen DirtyRegions. update() bygger om klustren runt det
+ * som har ändrats. Den är inte trådsäker.
+*/
+class PathGraph
+{
+public:
+	static constexpr int clusterSize = 16;
+
+	struct Edge
+	{
+		uint32_t tile; // Tilen som kanten går till, som index i höjdmatrisen (x * djup + z).
+		uint32_t cost;
+	};
+
+	/*
+	 * Dijkstra inom ett eller några kluster, framåt från en tile eller bakåt till den. Används för att
+	 * bygga grafen, för att koppla start och mål till den och för att fylla i vägarna mellan noderna.
+	*/
+	class Search
+	{
+	public:
+		static constexpr uint32_t unreached = UINT32_MAX;
+	private:
+		struct OpenEntry
+		{
+			uint32_t estimate;
+			uint32_t cost;
+			uint16_t tile;
+		};
+		TileRect bounds;
+		uint32_t costs[4 * clusterSize * clusterSize];
+		uint16_t parents[4 * clusterSize * clusterSize];
+		std::vector<OpenEntry> open;
+		unsigned expanded;
+
+		// Returnerar indexet för p i costs och parents.
+		unsigned local(TilePos p) const noexcept {return (p.x - bounds.startX) * (bounds.endZ - bounds.startZ) + (p.z - bounds.startZ);}
+	public:
+		/*
+		 * Söker inom area, som får vara högst 2 * 2 kluster stor, från source till alla tiles
+		 * eller om backward är true från alla tiles till source. Om target ligger i area söks det framåt med
+		 * A* tills target nås, och då gäller bara kostnaden till target.
+		*/
+		void run(const Matrix<uint16_t>& heights, TileRect area, TilePos source, bool backward, TilePos target = {-1, -1});
+		// Returnerar kostnaden mellan source och p, eller unreached. p måste ligga i area.
+		uint32_t cost(TilePos p) const noexcept {return costs[local(p)];}
+		// Lägger till vägen från source till p, utan source, sist i path. Bara efter en sökning framåt.
+		void appendPath(TilePos p, std::vector<TilePos>& path) const;
+		// Returnerar antalet tiles som den senaste sökningen gick igenom.
+		unsigned getExpanded() const noexcept {return expanded;}
+	};
+private:
+	struct Cluster
+	{
+		std::vector<uint32_t> nodes; // Som index i höjdmatrisen, sorterade.
+		std::vector<uint32_t> edgeStart; // Var varje nods kanter börjar i edges. Har en extra plats på slutet.
+		std::vector<Edge> edges;
+		// Kanterna till varje nod, där Edge::tile är den tile som kanten kommer från.
+		std::vector<uint32_t> incomingStart;
+		std::vector<Edge> incoming;
+	};
+	// Ett steg över en klustergräns.
+	struct Crossing
+	{
+		uint32_t from;
+		uint32_t to;
+		uint32_t cost;
+	};
+	static constexpr uint16_t noSlot = UINT16_MAX;
+
+	World& world;
+	DirtyRegions dirtyRegions;
+	int width;
+	int depth;
+	int clustersX;
+	int clustersZ;
+	std::vector<Cluster> clusters;
+	std::vector<uint16_t> nodeSlots; // Tile -> index i klustrets nodes, eller noSlot.
+	std::vector<Crossing> crossings; // Används av rebuildCluster().
+	Search search;
+	unsigned rebuiltClusters;
+
+	// Returnerar tilesen i klustret (clusterX, clusterZ).
+	TileRect bounds(int clusterX, int clusterZ) const noexcept;
+	// Lägger alla steg över gränserna in till och ut från klustret i crossings.
+	void findCrossings(const Matrix<uint16_t>& heights, int clusterX, int clusterZ);
+	/*
+	 * Lägger de raka stegen från count tiles, från first och framåt med (alongX, alongZ), till tilen
+	 * bredvid i riktningen step i crossings. Bara en eller två per grupp som kan slås ihop.
+	*/
+	void addStraightCrossings(const Matrix<uint16_t>& heights, TilePos first, int alongX, int alongZ, int count, int step);
+	// Bygger om noderna och kanterna i ett kluster.
+	void rebuildCluster(const Matrix<uint16_t>& heights, int clusterX, int clusterZ);
+public:
+	explicit PathGraph(World& world);
+
+	// Ingen kopiering.
+	PathGraph(const PathGraph&) = delete;
+	// Ingen kopiering.
+	PathGraph& operator=(const PathGraph&) = delete;
+
+	// Bygger om klustren som påverkas av det som har ändrats i världen sedan förra gången.
+	void update();
+
+	// Returnerar tilesen i klustret som p ligger i.
+	TileRect clusterBounds(TilePos p) const noexcept {return bounds(p.x / clusterSize, p.z / clusterSize);}
+	// Returnerar noderna i klustret som p ligger i, som index i höjdmatrisen.
+	const std::vector<uint32_t>& clusterNodes(TilePos p) const noexcept {return clusters[p.x / clusterSize * clustersZ + p.z / clusterSize].nodes;}
+	// Returnerar kanterna från en tile, som index i höjdmatrisen. Tom om tilen inte är en nod.
+	std::pair<const Edge*, const Edge*> edgesFrom(uint32_t tile) const noexcept;
+	// Returnerar kanterna till en tile, med tilen som de kommer från. Tom om tilen inte är en nod.
+	std::pair<const Edge*, const Edge*> edgesTo(uint32_t tile) const noexcept;
+	// Returnerar true om grafen är byggd för en höjdmatris av samma storlek som heights.
+	bool matches(const Matrix<uint16_t>& heights) const noexcept {return int(heights.getWidth()) == width && int(heights.getHeight()) == depth;}
+
+	std::size_t getNodeCount() const noexcept;
+	std::size_t getEdgeCount() const noexcept;
+	// Returnerar antalet kluster som har byggts om sedan grafen skapades, inklusive det första bygget.
+	unsigned getRebuiltClusters() const noexcept {return rebuiltClusters;}
+};
+
+/*
+ * Hittar den kortaste vägen mellan två tiles med A*. Grannarna tas från walkableNeighbours() i
+ * heightqueries.h, så en aktör kan gå till tiles som är lika höga eller lägre men aldrig uppåt, och
+ * diagonala steg skär aldrig hörn. Raka steg kostar straightCost och diagonala diagonalCost.
+ *
+ * Noderna och den öppna listan sparas mellan sökningarna och varje nod har en generation, så en
+ * sökning behöver varken nollställa något eller allokera när den inte är större än de tidigare.
+ * Med en PathGraph söks vägar mellan tiles som ligger minst minHierarchicalDistance tiles ifrån
+ * varandra i den istället, vilket är mycket snabbare men kan ge lite längre vägar.
+ * Sökningen läser bara höjdmatrisen, så den kan köras på en kopia i en annan tråd. Varje tråd
+ * behöver en egen Pathfinder.
+*/
+class Pathfinder
+{
+public:
+	enum Status
+	{
+		FOUND,
+		UNREACHABLE, // Det finns ingen väg.
+		GAVE_UP,     // Sökningen gick igenom maxExpanded tiles utan att hitta målet.
+		INVALID      // Start eller mål är utanför världen.
+	};
+	static constexpr uint32_t straightCost = 100;
+	static constexpr uint32_t diagonalCost = 141;
+	static constexpr unsigned defaultMaxExpanded = 1 << 16;
+	// Så många tiles som floodStep() går igenom innan den ger upp.
+	static constexpr unsigned maxFlood = 1024;
+	// Så många noder som floodGraphStep() går igenom innan den ger upp.
+	static constexpr unsigned maxGraphFlood = 256;
+	// Vägar där start och mål ligger så här långt ifrån varandra i x eller z söks i en PathGraph.
+	static constexpr int minHierarchicalDistance = 2 * PathGraph::clusterSize;
+private:
+	enum FloodResult
+	{
+		FLOOD_CONTINUE,
+		FLOOD_EXHAUSTED, // Alla tiles som kan gå till målet har gåtts igenom.
+		FLOOD_STOPPED    // Start har hittats eller maxFlood har nåtts.
+	};
+	struct Node
+	{
+		uint32_t generation; // Resten av noden gäller bara om den är samma som Pathfinder::generation.
+		uint32_t cost;
+		uint32_t parent;
+		bool closed;
+		bool flooded; // Nådd av floodStep().
+	};
+	struct OpenEntry
+	{
+		uint32_t estimate; // cost plus heuristiken.
+		uint32_t cost;
+		uint32_t node;
+	};
+	std::vector<Node> nodes;
+	std::vector<OpenEntry> open; // En binär heap.
+	std::vector<uint32_t> flood; // Tiles som floodStep() har nått, i den ordning de ska gås igenom.
+	std::size_t floodNext;
+	PathGraph::Search startSearch;
+	PathGraph::Search goalSearch;
+	PathGraph::Search refineSearch;
+	std::vector<uint32_t> graphPath; // Tilesen som en sökning i en PathGraph gick genom.
+	uint32_t generation;
+	unsigned maxExpanded;
+	unsigned lastExpanded;
+
+	// Returnerar noden, nollställd om den inte har rörts i den här sökningen.
+	Node& node(uint32_t index) noexcept;
+	// Börjar en ny sökning med en nod per tile.
+	void beginSearch(std::size_t nodeCount);
+	/*
+	 * Går ett steg bakåt från målet, till de tiles som kan gå till den senast nådda tilen. Körs ett steg per
+	 * steg i A*. Om alla tiles som kan nå målet har gåtts igenom utan att start hittades finns det ingen
+	 * väg, så ett mål på en platå som man inte kan gå upp på upptäcks lika snabbt som en start i en grop,
+	 * istället för att A* går igenom allt som går att nå från start först.
+	*/
+	FloodResult floodStep(const Matrix<uint16_t>& heights, uint32_t startIndex);
+	/*
+	 * Som floodStep(), men bakåt genom noderna i graph. Stannar när den når en nod som start når i sitt
+	 * kluster enligt startSearch.
+	*/
+	FloodResult floodGraphStep(const PathGraph& graph, int depth, TileRect startBounds);
+	/*
+	 * Söker med A* i graph från start till goal, som ligger i olika kluster, och fyller sedan i vägen mellan
+	 * noderna med sökningar inom högst 2 * 2 kluster i taget, så att vägen inte behöver gå genom just de
+	 * tiles som är noder.
+	*/
+	Status findGraphPath(const Matrix<uint16_t>& heights, TilePos start, TilePos goal, std::vector<TilePos>& path, PathGraph& graph);
+public:
+	explicit Pathfinder(unsigned maxExpanded = defaultMaxExpanded);
+
+	// Ingen kopiering.
+	Pathfinder(const Pathfinder&) = delete;
+	// Ingen kopiering.
+	Pathfinder& operator=(const Pathfinder&) = delete;
+
+	/*
+	 * Söker efter en väg från start till goal och skriver den till path, med start först och goal sist.
+	 * Om inget hittas blir path tom. Om cache inte är nullptr letas vägen först upp där, och en väg som
+	 * hittas sparas i den. Om graph inte är nullptr och byggd från heights söks långa vägar i den.
+	*/
+	Status findPath(const Matrix<uint16_t>& heights, TilePos start, TilePos goal, std::vector<TilePos>& path, PathCache* cache = nullptr, PathGraph* graph = nullptr);
+
+	// Returnerar antalet tiles som den senaste sökningen gick igenom, med en PathGraph även noderna. 0 om vägen fanns i cachen.
+	unsigned getLastExpanded() const noexcept {return lastExpanded;}
+	void setMaxExpanded(unsigned maxExpanded) noexcept {this->maxExpanded = maxExpanded;}
+};
\ No newline at end of file
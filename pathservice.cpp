@@ -0,0 +1,196 @@
+﻿#include "pathservice.h"
+
+namespace
+{
+	// Returnerar tiden sedan start i millisekunder.
+	double millisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+}
+
+PathService::PathService(World& world, ThreadPool& threadPool, unsigned maxBatches)
+	: world(world),
+	  threadPool(threadPool),
+	  dirtyRegions(world),
+	  cache(world),
+	  snapshotVersion(0),
+	  nextID(1),
+	  tick(0),
+	  batchSize(defaultBatchSize),
+	  maxBatches(maxBatches > 0 ? maxBatches : std::max(threadPool.getThreadCount(), 1u)),
+	  batchBudget(defaultBatchBudget),
+	  updateBudget(defaultUpdateBudget),
+	  delivered(0),
+	  cacheHits(0),
+	  requeued(0),
+	  totalLatency(0.0),
+	  maxLatency(0.0),
+	  totalLatencyTicks(0),
+	  maxLatencyTicks(0),
+	  lastUpdateTime(0.0),
+	  lastWorkTime(0.0) {}
+
+PathRequestID PathService::request(TilePos start, TilePos goal)
+{
+	const PathRequestID id = nextID;
+	// 0 hoppas över när id:na slår runt.
+	if (++nextID == 0) nextID = 1;
+	queue.push_back({id, start, goal, tick, Clock::now()});
+	return id;
+}
+
+void PathService::deliver(const Request& request, Pathfinder::Status status, std::vector<TilePos>&& path)
+{
+	const double latency = millisecondsSince(request.time);
+	const unsigned latencyTicks = tick - request.tick;
+	totalLatency += latency;
+	maxLatency = std::max(maxLatency, latency);
+	totalLatencyTicks += latencyTicks;
+	maxLatencyTicks = std::max(maxLatencyTicks, latencyTicks);
+	delivered++;
+	results.push_back({request.id, request.start, request.goal, status, std::move(path)});
+}
+
+void PathService::collect()
+{
+	for (std::size_t i = 0; i < running.size();)
+	{
+		std::shared_ptr<Batch> batch = running[i];
+		{
+			std::lock_guard<std::mutex> lock(batch->mutex);
+			if (!batch->finished)
+			{
+				i++;
+				continue;
+			}
+		}
+		running[i] = std::move(running.back());
+		running.pop_back();
+
+		// Vägar från en gammal kopia sparas inte, eftersom cachen redan har glömt ändringarna sedan dess.
+		const bool current = batch->snapshotVersion == snapshotVersion;
+		for (std::size_t j = 0; j < batch->done.size(); j++)
+		{
+			Result& result = batch->done[j];
+			if (current && result.status == Pathfinder::FOUND) cache.store(result.path);
+			deliver(batch->requests[j], result.status, std::move(result.path));
+		}
+		// Det som jobbet inte hann med läggs först i kön igen, i samma ordning.
+		queue.insert(queue.begin(), batch->requests.begin() + batch->done.size(), batch->requests.end());
+		requeued += batch->requests.size() - batch->done.size();
+		lastWorkTime += batch->workTime;
+		idlePathfinders.push_back(std::move(batch->pathfinder));
+	}
+}
+
+void PathService::start()
+{
+	if (!snapshot)
+	{
+		snapshot = std::make_shared<const Matrix<uint16_t>>(world.getHeights());
+	}
+
+	std::shared_ptr<Batch> batch = std::make_shared<Batch>();
+	while (!queue.empty() && batch->requests.size() < batchSize)
+	{
+		Request& request = queue.front();
+		std::vector<TilePos> path;
+		if (cache.find(request.start, request.goal, path))
+		{
+			cacheHits++;
+			deliver(request, Pathfinder::FOUND, std::move(path));
+		}
+		else
+		{
+			batch->requests.push_back(request);
+		}
+		queue.pop_front();
+	}
+	if (batch->requests.empty()) return;
+
+	if (idlePathfinders.empty())
+	{
+		batch->pathfinder = std::make_unique<Pathfinder>();
+	}
+	else
+	{
+		batch->pathfinder = std::move(idlePathfinders.back());
+		idlePathfinders.pop_back();
+	}
+	batch->snapshotVersion = snapshotVersion;
+	running.push_back(batch);
+
+	threadPool.submit([batch, heights = snapshot, budget = batchBudget] {
+		const auto start = Clock::now();
+		std::vector<Result> done;
+		done.reserve(batch->requests.size());
+		for (const Request& request : batch->requests)
+		{
+			if (!done.empty() && millisecondsSince(start) > budget) break;
+			Result result = {request.id, request.start, request.goal, Pathfinder::UNREACHABLE, {}};
+			result.status = batch->pathfinder->findPath(*heights, request.start, request.goal, result.path);
+			done.push_back(std::move(result));
+		}
+		const double workTime = millisecondsSince(start);
+		std::lock_guard<std::mutex> lock(batch->mutex);
+		batch->done = std::move(done);
+		batch->workTime = workTime;
+		batch->finished = true;
+		batch->finishedChanged.notify_all();
+	});
+}
+
+void PathService::update()
+{
+	const auto updateStart = Clock::now();
+	tick++;
+	results.clear();
+	lastWorkTime = 0.0;
+
+	// Ändringar tas om hand före jobben, så att vägar från före en ändring inte hamnar i cachen.
+	if (!dirtyRegions.empty())
+	{
+		// Jobben som körs behåller sin kopia, och en ny görs när nästa jobb startas.
+		dirtyRegions.take();
+		snapshot.reset();
+		snapshotVersion++;
+	}
+	collect();
+	while (!queue.empty() && running.size() < maxBatches)
+	{
+		start();
+		if (millisecondsSince(updateStart) > updateBudget) break;
+	}
+	lastUpdateTime = millisecondsSince(updateStart);
+}
+
+void PathService::waitForBatch()
+{
+	if (running.empty()) return;
+	Batch& batch = *running.front();
+	std::unique_lock<std::mutex> lock(batch.mutex);
+	batch.finishedChanged.wait(lock, [&] {return batch.finished;});
+}
+
+PathService::Metrics PathService::getMetrics() const noexcept
+{
+	std::size_t inFlight = 0;
+	for (const std::shared_ptr<Batch>& batch : running)
+	{
+		inFlight += batch->requests.size();
+	}
+	return {
+		queue.size(),
+		inFlight,
+		delivered,
+		cacheHits,
+		requeued,
+		delivered > 0 ? totalLatency / delivered : 0.0,
+		maxLatency,
+		delivered > 0 ? double(totalLatencyTicks) / delivered : 0.0,
+		maxLatencyTicks,
+		lastUpdateTime,
+		lastWorkTime
+	};
+}
\ No newline at end of file
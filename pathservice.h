@@ -0,0 +1,154 @@
+﻿#pragma once
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include "dirtyregions.h"
+#include "matrix.h"
+#include "pathfinder.h"
+#include "threadpool.h"
+#include "world.h"
+
+// Ett id för en begäran till PathService. 0 används aldrig.
+typedef uint32_t PathRequestID;
+
+/*
+ * Söker vägar i bakgrunden, så att många aktörer kan be om vägar utan att ett tick tar för lång tid.
+ * request() lägger bara begäran i en kö. update() körs en gång per tick och lämnar köade begäranden
+ * i grupper om batchSize till jobb i trådpoolen och tar hand om de jobb som är klara, så ett svar
+ * levereras tidigast vid nästa update().
+ *
+ * Jobben söker i en kopia av höjderna som delas mellan dem med en shared_ptr, så världen kan ändras
+ * medan de körs. Kopian görs om när världen har ändrats. Ett svar gäller världen som den såg ut när
+ * begäran lämnades till ett jobb. Vägar som hittas sparas i en PathCache, och en begäran som finns
+ * där besvaras direkt utan något jobb.
+ *
+ * Varje jobb slutar efter batchBudget och lämnar tillbaka de begäranden som inte hann sökas, så att
+ * trådarna aldrig blir upptagna länge, och update() startar inga fler jobb efter updateBudget.
+*/
+class PathService
+{
+public:
+	// Ett svar på en begäran.
+	struct Result
+	{
+		PathRequestID id;
+		TilePos start;
+		TilePos goal;
+		Pathfinder::Status status;
+		std::vector<TilePos> path; // Tom om ingen väg hittades.
+	};
+	// Mätvärden sedan PathService skapades, om inget annat står.
+	struct Metrics
+	{
+		std::size_t queued;       // Begäranden som väntar på ett jobb.
+		std::size_t inFlight;     // Begäranden i jobb som inte har tagits om hand än.
+		unsigned delivered;
+		unsigned cacheHits;
+		unsigned requeued;        // Begäranden som ett jobb lämnade tillbaka för att det nådde batchBudget.
+		double averageLatency;    // Millisekunder från request() till update() som levererade svaret.
+		double maxLatency;
+		double averageLatencyTicks;
+		unsigned maxLatencyTicks;
+		double lastUpdateTime;    // Millisekunder som den senaste update() tog.
+		double lastWorkTime;      // Millisekunder som jobben som togs om hand av den senaste update() tog tillsammans.
+	};
+
+	static constexpr unsigned defaultBatchSize = 32;
+	static constexpr double defaultBatchBudget = 2.0;
+	static constexpr double defaultUpdateBudget = 0.5;
+private:
+	typedef std::chrono::steady_clock Clock;
+	struct Request
+	{
+		PathRequestID id;
+		TilePos start;
+		TilePos goal;
+		unsigned tick; // Ticket då request() kördes.
+		Clock::time_point time;
+	};
+	// Delas med jobbet, så att jobbet kan bli klart även om PathService har förstörts.
+	struct Batch
+	{
+		std::mutex mutex;
+		std::condition_variable finishedChanged;
+		std::vector<Request> requests; // Rörs inte av någon annan medan jobbet körs.
+		std::vector<Result> done;      // Svar på de done.size() första begärandena.
+		std::unique_ptr<Pathfinder> pathfinder;
+		unsigned snapshotVersion;
+		double workTime = 0.0;
+		bool finished = false;
+	};
+
+	World& world;
+	ThreadPool& threadPool;
+	DirtyRegions dirtyRegions;
+	PathCache cache;
+	std::shared_ptr<const Matrix<uint16_t>> snapshot; // nullptr om världen har ändrats sedan kopian gjordes.
+	unsigned snapshotVersion;
+	std::deque<Request> queue;
+	std::vector<std::shared_ptr<Batch>> running;
+	std::vector<std::unique_ptr<Pathfinder>> idlePathfinders;
+	std::vector<Result> results;
+	PathRequestID nextID;
+	unsigned tick;
+
+	unsigned batchSize;
+	unsigned maxBatches;
+	double batchBudget;
+	double updateBudget;
+
+	unsigned delivered;
+	unsigned cacheHits;
+	unsigned requeued;
+	double totalLatency;
+	double maxLatency;
+	unsigned long long totalLatencyTicks;
+	unsigned maxLatencyTicks;
+	double lastUpdateTime;
+	double lastWorkTime;
+
+	// Lägger ett svar i results och räknar med det i mätvärdena.
+	void deliver(const Request& request, Pathfinder::Status status, std::vector<TilePos>&& path);
+	// Tar hand om de jobb som är klara.
+	void collect();
+	// Startar ett jobb med upp till batchSize begäranden från kön.
+	void start();
+public:
+	// maxBatches är hur många jobb som får köras samtidigt. 0 betyder ett per tråd i threadPool.
+	PathService(World& world, ThreadPool& threadPool, unsigned maxBatches = 0);
+	// Väntar inte på jobben, utan låter dem bli klara i bakgrunden.
+	~PathService() = default;
+
+	// Ingen kopiering.
+	PathService(const PathService&) = delete;
+	// Ingen kopiering.
+	PathService& operator=(const PathService&) = delete;
+
+	// Ber om en väg från start till goal. Svaret levereras av en senare update().
+	PathRequestID request(TilePos start, TilePos goal);
+	// Ska köras en gång per tick. Svaren som levereras finns i getResults() tills nästa update().
+	void update();
+	// Returnerar svaren som levererades av den senaste update().
+	const std::vector<Result>& getResults() const noexcept {return results;}
+
+	// Returnerar true om det inte finns några begäranden i kön eller i jobb.
+	bool idle() const noexcept {return queue.empty() && running.empty();}
+	// Väntar tills något av jobben som körs är klart, så att nästa update() har något att leverera.
+	void waitForBatch();
+
+	Metrics getMetrics() const noexcept;
+	const PathCache& getCache() const noexcept {return cache;}
+
+	// Sätter hur många begäranden som lämnas till varje jobb.
+	void setBatchSize(unsigned batchSize) noexcept {this->batchSize = std::max(batchSize, 1u);}
+	// Sätter hur många millisekunder ett jobb får söka innan det lämnar tillbaka resten. Minst en väg söks alltid.
+	void setBatchBudget(double milliseconds) noexcept {batchBudget = milliseconds;}
+	// Sätter hur många millisekunder update() får starta jobb. Minst ett jobb startas alltid om det finns plats.
+	void setUpdateBudget(double milliseconds) noexcept {updateBudget = milliseconds;}
+};
\ No newline at end of file
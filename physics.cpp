@@ -0,0 +1,103 @@
+﻿#include "physics.h"
+
+template <typename P>
+bool moveActor(P& pos, CoordinateOf<P>& yVel, const Hitbox& hitbox, CoordinateOf<P> dx, CoordinateOf<P> dz, bool jump, World& world)
+{
+	moveActorHorizontally(pos, hitbox, dx, dz, world);
+	yVel = applyGravity(yVel);
+	return moveActorVertically(pos, yVel, hitbox, jump, world);
+}
+
+template <typename P>
+void moveActorHorizontally(P& pos, const Hitbox& hitbox, CoordinateOf<P> dx, CoordinateOf<P> dz, World& world)
+{
+	typedef CoordinateOf<P> T;
+	typedef CoordinateTraits<T> Traits;
+	typedef Hitbox::BasicCollisionData<T> CollisionData;
+	const T zero = T();
+
+	bool snap = false;
+	T snapHeight = zero;
+	auto handleSnap = [&](const CollisionData& collisionData) -> void {
+		if (collisionData.collisionType == Hitbox::CollisionType::SnapUp)
+		{
+			snap = true;
+			if (collisionData.snapHeight > snapHeight) snapHeight = collisionData.snapHeight;
+		}
+	};
+
+	// Ett diagonalt steg kollas med ett enda svep över tilesen. Om z-steget kolliderar flyttas
+	// hitboxen tillbaka och då måste x-steget kollas igen från den nya positionen.
+	const bool diagonal = dx != zero && dz != zero;
+	Hitbox::BasicProbe<T> probe = {};
+	bool zCorrected = false;
+
+	if (dz != zero)
+	{
+		pos.z += dz;
+		if (diagonal) probe = hitbox.probeAll(pos, world, dx);
+		const CollisionData collisionData = diagonal
+			? (dz < zero ? probe.north : probe.south)
+			: (dz < zero ? hitbox.collidingNorth(pos, world) : hitbox.collidingSouth(pos, world));
+		if (collisionData.collisionType == Hitbox::CollisionType::Colliding)
+		{
+			const int tile = Traits::template tileIndex<Hitbox::AXIS_Z>(pos.z);
+			if (dz < zero)
+				pos.z = Traits::template tileStart<Hitbox::AXIS_Z>(tile) + Traits::fromSize(hitbox.depth / 2.0);
+			else
+				pos.z = Traits::below(Traits::template tileStart<Hitbox::AXIS_Z>(tile + 1) - Traits::fromSize(hitbox.depth / 2.0));
+			zCorrected = true;
+		}
+		else
+		{
+			handleSnap(collisionData);
+		}
+	}
+
+	if (dx != zero)
+	{
+		pos.x += dx;
+		const CollisionData collisionData = diagonal && !zCorrected
+			? (dx < zero ? probe.west : probe.east)
+			: (dx < zero ? hitbox.collidingWest(pos, world) : hitbox.collidingEast(pos, world));
+		if (collisionData.collisionType == Hitbox::CollisionType::Colliding)
+		{
+			const int tile = Traits::template tileIndex<Hitbox::AXIS_X>(pos.x);
+			if (dx < zero)
+				pos.x = Traits::template tileStart<Hitbox::AXIS_X>(tile) + Traits::fromSize(hitbox.width / 2.0);
+			else
+				pos.x = Traits::below(Traits::template tileStart<Hitbox::AXIS_X>(tile + 1) - Traits::fromSize(hitbox.width / 2.0));
+		}
+		else
+		{
+			handleSnap(collisionData);
+		}
+	}
+
+	if (snap)
+	{
+		pos.y = snapHeight;
+	}
+}
+
+template <typename P>
+bool moveActorVertically(P& pos, CoordinateOf<P>& yVel, const Hitbox& hitbox, bool jump, World& world)
+{
+	typedef CoordinateOf<P> T;
+	pos.y += yVel;
+	Hitbox::BasicCollisionData<T> collisionData = hitbox.collidingBottom(pos, world);
+	if (collisionData.collisionType == Hitbox::CollisionType::SnapUp)
+	{
+		pos.y = collisionData.snapHeight;
+		yVel = jump ? T(jumpSpeed) : T();
+		return true;
+	}
+	return false;
+}
+
+template bool moveActor(Point3D& pos, double& yVel, const Hitbox& hitbox, double dx, double dz, bool jump, World& world);
+template bool moveActor(FixedPoint3D& pos, Fixed& yVel, const Hitbox& hitbox, Fixed dx, Fixed dz, bool jump, World& world);
+template void moveActorHorizontally(Point3D& pos, const Hitbox& hitbox, double dx, double dz, World& world);
+template void moveActorHorizontally(FixedPoint3D& pos, const Hitbox& hitbox, Fixed dx, Fixed dz, World& world);
+template bool moveActorVertically(Point3D& pos, double& yVel, const Hitbox& hitbox, bool jump, World& world);
+template bool moveActorVertically(FixedPoint3D& pos, Fixed& yVel, const Hitbox& hitbox, bool jump, World& world);
\ No newline at end of file
@@ -0,0 +1,34 @@
+﻿#pragma once
+#include "geoutils.h"
+#include "hitbox.h"
+#include "world.h"
+
+constexpr double gravity = 1.0;
+constexpr double maxFallSpeed = 25.0;
+constexpr double jumpSpeed = 7.5;
+
+/*
+ * Flyttar en aktör dz i z-led och sedan dx i x-led med kollisioner, och låter den sedan falla med gravitationen.
+ * Om aktören landar och jump är true så hoppar den. Returnerar true om aktören står på marken.
+ * Spelaren och Entities flyttas med FixedPoint3D, så alla aktörer i världen beter sig likadant och ger
+ * samma resultat på alla plattformar.
+*/
+template <typename P>
+bool moveActor(P& pos, CoordinateOf<P>& yVel, const Hitbox& hitbox, CoordinateOf<P> dx, CoordinateOf<P> dz, bool jump, World& world);
+
+/*
+ * De tre stegen i moveActor(), för kod som flyttar många aktörer i taget. Gravitationen beror inte på
+ * positionen, så den kan läggas på alla aktörer i ett svep innan de flyttas.
+ *
+ * Alla funktionerna finns för Point3D och FixedPoint3D.
+*/
+
+// Flyttar en aktör horisontellt med kollisioner.
+template <typename P>
+void moveActorHorizontally(P& pos, const Hitbox& hitbox, CoordinateOf<P> dx, CoordinateOf<P> dz, World& world);
+// Returnerar den vertikala hastigheten efter ett tick med gravitation.
+template <typename T>
+inline T applyGravity(T yVel) noexcept {return yVel > T(-maxFallSpeed) ? yVel - T(gravity) : yVel;}
+// Flyttar en aktör vertikalt och landar den på marken. Returnerar true om aktören står på marken.
+template <typename P>
+bool moveActorVertically(P& pos, CoordinateOf<P>& yVel, const Hitbox& hitbox, bool jump, World& world);
\ No newline at end of file
@@ -0,0 +1,37 @@
+﻿#pragma once
+#include "arena.h"
+#include "image.h"
+#include "imagefile.h"
+#include "input.h"
+#include "rendertarget.h"
+
+/*
+ * Det som spelet behöver från plattformen: ett fönster (eller inget), input och något att rita på.
+ * Win32Platform använder Windows och DirectV och HeadlessPlatform kör utan fönster, t.ex. på Linux.
+*/
+class Platform
+{
+public:
+	virtual ~Platform() {}
+
+	// Hanterar fönstrets meddelanden och lägger input i kön. Returnerar false när programmet ska avslutas.
+	virtual bool update() = 0;
+	// Returnerar kön med input. Den läses med InputState.
+	virtual InputQueue& getInputQueue() noexcept = 0;
+
+	// Returnerar arenan för data som bara behövs under en frame. Den nollställs av beginFrame().
+	virtual FrameArena& getFrameArena() noexcept = 0;
+
+	// Påbörjar en frame och returnerar det som ska ritas på. Allt i arenan frigörs.
+	virtual RenderTarget& beginFrame() = 0;
+	// Avslutar framen och visar den.
+	virtual void endFrame() = 0;
+
+	// Byter ut en bild mot image. Ska köras mellan frames.
+	virtual void reloadImage(ImageID imageID, const PixelImage& image) = 0;
+
+	// Returnerar bredden på det som ritas, i pixlar.
+	virtual int getWidth() const noexcept = 0;
+	// Returnerar höjden på det som ritas, i pixlar.
+	virtual int getHeight() const noexcept = 0;
+};
\ No newline at end of file
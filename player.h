@@ -1,6 +1,7 @@
 ﻿#pragma once
 #include "geoutils.h"
-#include "directv.h"
+#include "fixedpoint.h"
+#include "input.h"
 #include "image.h"
 #include "world.h"
 #include "hitbox.h"
@@ -9,14 +10,19 @@ class Player
 {
 private:
 	Hitbox hitbox;
-	double yVel;
+	Fixed yVel;
 public:
 	constexpr static double speed = 5.0;
 
-	Point3D pos;
+	// Spelarens position i fixtal, så att rörelsen blir exakt även långt från origo.
+	FixedPoint3D pos;
 	Image image;
 
 	Player(Point3D pos);
 
-	void logic(Direction dir, World& world, DirectV& dv);
+	void logic(Direction dir, World& world, const KeySnapshot& keys);
+
+	const Hitbox& getHitbox() const noexcept {return hitbox;}
+	// Returnerar den vertikala hastigheten (i pixlar per tick, uppåt är positivt).
+	Fixed getYVel() const noexcept {return yVel;}
 };
\ No newline at end of file
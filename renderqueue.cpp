@@ -0,0 +1,102 @@
+﻿#include <cmath>
+#include "renderqueue.h"
+#include "world.h"
+
+namespace
+{
+	void drawItem(const RenderQueue::Item& item, RenderTarget& target)
+	{
+		if (item.count == 1)
+			item.image->draw(item.x, item.y, target);
+		else
+			item.image->drawRepeated(item.x, item.y, item.count, target);
+	}
+}
+
+RenderQueue::RenderQueue(FrameArena& arena)
+	: items(ArenaAllocator<Item>(arena)) {}
+
+void RenderQueue::clear()
+{
+	// Det gamla minnet kan redan ha återanvänts av arenan. Lika många bilder som förra gången
+	// reserveras, så att vektorn oftast inte behöver växa och lämna gamla buffertar efter sig.
+	const std::size_t reserved = items.size();
+	items = ArenaVector<Item>(items.get_allocator());
+	items.reserve(reserved);
+}
+
+uint64_t RenderQueue::spriteDepthKey(Point3D pos, double depth) noexcept
+{
+	// Spriten hör till den främsta raden som hitboxen står på, så att terrängen på den raden inte ritas över den.
+	return depthKey(std::floor((pos.z + depth / 2.0) / tileTopHeight), std::floor(pos.y / tileHeight), true);
+}
+
+uint64_t RenderQueue::spriteDepthKey(FixedPoint3D pos, double depth) noexcept
+{
+	return depthKey((pos.z + Fixed(depth / 2.0)).floorShift(tileTopHeightShift), pos.y.floorShift(tileHeightShift), true);
+}
+
+void RenderQueue::pushSprite(const Image& image, uint64_t key, Point projected, Point centrePos, RenderTarget& target)
+{
+	push(
+		key,
+		image,
+		target.getEffWidth() / 2.0f + (projected.x - centrePos.x) - image.getWidth() / 2.0f,
+		target.getEffHeight() / 2.0f + (projected.y - centrePos.y) - image.getHeight()
+	);
+}
+
+void RenderQueue::sort()
+{
+	// LSD radix sort med 8 bitar i taget. Alla histogram räknas i ett svep och
+	// bytes som är likadana i alla nycklar hoppas över, vilket oftast är de flesta.
+	const std::size_t n = items.size();
+	std::size_t counts[8][256] = {};
+	for (const Item& item : items)
+	{
+		for (unsigned b = 0; b < 8; b++)
+		{
+			counts[b][(item.key >> (b * 8)) & 0xff]++;
+		}
+	}
+
+	ArenaVector<Item> sortBuffer(n, items.get_allocator());
+	for (unsigned b = 0; b < 8; b++)
+	{
+		if (counts[b][(items.empty() ? 0 : items[0].key >> (b * 8)) & 0xff] == n) continue;
+
+		std::size_t offsets[256];
+		std::size_t sum = 0;
+		for (unsigned i = 0; i < 256; i++)
+		{
+			offsets[i] = sum;
+			sum += counts[b][i];
+		}
+		for (const Item& item : items)
+		{
+			sortBuffer[offsets[(item.key >> (b * 8)) & 0xff]++] = item;
+		}
+		items.swap(sortBuffer);
+	}
+}
+
+void RenderQueue::draw(RenderTarget& target) const
+{
+	for (const Item& item : items)
+	{
+		drawItem(item, target);
+	}
+}
+
+void RenderQueue::draw(RenderTarget& target, float x, float y, float width, float height) const
+{
+	for (const Item& item : items)
+	{
+		const float itemX = int(item.x);
+		const float itemY = int(item.y);
+		if (itemX < x + width && itemX + item.image->getWidth() * item.count > x && itemY < y + height && itemY + item.image->getHeight() > y)
+		{
+			drawItem(item, target);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,62 @@
+﻿#pragma once
+#include <cstdint>
+#include "arena.h"
+#include "image.h"
+#include "rendertarget.h"
+#include "geoutils.h"
+#include "fixedpoint.h"
+
+/*
+ * En kö med bilder som ska ritas. Terräng och sprites läggs i kön med en djupnyckel, sorteras
+ * med en radix sort och ritas sedan i ett svep. Sorteringen är stabil, så bilder med samma
+ * nyckel ritas i den ordning de lades till. Kön och sorteringsbufferten ligger i en FrameArena, så
+ * de kostar ingen allokering från heapen när arenan har blivit tillräckligt stor.
+*/
+class RenderQueue
+{
+public:
+	struct Item
+	{
+		uint64_t key;
+		const Image* image;
+		float x;
+		float y;
+		unsigned count; // Bilden ritas så många gånger bredvid varandra.
+	};
+private:
+	ArenaVector<Item> items;
+
+	void pushSprite(const Image& image, uint64_t key, Point projected, Point centrePos, RenderTarget& target);
+public:
+	explicit RenderQueue(FrameArena& arena);
+
+	/*
+	 * Returnerar djupnyckeln för något på raden z och höjden y. Raderna ritas bakifrån och fram,
+	 * varje rad nerifrån och upp, och på varje höjd ritas terrängen före sprites.
+	*/
+	static uint64_t depthKey(int z, int y, bool sprite) noexcept
+	{
+		return static_cast<uint64_t>(z < 0 ? 0 : z) << 32 | static_cast<uint64_t>(y < 0 ? 0 : y) << 1 | (sprite ? 1 : 0);
+	}
+	// Returnerar djupnyckeln för en sprite med en viss position och hitboxdjup.
+	static uint64_t spriteDepthKey(Point3D pos, double depth) noexcept;
+	// Samma som ovan, men raden och höjden räknas ut med skift.
+	static uint64_t spriteDepthKey(FixedPoint3D pos, double depth) noexcept;
+
+	// Tömmer kön och tar nytt minne från arenan. Måste köras efter att arenan har nollställts och innan något läggs i kön.
+	void clear();
+	// Lägger till en bild, som ritas count gånger bredvid varandra. Bilden måste finnas kvar tills kön har ritats.
+	void push(uint64_t key, const Image& image, float x, float y, unsigned count = 1) {items.push_back({key, &image, x, y, count});}
+	// Lägger till en sprite vars fötter är på pos. centrePos är den projicerade positionen i mitten av skärmen.
+	void pushSprite(const Image& image, Point3D pos, double depth, Point centrePos, RenderTarget& target) {pushSprite(image, spriteDepthKey(pos, depth), pos.project(), centrePos, target);}
+	void pushSprite(const Image& image, FixedPoint3D pos, double depth, Point centrePos, RenderTarget& target) {pushSprite(image, spriteDepthKey(pos, depth), pos.project(), centrePos, target);}
+	// Sorterar kön efter djupnyckel.
+	void sort();
+	// Ritar allt i kön i den ordning det ligger.
+	void draw(RenderTarget& target) const;
+	// Ritar bara det som överlappar rektangeln (x, y, width, height). Det som ritas klipps inte.
+	void draw(RenderTarget& target, float x, float y, float width, float height) const;
+
+	std::size_t size() const noexcept {return items.size();}
+	const ArenaVector<Item>& getItems() const noexcept {return items;}
+};
\ No newline at end of file
@@ -0,0 +1,35 @@
+﻿#pragma once
+#include "image.h"
+
+/*
+ * Något som terrängen och sprites kan ritas på. DirectVTarget ritar i fönstret med Direct2D och
+ * SoftwareTarget ritar i minnet, så att en frame kan renderas utan Windows.
+*/
+class RenderTarget
+{
+public:
+	virtual ~RenderTarget() {}
+
+	// Skalar allt som ritas efter detta med scale. getEffWidth() och getEffHeight() blir mindre lika mycket.
+	virtual void setScale(float scale) = 0;
+	// Returnerar bredden i de koordinater som bilderna ritas i.
+	virtual int getEffWidth() const noexcept = 0;
+	// Returnerar höjden i de koordinater som bilderna ritas i.
+	virtual int getEffHeight() const noexcept = 0;
+
+	// Ritar hela bilden i rektangeln (x, y, width, height).
+	virtual void drawImage(ImageID imageID, float x, float y, float width, float height) = 0;
+	// Ritar delen (sourceX, sourceY, sourceWidth, sourceHeight) av bilden i rektangeln (x, y, width, height).
+	virtual void drawImage(ImageID imageID, float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight) = 0;
+	/*
+	 * Ritar delen (sourceX, sourceY, sourceWidth, sourceHeight) av bilden count gånger bredvid varandra, med
+	 * den första i rektangeln (x, y, width, height). Om inget bättre finns ritas den en gång i taget.
+	*/
+	virtual void drawImageRepeated(ImageID imageID, float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight, unsigned count)
+	{
+		for (unsigned i = 0; i < count; i++)
+		{
+			drawImage(imageID, x + i * width, y, width, height, sourceX, sourceY, sourceWidth, sourceHeight);
+		}
+	}
+};
\ No newline at end of file
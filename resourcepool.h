@@ -0,0 +1,125 @@
+﻿#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+/*
+ * Ett handtag till något i en ResourcePool<T>. Handtaget är ett index och en generation, så det kan
+ * kopieras fritt, och när det som det pekar på tas bort blir det ogiltigt även om platsen återanvänds.
+ * Ett handtag som har skapats med {} är alltid ogiltigt. Generation är ett mindre heltal bara när man
+ * vill att generationerna ska slå runt snabbt, t.ex. för att testa det.
+*/
+template <typename T, typename Generation = uint32_t>
+struct Handle
+{
+	static_assert(std::is_unsigned<Generation>::value, "Generation must be unsigned.");
+
+	uint32_t index = 0;
+	Generation generation = 0; // 0 används aldrig av en pool.
+
+	// Returnerar true om handtaget har fått ett värde från en pool. Det kan fortfarande ha blivit ogiltigt.
+	explicit operator bool() const noexcept {return generation != 0;}
+	bool operator==(Handle o) const noexcept {return index == o.index && generation == o.generation;}
+	bool operator!=(Handle o) const noexcept {return !(*this == o);}
+};
+
+/*
+ * Lagrar objekt av typen T tätt i en vector och lämnar ut handtag till dem. Att slå upp ett handtag är
+ * bara en indexering och en jämförelse av generationen. Platser som blir lediga återanvänds, så en pool
+ * där objekt hela tiden skapas och tas bort växer inte. Pekare som get() returnerar blir ogiltiga när
+ * något läggs till, men handtagen gäller tills objektet tas bort.
+*/
+template <typename T, typename Generation = uint32_t>
+class ResourcePool
+{
+public:
+	typedef Handle<T, Generation> HandleType;
+private:
+	struct Slot
+	{
+		std::optional<T> value;
+		Generation generation;
+	};
+	std::vector<Slot> slots;
+	std::vector<uint32_t> freeSlots;
+	std::size_t count = 0;
+
+	const Slot* find(HandleType handle) const noexcept
+	{
+		if (handle.index >= slots.size()) return nullptr;
+		const Slot& slot = slots[handle.index];
+		return slot.value && slot.generation == handle.generation ? &slot : nullptr;
+	}
+public:
+	ResourcePool() = default;
+
+	// Ingen kopiering.
+	ResourcePool(const ResourcePool&) = delete;
+	// Ingen kopiering.
+	ResourcePool& operator=(const ResourcePool&) = delete;
+
+	// Lägger till ett objekt och returnerar ett handtag till det.
+	HandleType add(T&& value)
+	{
+		uint32_t index;
+		if (freeSlots.empty())
+		{
+			index = slots.size();
+			slots.push_back({std::nullopt, 1});
+		}
+		else
+		{
+			// Den senast lediga platsen tas först, eftersom den troligen fortfarande finns i cachen.
+			index = freeSlots.back();
+			freeSlots.pop_back();
+		}
+		slots[index].value.emplace(std::move(value));
+		count++;
+		return {index, slots[index].generation};
+	}
+
+	// Tar bort objektet som handtaget pekar på. Returnerar false om handtaget redan var ogiltigt.
+	bool remove(HandleType handle)
+	{
+		if (!find(handle)) return false;
+		Slot& slot = slots[handle.index];
+		slot.value.reset();
+		count--;
+		// En plats vars generation har slagit runt används inte igen, så att gamla handtag aldrig blir giltiga.
+		if (++slot.generation != 0) freeSlots.push_back(handle.index);
+		return true;
+	}
+
+	// Returnerar objektet som handtaget pekar på, eller nullptr om handtaget är ogiltigt.
+	T* get(HandleType handle) noexcept {return const_cast<T*>(std::as_const(*this).get(handle));}
+	const T* get(HandleType handle) const noexcept
+	{
+		const Slot* slot = find(handle);
+		return slot ? &*slot->value : nullptr;
+	}
+	// Returnerar true om handtaget pekar på något i poolen.
+	bool contains(HandleType handle) const noexcept {return find(handle) != nullptr;}
+
+	// Tar bort alla objekt. Alla handtag blir ogiltiga.
+	void clear()
+	{
+		for (uint32_t i = 0; i < slots.size(); i++)
+		{
+			if (slots[i].value) remove({i, slots[i].generation});
+		}
+	}
+	// Gör plats för slotCount objekt, så att add() inte behöver allokera förrän poolen blir större än så.
+	void reserve(std::size_t slotCount)
+	{
+		slots.reserve(slotCount);
+		freeSlots.reserve(slotCount);
+	}
+
+	// Returnerar antalet objekt i poolen.
+	std::size_t size() const noexcept {return count;}
+	// Returnerar antalet platser, lediga och upptagna.
+	std::size_t capacity() const noexcept {return slots.size();}
+};
\ No newline at end of file
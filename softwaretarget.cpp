@@ -0,0 +1,67 @@
+﻿#include <algorithm>
+#include <cmath>
+#include "softwaretarget.h"
+
+SoftwareTarget::SoftwareTarget(unsigned width, unsigned height)
+	: frame{width, height, std::vector<uint32_t>(std::size_t(width) * height, 0xff000000)},
+	  scale(1.0f)
+{
+	for (std::size_t i = 0; i < imageCount; i++)
+	{
+		images[i] = loadImageFile(imageFiles[i]);
+	}
+}
+
+void SoftwareTarget::clear(uint32_t colour) noexcept
+{
+	std::fill(frame.pixels.begin(), frame.pixels.end(), colour);
+}
+
+void SoftwareTarget::drawImage(ImageID imageID, float x, float y, float width, float height)
+{
+	drawImage(imageID, x, y, width, height, 0.0f, 0.0f, float(images[imageID].width), float(images[imageID].height));
+}
+
+void SoftwareTarget::drawImage(ImageID imageID, float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight)
+{
+	const PixelImage& image = images[imageID];
+	x *= scale;
+	y *= scale;
+	width *= scale;
+	height *= scale;
+	if (width <= 0.0f || height <= 0.0f) return;
+
+	// En pixel ritas om dess mitt ligger i rektangeln, så att bilder som ligger kant i kant inte överlappar.
+	const int startX = std::max(int(std::ceil(x - 0.5f)), 0);
+	const int startY = std::max(int(std::ceil(y - 0.5f)), 0);
+	const int endX = std::min(int(std::ceil(x + width - 0.5f)), int(frame.width));
+	const int endY = std::min(int(std::ceil(y + height - 0.5f)), int(frame.height));
+	const float scaleX = sourceWidth / width;
+	const float scaleY = sourceHeight / height;
+	for (int py = startY; py < endY; py++)
+	{
+		const int sy = std::clamp(int(sourceY + (py + 0.5f - y) * scaleY), 0, int(image.height) - 1);
+		uint32_t* row = &frame.pixels[std::size_t(py) * frame.width];
+		for (int px = startX; px < endX; px++)
+		{
+			const int sx = std::clamp(int(sourceX + (px + 0.5f - x) * scaleX), 0, int(image.width) - 1);
+			const uint32_t src = image.pixels[sx + std::size_t(sy) * image.width];
+			const uint32_t alpha = src >> 24;
+			if (alpha == 0) continue;
+			if (alpha == 255)
+			{
+				row[px] = src;
+				continue;
+			}
+			const uint32_t dst = row[px];
+			uint32_t out = 0;
+			for (int shift = 0; shift < 32; shift += 8)
+			{
+				const uint32_t s = shift == 24 ? 255 : src >> shift & 0xff;
+				const uint32_t d = dst >> shift & 0xff;
+				out |= ((s * alpha + d * (255 - alpha) + 127) / 255) << shift;
+			}
+			row[px] = out;
+		}
+	}
+}
\ No newline at end of file
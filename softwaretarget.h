@@ -0,0 +1,37 @@
+﻿#pragma once
+#include <array>
+#include <cstdint>
+#include <vector>
+#include "imagefile.h"
+#include "rendertarget.h"
+
+/*
+ * En RenderTarget som ritar i minnet, utan Windows. Bilderna ritas med närmaste granne och
+ * alfablandning, som DirectV gör. Utan setScale() är en enhet en pixel.
+*/
+class SoftwareTarget : public RenderTarget
+{
+private:
+	PixelImage frame;
+	std::array<PixelImage, imageCount> images;
+	float scale;
+public:
+	// Laddar bilderna i imageFiles. Kastar std::runtime_error om någon av dem inte går att läsa.
+	SoftwareTarget(unsigned width, unsigned height);
+
+	// Byter ut en bild.
+	void setImage(ImageID imageID, const PixelImage& image) {images[imageID] = image;}
+
+	// Fyller hela bilden med colour (0xAARRGGBB).
+	void clear(uint32_t colour = 0xff000000) noexcept;
+
+	void setScale(float scale) override {this->scale = scale;}
+	int getEffWidth() const noexcept override {return frame.width / scale;}
+	int getEffHeight() const noexcept override {return frame.height / scale;}
+
+	void drawImage(ImageID imageID, float x, float y, float width, float height) override;
+	void drawImage(ImageID imageID, float x, float y, float width, float height, float sourceX, float sourceY, float sourceWidth, float sourceHeight) override;
+
+	// Returnerar det som har ritats.
+	const PixelImage& getFrame() const noexcept {return frame;}
+};
\ No newline at end of file
@@ -0,0 +1,118 @@
+﻿#include <algorithm>
+#include <cmath>
+#include "spatialhash.h"
+
+SpatialHash::SpatialHash(double cellSize, unsigned bucketCount)
+	: cellSize(cellSize),
+	  maxHalfWidth(0.0),
+	  maxHalfDepth(0.0),
+	  stamp(0),
+	  entities(nullptr)
+{
+	unsigned count = 1;
+	while (count < bucketCount) count *= 2;
+	bucketMask = count - 1;
+	bucketStart.resize(count + 1);
+	bucketStamps.resize(count);
+}
+
+unsigned SpatialHash::bucketOf(long long cellX, long long cellZ) const noexcept
+{
+	const unsigned long long h = static_cast<unsigned long long>(cellX) * 73856093ull ^ static_cast<unsigned long long>(cellZ) * 19349663ull;
+	return static_cast<unsigned>(h ^ (h >> 32)) & bucketMask;
+}
+
+void SpatialHash::build(const Entities& entities)
+{
+	this->entities = &entities;
+	const std::size_t n = entities.size();
+	const Fixed* xs = entities.getPosX();
+	const Fixed* zs = entities.getPosZ();
+
+	maxHalfWidth = 0.0;
+	maxHalfDepth = 0.0;
+	entityBuckets.resize(n);
+	std::fill(bucketStart.begin(), bucketStart.end(), 0);
+	for (std::size_t i = 0; i < n; i++)
+	{
+		const unsigned b = bucketOf(std::floor(xs[i].toDouble() / cellSize), std::floor(zs[i].toDouble() / cellSize));
+		entityBuckets[i] = b;
+		bucketStart[b + 1]++;
+		const Hitbox& hitbox = entities.getHitbox(i);
+		maxHalfWidth = std::max(maxHalfWidth, hitbox.width / 2.0);
+		maxHalfDepth = std::max(maxHalfDepth, hitbox.depth / 2.0);
+	}
+	for (std::size_t b = 1; b < bucketStart.size(); b++)
+	{
+		bucketStart[b] += bucketStart[b - 1];
+	}
+
+	// bucketStart används som skrivposition och flyttas tillbaka ett steg efteråt.
+	entries.resize(n);
+	for (std::size_t i = 0; i < n; i++)
+	{
+		entries[bucketStart[entityBuckets[i]]++] = i;
+	}
+	for (std::size_t b = bucketStart.size() - 1; b > 0; b--)
+	{
+		bucketStart[b] = bucketStart[b - 1];
+	}
+	bucketStart[0] = 0;
+}
+
+void SpatialHash::query(double minX, double minZ, double maxX, double maxZ, std::vector<unsigned>& result)
+{
+	if (!entities) return;
+
+	if (++stamp == 0)
+	{
+		std::fill(bucketStamps.begin(), bucketStamps.end(), 0);
+		stamp = 1;
+	}
+
+	const Fixed* xs = entities->getPosX();
+	const Fixed* zs = entities->getPosZ();
+	const long long startCellX = std::floor((minX - maxHalfWidth) / cellSize);
+	const long long startCellZ = std::floor((minZ - maxHalfDepth) / cellSize);
+	const long long endCellX = std::floor((maxX + maxHalfWidth) / cellSize);
+	const long long endCellZ = std::floor((maxZ + maxHalfDepth) / cellSize);
+	auto visitBucket = [&](unsigned b) -> void {
+		if (bucketStamps[b] == stamp) return;
+		bucketStamps[b] = stamp;
+		for (unsigned e = bucketStart[b]; e < bucketStart[b + 1]; e++)
+		{
+			const unsigned i = entries[e];
+			const Hitbox& hitbox = entities->getHitbox(i);
+			const double x = xs[i].toDouble();
+			const double z = zs[i].toDouble();
+			if (x + hitbox.width / 2.0 >= minX && x - hitbox.width / 2.0 <= maxX &&
+				z + hitbox.depth / 2.0 >= minZ && z - hitbox.depth / 2.0 <= maxZ)
+			{
+				result.push_back(i);
+			}
+		}
+	};
+
+	if ((endCellX - startCellX + 1) * (endCellZ - startCellZ + 1) > static_cast<long long>(bucketMask))
+	{
+		// Rektangeln täcker fler celler än det finns hinkar, så det går fortare att gå igenom alla hinkar.
+		for (unsigned b = 0; b <= bucketMask; b++) visitBucket(b);
+		return;
+	}
+	for (long long cellX = startCellX; cellX <= endCellX; cellX++)
+	{
+		for (long long cellZ = startCellZ; cellZ <= endCellZ; cellZ++)
+		{
+			visitBucket(bucketOf(cellX, cellZ));
+		}
+	}
+}
+
+void SpatialHash::queryNeighbours(unsigned i, std::vector<unsigned>& result)
+{
+	const Point3D pos = entities->getPos(i).toPoint3D();
+	const Hitbox& hitbox = entities->getHitbox(i);
+	const std::size_t first = result.size();
+	query(pos.x - hitbox.width / 2.0, pos.z - hitbox.depth / 2.0, pos.x + hitbox.width / 2.0, pos.z + hitbox.depth / 2.0, result);
+	result.erase(std::remove(result.begin() + first, result.end(), i), result.end());
+}
\ No newline at end of file
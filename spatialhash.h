@@ -0,0 +1,39 @@
+﻿#pragma once
+#include <vector>
+#include "entities.h"
+
+/*
+ * Ett rutnät för att snabbt hitta entiteter nära en position. Rutnätet är obegränsat: cellerna
+ * hashas till ett fast antal hinkar, så det spelar ingen roll hur stor världen är.
+ * Varje entitet läggs i cellen där dess mittpunkt är, och sökningar utökas med den största
+ * hitboxen så att entiteter som sticker ut ur sin cell också hittas.
+ *
+ * Rutnätet byggs om från början med build() varje tick, vilket tar O(n) tid med en counting sort.
+ * Indexen som sökningar returnerar gäller tills entiteterna ändras.
+*/
+class SpatialHash
+{
+private:
+	double cellSize;
+	unsigned bucketMask;
+	double maxHalfWidth;
+	double maxHalfDepth;
+	std::vector<unsigned> bucketStart; // Var varje hinks entiteter börjar i entries. Har en extra plats på slutet.
+	std::vector<unsigned> entries; // Entitetsindex sorterade efter hink.
+	std::vector<unsigned> entityBuckets;
+	std::vector<unsigned> bucketStamps; // Så att en hink inte gås igenom två gånger i samma sökning.
+	unsigned stamp;
+	const Entities* entities;
+
+	unsigned bucketOf(long long cellX, long long cellZ) const noexcept;
+public:
+	// Skapar ett rutnät med celler som är cellSize pixlar stora. bucketCount avrundas upp till en tvåpotens.
+	SpatialHash(double cellSize, unsigned bucketCount = 4096);
+
+	// Bygger om rutnätet från entiteternas nuvarande positioner.
+	void build(const Entities& entities);
+	// Lägger till index för alla entiteter vars hitbox överlappar rektangeln i x- och z-led i result.
+	void query(double minX, double minZ, double maxX, double maxZ, std::vector<unsigned>& result);
+	// Lägger till index för alla entiteter vars hitbox överlappar entiteten i (förutom den själv) i result.
+	void queryNeighbours(unsigned i, std::vector<unsigned>& result);
+};
\ No newline at end of file
@@ -0,0 +1,72 @@
+﻿#pragma once
+#include <atomic>
+#include <cstddef>
+
+/*
+ * En kö utan lås för en tråd som skriver och en tråd som läser. Platserna ligger i en ringbuffert med
+ * Capacity platser, så inget minne allokeras. push() misslyckas om kön är full.
+*/
+template <class T, std::size_t Capacity>
+class SpscQueue
+{
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two.");
+private:
+	T items[Capacity];
+	// Läsaren och skrivaren ändrar var sitt index, så de ligger på olika cache-rader.
+	alignas(64) std::atomic<std::size_t> head; // Nästa plats att läsa. Ändras bara av läsaren.
+	alignas(64) std::atomic<std::size_t> tail; // Nästa plats att skriva. Ändras bara av skrivaren.
+public:
+	SpscQueue() noexcept
+		: items{},
+		  head(0),
+		  tail(0) {}
+
+	// Ingen kopiering.
+	SpscQueue(const SpscQueue&) = delete;
+	// Ingen kopiering.
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// Lägger till item sist i kön. Returnerar false om kön är full. Får bara köras av skrivaren.
+	bool push(const T& item) noexcept
+	{
+		const std::size_t t = tail.load(std::memory_order_relaxed);
+		if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+		items[t & (Capacity - 1)] = item;
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	/*
+	 * Returnerar hur många platser som är lediga. Får bara köras av skrivaren. Läsaren kan ha hunnit ta bort
+	 * fler, så det finns alltid minst så många.
+	*/
+	std::size_t freeSlots() const noexcept
+	{
+		return Capacity - (tail.load(std::memory_order_relaxed) - head.load(std::memory_order_acquire));
+	}
+
+	// Returnerar det första i kön utan att ta bort det, eller nullptr om kön är tom. Får bara köras av läsaren.
+	const T* front() const noexcept
+	{
+		const std::size_t h = head.load(std::memory_order_relaxed);
+		if (h == tail.load(std::memory_order_acquire)) return nullptr;
+		return &items[h & (Capacity - 1)];
+	}
+	// Tar bort det första i kön. Kön får inte vara tom. Får bara köras av läsaren.
+	void pop() noexcept
+	{
+		head.store(head.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+	}
+	// Flyttar det första i kön till item. Returnerar false om kön är tom. Får bara köras av läsaren.
+	bool pop(T& item) noexcept
+	{
+		const T* first = front();
+		if (!first) return false;
+		item = *first;
+		pop();
+		return true;
+	}
+
+	bool empty() const noexcept {return front() == nullptr;}
+	static constexpr std::size_t capacity() noexcept {return Capacity;}
+};
\ No newline at end of file
@@ -0,0 +1,168 @@
+﻿#include <algorithm>
+#include <cmath>
+#include "terrainlod.h"
+
+namespace
+{
+	// Färgerna är ungefär medelfärgerna i tiles.png, så att det inte syns så mycket när detaljnivån byts.
+	constexpr uint32_t topColour = 0xff858585;
+	constexpr uint32_t sideColour = 0xff6d6d6d;
+	// En cell på en högre nivå som inte är platt får en färg mellan toppen och sidan.
+	constexpr uint32_t slopeColour = 0xff797979;
+}
+
+TerrainLod::Detail TerrainLod::detailFor(float scale) noexcept
+{
+	const float tileSize = tileWidth * scale;
+	if (tileSize >= baseOnlyTileSize) return DETAIL_FULL;
+	if (tileSize >= chunkTileSize) return DETAIL_BASE;
+	return DETAIL_CHUNKS;
+}
+
+TerrainLod::TerrainLod(World& world)
+	: world(world),
+	  dirtyRegions(world)
+{
+	const HeightPyramid& pyramid = world.getPyramid();
+	levels.resize(pyramid.getLevelCount());
+	for (unsigned level = 0; level < levels.size(); level++)
+	{
+		levels[level].chunksX = (pyramid.getLevelWidth(level) + chunkSize - 1) / chunkSize;
+		levels[level].chunksZ = (pyramid.getLevelDepth(level) + chunkSize - 1) / chunkSize;
+		levels[level].chunks.resize(levels[level].chunksX * levels[level].chunksZ);
+	}
+}
+
+void TerrainLod::invalidate(TileRect area) noexcept
+{
+	if (area.startX >= area.endX || area.startZ >= area.endZ) return;
+	for (unsigned level = 0; level < levels.size(); level++)
+	{
+		Level& l = levels[level];
+		const unsigned startX = (std::max(area.startX, 0) >> level) / chunkSize;
+		const unsigned startZ = (std::max(area.startZ, 0) >> level) / chunkSize;
+		const unsigned endX = std::min(((area.endX - 1) >> level) / chunkSize + 1, l.chunksX);
+		const unsigned endZ = std::min(((area.endZ - 1) >> level) / chunkSize + 1, l.chunksZ);
+		for (unsigned z = startZ; z < endZ; z++)
+		{
+			for (unsigned x = startX; x < endX; x++)
+			{
+				l.chunks[x + z * l.chunksX].valid = false;
+			}
+		}
+	}
+}
+
+void TerrainLod::rasterise(unsigned level, unsigned chunkX, unsigned chunkZ, DirectV& dv)
+{
+	const HeightPyramid& pyramid = world.getPyramid();
+	Chunk& chunk = levels[level].chunks[chunkX + chunkZ * levels[level].chunksX];
+	const unsigned startX = chunkX * chunkSize;
+	const unsigned startZ = chunkZ * chunkSize;
+	const unsigned endX = std::min(startX + chunkSize, pyramid.getLevelWidth(level));
+	const unsigned endZ = std::min(startZ + chunkSize, pyramid.getLevelDepth(level));
+
+	// En höjdenhet är tileHeight / tileTopHeight rader hög och en cell är 2^level tiles djup.
+	const unsigned shift = tileTopHeightShift - tileHeightShift + level;
+	const unsigned maxHeight = pyramid.maxHeight(startX << level, startZ << level, endX << level, endZ << level);
+	const unsigned padding = std::min(maxHeight >> shift, maxChunkHeight - chunkSize);
+
+	// Cellerna ritas bakifrån och fram, så att celler längre fram täcker sidorna på cellerna bakom dem.
+	pixels.assign(chunkSize * (chunkSize + padding), 0);
+	for (unsigned x = startX; x < endX; x++)
+	{
+		for (unsigned z = startZ; z < endZ; z++)
+		{
+			const HeightPyramid::MinMax mm = pyramid.cellAt(level, x, z);
+			const unsigned ground = z - startZ + padding;
+			const unsigned top = ground - std::min(unsigned(mm.max) >> shift, padding);
+			uint32_t* column = &pixels[x - startX];
+			column[top * chunkSize] = level > 0 && mm.min < mm.max ? slopeColour : topColour;
+			for (unsigned row = top + 1; row <= ground; row++)
+			{
+				column[row * chunkSize] = sideColour;
+			}
+		}
+	}
+
+	Bitmap* bitmap = dv.get(chunk.bitmap);
+	if (bitmap && chunk.padding == padding)
+	{
+		bitmap->copyFromMemory(pixels.data());
+	}
+	else
+	{
+		// Den gamla platsen i poolen återanvänds av den nya bitmapen.
+		dv.release(chunk.bitmap);
+		chunk.bitmap = dv.addBitmap(chunkSize, chunkSize + padding, pixels.data());
+		chunk.padding = padding;
+	}
+	chunk.valid = true;
+}
+
+unsigned TerrainLod::levelFor(float scale) const noexcept
+{
+	// Den lägsta nivån där en cell är minst en pixel bred.
+	unsigned level = 0;
+	float cellSize = tileWidth * scale;
+	while (cellSize < 1.0f && level + 1 < levels.size())
+	{
+		cellSize *= 2.0f;
+		level++;
+	}
+	return level;
+}
+
+void TerrainLod::draw(Point centrePos, float scale, DirectV& dv)
+{
+	for (const TileRect& rect : dirtyRegions.take())
+	{
+		invalidate(rect);
+	}
+	if (levels.empty()) return;
+
+	const unsigned level = levelFor(scale);
+	Level& l = levels[level];
+	const double cellWidth = double(1u << level) * tileWidth;
+	const double cellDepth = double(1u << level) * tileTopHeight;
+	const double chunkWidth = cellWidth * chunkSize;
+	const double chunkDepth = cellDepth * chunkSize;
+	const double left = centrePos.x - dv.getEffWidth() / 2.0;
+	const double right = centrePos.x + dv.getEffWidth() / 2.0;
+	const double top = centrePos.y - dv.getEffHeight() / 2.0;
+	const double bottom = centrePos.y + dv.getEffHeight() / 2.0;
+	// Bitar längre ner kan sticka upp på skärmen om terrängen är hög.
+	const double maxRise = std::min<double>(world.getPyramid().maxHeight(0, 0, world.getWidth(), world.getDepth()) * tileHeight, maxChunkHeight * cellDepth);
+
+	const int startX = std::clamp<int>(std::floor(left / chunkWidth), 0, l.chunksX);
+	const int endX = std::clamp<int>(std::floor(right / chunkWidth) + 1, 0, l.chunksX);
+	const int startZ = std::clamp<int>(std::floor(top / chunkDepth), 0, l.chunksZ);
+	const int endZ = std::clamp<int>(std::floor((bottom + maxRise) / chunkDepth) + 1, 0, l.chunksZ);
+
+	unsigned budget = maxRasterisedPerFrame;
+	for (int z = startZ; z < endZ; z++)
+	{
+		for (int x = startX; x < endX; x++)
+		{
+			Chunk& chunk = l.chunks[x + z * l.chunksX];
+			if (!chunk.valid && budget > 0)
+			{
+				rasterise(level, x, z, dv);
+				budget--;
+			}
+			// En bit som inte har hunnit göras om ritas som den var, och en som aldrig har gjorts hoppas över.
+			if (!chunk.bitmap) continue;
+
+			const double chunkTop = z * chunkDepth - chunk.padding * cellDepth;
+			const double height = (chunkSize + chunk.padding) * cellDepth;
+			if (chunkTop > bottom || chunkTop + height < top) continue;
+			dv.drawBitmap(
+				dv.getEffWidth() / 2.0f + x * chunkWidth - centrePos.x,
+				dv.getEffHeight() / 2.0f + chunkTop - centrePos.y,
+				chunkWidth,
+				height,
+				chunk.bitmap
+			);
+		}
+	}
+}
\ No newline at end of file
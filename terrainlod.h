@@ -0,0 +1,76 @@
+﻿#pragma once
+#include <cstdint>
+#include <vector>
+#include "directv.h"
+#include "dirtyregions.h"
+#include "geoutils.h"
+#include "world.h"
+
+/*
+ * Förenklad terrängrendering för när man har zoomat ut. Världen delas in i bitar om chunkSize * chunkSize
+ * celler på en nivå i höjdpyramiden och varje bit ritas som en bitmap med en pixel per cell, projicerad
+ * på samma sätt som tilesen. Nivån väljs så att en cell blir ungefär en pixel på skärmen, så antalet
+ * bitmaps som ritas är ungefär detsamma oavsett hur långt ut man har zoomat.
+ *
+ * Bitmaparna skapas första gången de syns och görs om när världen ändras. De ligger i DirectV:ns pool
+ * och tas bort med den.
+*/
+class TerrainLod
+{
+public:
+	// Hur mycket som ritas på en viss zoomnivå.
+	enum Detail
+	{
+		DETAIL_FULL,   // Tiles med kanter och hörn.
+		DETAIL_BASE,   // Tiles utan kanter och hörn.
+		DETAIL_CHUNKS  // Bitmaps från TerrainLod.
+	};
+
+	static constexpr unsigned chunkSize = 64;
+	// Tiles som är smalare än detta (i pixlar på skärmen) ritas utan kanter och hörn.
+	static constexpr float baseOnlyTileSize = 16.0f;
+	// Tiles som är smalare än detta (i pixlar på skärmen) ritas med TerrainLod.
+	static constexpr float chunkTileSize = 8.0f;
+	// Så många bitar som görs om per frame. Resten görs om under de följande framesen.
+	static constexpr unsigned maxRasterisedPerFrame = 32;
+	// Den högsta bitmapen som skapas, i pixlar. Terräng som sticker upp mer än så klipps.
+	static constexpr unsigned maxChunkHeight = 4096;
+
+	// Returnerar hur mycket som ska ritas när koordinatsystemet är skalat med scale.
+	static Detail detailFor(float scale) noexcept;
+private:
+	struct Chunk
+	{
+		BitmapHandle bitmap;
+		unsigned padding; // Antalet rader ovanför biten som bitmapen har plats för.
+		bool valid;
+	};
+	struct Level
+	{
+		unsigned chunksX;
+		unsigned chunksZ;
+		std::vector<Chunk> chunks;
+	};
+
+	World& world;
+	DirtyRegions dirtyRegions;
+	std::vector<Level> levels;
+	std::vector<uint32_t> pixels;
+
+	// Markerar alla bitar som innehåller någon av tilesen i area som ogiltiga.
+	void invalidate(TileRect area) noexcept;
+	// Ritar om en bit till dess bitmap.
+	void rasterise(unsigned level, unsigned chunkX, unsigned chunkZ, DirectV& dv);
+public:
+	explicit TerrainLod(World& world);
+
+	// Ingen kopiering.
+	TerrainLod(const TerrainLod&) = delete;
+	// Ingen kopiering.
+	TerrainLod& operator=(const TerrainLod&) = delete;
+
+	// Returnerar den pyramidnivå som används när koordinatsystemet är skalat med scale.
+	unsigned levelFor(float scale) const noexcept;
+	// Ritar terrängen. scale ska vara samma skalning som har getts till dv.scaleTransform().
+	void draw(Point centrePos, float scale, DirectV& dv);
+};
\ No newline at end of file
@@ -0,0 +1,128 @@
+﻿#include <cmath>
+#include "textbuffer.h"
+
+namespace
+{
+	// Skriver siffrorna i v, minst minDigits stycken.
+	std::size_t formatDigits(wchar_t* out, std::size_t size, unsigned long long v, unsigned minDigits) noexcept
+	{
+		wchar_t digits[24];
+		unsigned n = 0;
+		do
+		{
+			digits[n++] = L'0' + v % 10;
+			v /= 10;
+		}
+		while (v > 0 || n < minDigits);
+		std::size_t written = 0;
+		while (n > 0 && written < size) out[written++] = digits[--n];
+		return written;
+	}
+
+	/*
+	 * Avrundar |v| * 10^decimals till ett heltal i rounded. Avrundningen görs på det exakta binära värdet
+	 * och går till det jämna heltalet när det är precis mitt emellan, som i printf, så 9.995, som egentligen
+	 * är lite mindre, blir 999 med två decimaler. decimals får vara högst 9. Returnerar false om heltalet
+	 * inte får plats i 64 bitar.
+	*/
+	bool roundScaled(double v, unsigned decimals, unsigned long long& rounded) noexcept
+	{
+		int exponent;
+		const double mantissa = std::frexp(std::fabs(v), &exponent);
+		// v = m * 2^shift exakt, med m < 2^53.
+		const unsigned long long m = static_cast<unsigned long long>(std::ldexp(mantissa, 53));
+		const int shift = exponent - 53;
+		unsigned long long scale = 1;
+		for (unsigned i = 0; i < decimals; i++) scale *= 10;
+
+		// m * scale i 128 bitar, hi * 2^64 + lo. scale < 2^32, så delarna får plats i 64 bitar.
+		const unsigned long long lowPart = (m & 0xffffffffull) * scale;
+		const unsigned long long highPart = (m >> 32) * scale;
+		unsigned long long lo = lowPart + (highPart << 32);
+		unsigned long long hi = (highPart >> 32) + (lo < lowPart);
+		if (shift >= 0)
+		{
+			if (hi != 0 || (shift > 0 && (shift >= 64 || lo >> (64 - shift) != 0))) return false;
+			rounded = lo << shift;
+			return true;
+		}
+
+		// Skiftar åt höger och jämför resten med en halv. m * scale < 2^83, så allt under 2^-84 blir 0.
+		const unsigned s = static_cast<unsigned>(-shift);
+		if (s > 84)
+		{
+			rounded = 0;
+			return true;
+		}
+		unsigned long long quotient, restHi, restLo, halfHi, halfLo;
+		if (s < 64)
+		{
+			if (hi >> s != 0) return false;
+			quotient = (lo >> s) | (hi << (64 - s));
+			restHi = 0;
+			restLo = lo & ((1ull << s) - 1);
+			halfHi = 0;
+			halfLo = 1ull << (s - 1);
+		}
+		else
+		{
+			const unsigned highShift = s - 64;
+			quotient = hi >> highShift;
+			restHi = hi & ((1ull << highShift) - 1);
+			restLo = lo;
+			halfHi = highShift > 0 ? 1ull << (highShift - 1) : 0;
+			halfLo = highShift > 0 ? 0 : 1ull << 63;
+		}
+		const bool above = restHi > halfHi || (restHi == halfHi && restLo > halfLo);
+		const bool half = restHi == halfHi && restLo == halfLo;
+		if (above || (half && (quotient & 1) != 0))
+		{
+			if (quotient == ~0ull) return false;
+			quotient++;
+		}
+		rounded = quotient;
+		return true;
+	}
+
+	std::size_t formatString(wchar_t* out, std::size_t size, const wchar_t* s) noexcept
+	{
+		std::size_t written = 0;
+		while (s[written] && written < size)
+		{
+			out[written] = s[written];
+			written++;
+		}
+		return written;
+	}
+}
+
+std::size_t formatInteger(wchar_t* out, std::size_t size, long long v) noexcept
+{
+	std::size_t written = 0;
+	if (v < 0 && size > 0) out[written++] = L'-';
+	// Räknas som unsigned så att det minsta talet också fungerar.
+	const unsigned long long magnitude = v < 0 ? 0ull - static_cast<unsigned long long>(v) : v;
+	return written + formatDigits(out + written, size - written, magnitude, 1);
+}
+
+std::size_t formatDecimal(wchar_t* out, std::size_t size, double v, unsigned decimals) noexcept
+{
+	// Som printf får allt med teckenbiten ett minus, även -0 och tal som avrundas till 0.
+	const bool negative = std::signbit(v);
+	if (std::isnan(v)) return formatString(out, size, negative ? L"-nan" : L"nan");
+	decimals = decimals > 9 ? 9 : decimals;
+	unsigned long long fixed;
+	if (std::isinf(v) || !roundScaled(v, decimals, fixed)) return formatString(out, size, negative ? L"-inf" : L"inf");
+	unsigned long long scale = 1;
+	for (unsigned i = 0; i < decimals; i++) scale *= 10;
+
+	std::size_t written = 0;
+	if (negative && size > 0) out[written++] = L'-';
+	written += formatDigits(out + written, size - written, fixed / scale, 1);
+	if (decimals > 0)
+	{
+		if (written < size) out[written++] = L'.';
+		written += formatDigits(out + written, size - written, fixed % scale, decimals);
+	}
+	return written;
+}
\ No newline at end of file
@@ -0,0 +1,67 @@
+﻿#pragma once
+#include <cstddef>
+#include <string>
+
+/*
+ * Skriver v i decimalform i out, som har plats för size tecken. Returnerar antalet tecken som skrevs, utan nulltecken.
+ * Om det inte får plats skrivs början, som med TextBuffer.
+*/
+std::size_t formatInteger(wchar_t* out, std::size_t size, long long v) noexcept;
+/*
+ * Skriver v med decimals decimaler i out, som har plats för size tecken. Returnerar antalet tecken som skrevs, utan
+ * nulltecken. Det blir samma som swprintf med %.*f, avrundning och -0 inräknat, men med högst 9 decimaler, och tal
+ * vars siffror inte får plats i 64 bitar skrivs som inf och -inf.
+*/
+std::size_t formatDecimal(wchar_t* out, std::size_t size, double v, unsigned decimals) noexcept;
+
+/*
+ * En text med en fast maxlängd som byggs upp utan att allokera minne, t.ex. för räknare i HUD:en som
+ * uppdateras ofta. Det som inte får plats klipps bort.
+*/
+template <std::size_t N>
+class TextBuffer
+{
+private:
+	wchar_t text[N + 1];
+	std::size_t length;
+public:
+	TextBuffer() noexcept
+		: text{},
+		  length(0) {}
+
+	void clear() noexcept
+	{
+		length = 0;
+		text[0] = L'\0';
+	}
+
+	TextBuffer& append(const wchar_t* s) noexcept
+	{
+		while (*s && length < N) text[length++] = *s++;
+		text[length] = L'\0';
+		return *this;
+	}
+	TextBuffer& append(wchar_t c) noexcept
+	{
+		if (length < N) text[length++] = c;
+		text[length] = L'\0';
+		return *this;
+	}
+	TextBuffer& append(long long v) noexcept
+	{
+		length += formatInteger(text + length, N - length, v);
+		text[length] = L'\0';
+		return *this;
+	}
+	TextBuffer& append(double v, unsigned decimals) noexcept
+	{
+		length += formatDecimal(text + length, N - length, v, decimals);
+		text[length] = L'\0';
+		return *this;
+	}
+
+	const wchar_t* c_str() const noexcept {return text;}
+	std::size_t size() const noexcept {return length;}
+	bool operator==(const TextBuffer& o) const noexcept {return length == o.length && std::char_traits<wchar_t>::compare(text, o.text, length) == 0;}
+	bool operator!=(const TextBuffer& o) const noexcept {return !(*this == o);}
+};
\ No newline at end of file
@@ -0,0 +1,105 @@
+﻿#include <algorithm>
+#include <atomic>
+#include <memory>
+#include "threadpool.h"
+
+ThreadPool::ThreadPool(unsigned threadCount)
+	: stopping(false)
+{
+	if (threadCount == 0)
+	{
+		const unsigned cores = std::thread::hardware_concurrency();
+		threadCount = cores > 1 ? cores - 1 : 1;
+	}
+	for (unsigned i = 0; i < threadCount; i++)
+	{
+		threads.emplace_back(&ThreadPool::workerLoop, this);
+	}
+}
+
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	jobAvailable.notify_all();
+	for (std::thread& t : threads)
+	{
+		t.join();
+	}
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			jobAvailable.wait(lock, [this] {return stopping || !jobs.empty();});
+			if (jobs.empty()) return;
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+		job();
+	}
+}
+
+void ThreadPool::submit(std::function<void()> job)
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push_back(std::move(job));
+	}
+	jobAvailable.notify_one();
+}
+
+void ThreadPool::parallelFor(std::size_t count, std::size_t minChunk, const std::function<void(std::size_t, std::size_t)>& f)
+{
+	if (count == 0) return;
+	const std::size_t maxChunks = threads.size() + 1;
+	const std::size_t chunkSize = std::max(std::max<std::size_t>(minChunk, 1), (count + maxChunks - 1) / maxChunks);
+	const std::size_t chunkCount = (count + chunkSize - 1) / chunkSize;
+	if (chunkCount == 1)
+	{
+		f(0, count);
+		return;
+	}
+
+	// Trådar som startar sent kan fortfarande komma åt tillståndet efter att funktionen har returnerat.
+	struct State
+	{
+		std::atomic<std::size_t> next;
+		std::atomic<std::size_t> done;
+		std::mutex mutex;
+		std::condition_variable finished;
+	};
+	auto state = std::make_shared<State>();
+	state->next = 0;
+	state->done = 0;
+
+	// f används bara medan det finns bitar kvar, och funktionen returnerar inte förrän alla bitar är klara.
+	const auto* fp = &f;
+	auto runChunks = [state, fp, count, chunkSize, chunkCount] {
+		std::size_t chunk;
+		while ((chunk = state->next++) < chunkCount)
+		{
+			const std::size_t start = chunk * chunkSize;
+			(*fp)(start, std::min(start + chunkSize, count));
+			if (++state->done == chunkCount)
+			{
+				std::lock_guard<std::mutex> lock(state->mutex);
+				state->finished.notify_all();
+			}
+		}
+	};
+	for (std::size_t i = 1; i < chunkCount; i++)
+	{
+		submit(runChunks);
+	}
+	runChunks();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->finished.wait(lock, [&] {return state->done == chunkCount;});
+}
\ No newline at end of file
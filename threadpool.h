@@ -0,0 +1,46 @@
+﻿#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*
+ * En pool med arbetstrådar. Jobb kan läggas i kön med submit() för att köras i bakgrunden,
+ * eller så kan en loop delas upp mellan trådarna med parallelFor().
+*/
+class ThreadPool
+{
+private:
+	std::vector<std::thread> threads;
+	std::deque<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable jobAvailable;
+	bool stopping;
+
+	void workerLoop();
+public:
+	// Skapar en pool med threadCount trådar. 0 betyder en tråd per processorkärna, förutom den som skapar poolen.
+	explicit ThreadPool(unsigned threadCount = 0);
+	// Väntar tills alla jobb i kön är klara och stänger sedan av trådarna.
+	~ThreadPool();
+
+	// Ingen kopiering.
+	ThreadPool(const ThreadPool&) = delete;
+	// Ingen kopiering.
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	// Lägger ett jobb i kön.
+	void submit(std::function<void()> job);
+
+	/*
+	 * Delar upp [0, count) i bitar som är minst minChunk stora och kör f(start, end) på dem parallellt.
+	 * Tråden som anropar funktionen kör också bitar, så den blir klar även om alla trådar är upptagna
+	 * med andra jobb. Returnerar när alla bitar är klara.
+	*/
+	void parallelFor(std::size_t count, std::size_t minChunk, const std::function<void(std::size_t, std::size_t)>& f);
+
+	unsigned getThreadCount() const noexcept {return threads.size();}
+};
\ No newline at end of file
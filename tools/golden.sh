@@ -0,0 +1,43 @@
+#!/bin/sh
+# Renderar referensbilderna i tools/golden med headless och jämför dem pixel för pixel. Avslutar med 1 om
+# någon bild skiljer sig, och sparar då skillnaderna som NAMN-diff.png i $TMPDIR. Med --update skrivs
+# referensbilderna om istället. HEADLESS är sökvägen till headless (bygg den enligt tools/headless.cpp).
+set -u
+cd "$(dirname "$0")/.."
+headless=${HEADLESS:-./headless}
+update=0
+if [ "${1:-}" = "--update" ]
+then
+	update=1
+fi
+failed=0
+
+# check NAMN ARGUMENT...
+check()
+{
+	name=$1
+	shift
+	golden=tools/golden/$name.png
+	if [ $update -eq 1 ]
+	then
+		"$headless" --size 240x160 "$@" --out "$golden" > /dev/null || failed=1
+		return
+	fi
+	echo "$name"
+	if ! "$headless" --size 240x160 "$@" --compare "$golden" --diff "${TMPDIR:-/tmp}/$name-diff.png" > /dev/null
+	then
+		echo "  FAILED: $headless --size 240x160 $* --compare $golden"
+		failed=1
+	fi
+}
+
+check seed1 --seed 1 --camera 10 10
+check seed2 --seed 2 --camera 25 25
+check seed3-corner --seed 3 --camera 0 0
+check seed4-edge-no-overlays --seed 4 --camera 49 30 --no-overlays
+check seed1-sprite --seed 1 --camera 10 10 --sprite
+check seed5-sprite-no-overlays --seed 5 --camera 30 12 --sprite --no-overlays
+check seed1-ticks120 --seed 1 --ticks 120 --npcs 100
+check seed7-ticks60-no-overlays --seed 7 --ticks 60 --npcs 100 --no-overlays
+
+exit $failed
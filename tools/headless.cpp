@@ -0,0 +1,2110 @@
+﻿#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cwchar>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <functional>
+#include <new>
+#include <queue>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include "../arena.h"
+#include "../game.h"
+#include "../headlessplatform.h"
+#include "../heightqueries.h"
+#include "../hotreload.h"
+#include "../image.h"
+#include "../imagefile.h"
+#include "../pathfinder.h"
+#include "../pathservice.h"
+#include "../physics.h"
+#include "../renderqueue.h"
+#include "../resourcepool.h"
+#include "../softwaretarget.h"
+#include "../spatialhash.h"
+#include "../textbuffer.h"
+#include "../world.h"
+#include "../worldfile.h"
+
+/*
+ * Renderar en frame utan fönster och sparar den som PPM eller PNG, eller jämför den med en tidigare
+ * sparad bild. Med --ticks körs hela spelet med HeadlessPlatform istället, med en spelare som går i
+ * en fyrkant, och tiden för simuleringen och renderingen skrivs ut, liksom hur många allokeringar från
+ * heapen som görs efter de första ticksen. Med --paths söks vägar mellan slumpmässiga tiles och antalet
+ * vägar per sekund skrivs ut, med och utan cache, eller med --async genom en PathService. Med
+ * --check-paths jämförs Pathfinder, PathGraph och PathCache med Dijkstra över alla tiles. Med
+ * --check-actors flyttas aktörer både en och en med moveActor() och tillsammans med Entities::update(),
+ * och spelaren styrs med tangenter bredvid en entitet, och programmet avslutas med 1 om de hamnar olika,
+ * och med --bench-actors skrivs antalet aktörsticks per sekund ut, liksom tiderna för att sortera
+ * entiteterna och bygga och söka i en SpatialHash. Med
+ * --check-height-queries jämförs funktionerna i heightqueries.h med en tile i taget, och med --check-top-runs
+ * jämförs raderna med toppar som ritas som en bild med en omräkning efter varje ändring av världen. Med
+ * --bench-geometry jämförs funktionerna i geoutils.h med hur de såg ut innan de gjordes inline och med
+ * versionerna för arrayer, och med --check-input kontrolleras att inga tangenter fastnar eller tappas
+ * när InputQueue blir full. Med --check-text jämförs formatInteger() och formatDecimal() med swprintf,
+ * och med --check-resource-pool kontrolleras att gamla handtag till en ResourcePool aldrig blir giltiga
+ * igen. Körs från mappen som gfx ligger i.
+ *
+ * Bygg med (utan Windows):
+ * g++ -std=c++17 -O2 -pthread tools/headless.cpp game.cpp headlessplatform.cpp world.cpp renderqueue.cpp
+ *     arena.cpp image.cpp imagefile.cpp softwaretarget.cpp heightpyramid.cpp dirtyregions.cpp geoutils.cpp
+ *     entities.cpp player.cpp physics.cpp hitbox.cpp threadpool.cpp input.cpp textbuffer.cpp hotreload.cpp
+ *     filewatcher.cpp worldfile.cpp heightqueries.cpp pathfinder.cpp pathservice.cpp spatialhash.cpp
+ *     -o headless
+ *
+ * Världen och NPC:erna från --npcs slumpas med std::mt19937 från --seed, så samma seed ger samma bilder
+ * på alla plattformar. Spelet i fönstret har inga NPC:er. tools/golden.sh jämför med referensbilderna i tools/golden.
+*/
+
+namespace
+{
+	// Antalet allokeringar från heapen i hela programmet. Räknas av alla operator new nedan.
+	std::atomic<std::size_t> heapAllocations(0);
+
+	// Allokerar size byte med malloc och räknar allokeringen. Returnerar nullptr om det inte finns minne.
+	void* countedMalloc(std::size_t size) noexcept
+	{
+		heapAllocations.fetch_add(1, std::memory_order_relaxed);
+		return std::malloc(size > 0 ? size : 1);
+	}
+
+	/*
+	 * Som countedMalloc(), men minnet börjar på en multipel av alignment. Pekaren från malloc sparas precis
+	 * före det som returneras, så att alignedFree() kan lämna tillbaka den.
+	*/
+	void* countedAlignedMalloc(std::size_t size, std::align_val_t alignment) noexcept
+	{
+		const std::size_t align = std::max(static_cast<std::size_t>(alignment), alignof(void*));
+		if (size > SIZE_MAX - align - sizeof(void*)) return nullptr;
+		void* raw = countedMalloc(size + align + sizeof(void*));
+		if (!raw) return nullptr;
+		const std::uintptr_t start = (reinterpret_cast<std::uintptr_t>(raw) + sizeof(void*) + align - 1) & ~std::uintptr_t(align - 1);
+		reinterpret_cast<void**>(start)[-1] = raw;
+		return reinterpret_cast<void*>(start);
+	}
+
+	void alignedFree(void* p) noexcept
+	{
+		if (p) std::free(static_cast<void**>(p)[-1]);
+	}
+
+	void* throwIfNull(void* p)
+	{
+		if (!p) throw std::bad_alloc();
+		return p;
+	}
+}
+
+/*
+ * Alla varianter av operator new och delete byts ut, så att --check-allocations ser varje allokering och
+ * allt minne lämnas tillbaka till samma allokerare som det kom från. GCC varnar för att free() körs på minne
+ * från operator new när en delete inlinas bredvid en new, fast de hör ihop här.
+*/
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+
+void* operator new(std::size_t size) {return throwIfNull(countedMalloc(size));}
+void* operator new[](std::size_t size) {return throwIfNull(countedMalloc(size));}
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {return countedMalloc(size);}
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {return countedMalloc(size);}
+void* operator new(std::size_t size, std::align_val_t alignment) {return throwIfNull(countedAlignedMalloc(size, alignment));}
+void* operator new[](std::size_t size, std::align_val_t alignment) {return throwIfNull(countedAlignedMalloc(size, alignment));}
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {return countedAlignedMalloc(size, alignment);}
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {return countedAlignedMalloc(size, alignment);}
+
+void operator delete(void* p) noexcept {std::free(p);}
+void operator delete[](void* p) noexcept {std::free(p);}
+void operator delete(void* p, std::size_t) noexcept {std::free(p);}
+void operator delete[](void* p, std::size_t) noexcept {std::free(p);}
+void operator delete(void* p, const std::nothrow_t&) noexcept {std::free(p);}
+void operator delete[](void* p, const std::nothrow_t&) noexcept {std::free(p);}
+void operator delete(void* p, std::align_val_t) noexcept {alignedFree(p);}
+void operator delete[](void* p, std::align_val_t) noexcept {alignedFree(p);}
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {alignedFree(p);}
+void operator delete[](void* p, std::size_t, std::align_val_t) noexcept {alignedFree(p);}
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept {alignedFree(p);}
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept {alignedFree(p);}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+namespace
+{
+	// Så många ticks får allokera från heapen innan --check-allocations börjar räkna, medan arenan och köerna växer.
+	constexpr unsigned warmupTicks = 60;
+
+	struct Options
+	{
+		uint32_t seed = 1;
+		unsigned width = 683;
+		unsigned height = 384;
+		int cameraX = 10;
+		int cameraZ = 10;
+		bool overlays = true;
+		bool sprite = false;
+		std::string out;
+		std::string compare;
+		std::string diff;
+		int tolerance = 0;
+		unsigned ticks = 0;
+		unsigned npcs = 0;
+		bool checkAllocations = false;
+		std::string world;
+		std::string saveWorld;
+		unsigned paths = 0;
+		unsigned worldWidth = 50;
+		unsigned worldDepth = 50;
+		int obstacles = -1;
+		int pathRange = 0;
+		bool asyncPaths = false;
+		bool graphPaths = false;
+		bool checkPaths = false;
+		unsigned checkActors = 0;
+		unsigned benchActors = 0;
+		bool checkHeightQueries = false;
+		bool checkTopRuns = false;
+		unsigned benchGeometry = 0;
+		bool checkInput = false;
+		bool checkText = false;
+		bool checkResourcePool = false;
+	};
+
+	void printUsage()
+	{
+		std::cerr <<
+			"Usage: headless [options]\n"
+			"  --seed N          seed for the generated world and NPCs (default 1)\n"
+			"  --size WxH        frame size in pixels (default 683x384)\n"
+			"  --camera X Z      tile to centre the view on (default 10 10)\n"
+			"  --no-overlays     draw tiles without edges and corners\n"
+			"  --sprite          draw a sprite on the camera tile\n"
+			"  --out FILE        save the frame (.ppm or .png)\n"
+			"  --compare FILE    compare the frame with FILE, exit with 1 if they differ\n"
+			"  --diff FILE       with --compare, save an image of the differences (.ppm or .png)\n"
+			"  --tolerance N     largest channel difference that counts as equal (default 0)\n"
+			"  --ticks N         run the game for N ticks and print timings; the last frame is saved or compared\n"
+			"  --npcs N          with --ticks, add N NPCs that wander around (default 0)\n"
+			"  --check-allocations  with --ticks, exit with 1 if a tick after the first 60 allocates from the heap\n"
+			"  --world FILE      with --ticks, load the world file and reload it and the images when they change\n"
+			"  --save-world FILE save the generated world as a world file\n"
+			"  --paths N         find N paths between random tiles and print timings\n"
+			"  --world-size WxD  with --paths and the actor modes, size of the generated world (default 50x50)\n"
+			"  --obstacles N     with --paths, flatten the world and raise N random blocks of up to 8x8 tiles\n"
+			"  --path-range N    with --paths, put each goal at most N tiles from the start in x and z\n"
+			"  --async           with --paths, submit all paths to a PathService and print its metrics\n"
+			"  --graph           with --paths, search long paths in a PathGraph\n"
+			"  --check-paths     compare paths from Pathfinder, PathGraph and PathCache with Dijkstra on random\n"
+			"                    worlds, exit with 1 if one is invalid, unreachable when it shouldn't be or too long\n"
+			"  --check-actors N  move N actors with moveActor() and Entities::update() for --ticks ticks (default 600),\n"
+			"                    then drive the player with random keys next to an entity with the same speed and jumps,\n"
+			"                    exit with 1 if a position or vertical velocity differs\n"
+			"  --bench-actors N  move N actors with Entities::update() for --ticks ticks (default 100) and print actor-ticks/s,\n"
+			"                    then time sorting them and building and querying a SpatialHash\n"
+			"  --check-height-queries  compare the bulk height queries with one tile at a time over random\n"
+			"                    rectangles and lines, exit with 1 if they differ\n"
+			"  --bench-geometry N  time the old, inline and batched rotateAround(), moveTowards() and distance() on\n"
+			"                    N points for --ticks rounds (default 100), exit with 1 if their results differ\n"
+			"  --check-top-runs  edit random worlds and compare the runs of merged tile tops and the neighbour masks\n"
+			"                    with ones computed from scratch, exit with 1 if they differ\n"
+			"  --check-input     post key presses, mouse moves and chars that overflow the input queue for --ticks ticks\n"
+			"                    (default 600), exit with 1 if a key gets stuck or a press is lost\n"
+			"  --check-text      compare formatInteger() and formatDecimal() with swprintf for edge cases and --ticks\n"
+			"                    random numbers (default 100000), cut at every length, exit with 1 if they differ\n"
+			"  --check-resource-pool  reuse, clear and wrap the generations of ResourcePool slots and make --ticks\n"
+			"                    random changes (default 100000), exit with 1 if a removed handle becomes valid\n";
+	}
+
+	Options parseOptions(int argc, char** argv)
+	{
+		Options options;
+		for (int i = 1; i < argc; i++)
+		{
+			const std::string arg = argv[i];
+			auto next = [&]() -> std::string {
+				if (i + 1 >= argc) throw std::runtime_error(arg + " needs a value.");
+				return argv[++i];
+			};
+			if (arg == "--seed")
+			{
+				options.seed = std::stoul(next());
+			}
+			else if (arg == "--size")
+			{
+				const std::string size = next();
+				const std::size_t x = size.find('x');
+				if (x == std::string::npos) throw std::runtime_error("--size should be WxH.");
+				options.width = std::stoul(size.substr(0, x));
+				options.height = std::stoul(size.substr(x + 1));
+			}
+			else if (arg == "--camera")
+			{
+				options.cameraX = std::stoi(next());
+				options.cameraZ = std::stoi(next());
+			}
+			else if (arg == "--no-overlays")
+			{
+				options.overlays = false;
+			}
+			else if (arg == "--sprite")
+			{
+				options.sprite = true;
+			}
+			else if (arg == "--out")
+			{
+				options.out = next();
+			}
+			else if (arg == "--compare")
+			{
+				options.compare = next();
+			}
+			else if (arg == "--diff")
+			{
+				options.diff = next();
+			}
+			else if (arg == "--tolerance")
+			{
+				options.tolerance = std::stoi(next());
+			}
+			else if (arg == "--ticks")
+			{
+				options.ticks = std::stoul(next());
+			}
+			else if (arg == "--npcs")
+			{
+				options.npcs = std::stoul(next());
+			}
+			else if (arg == "--check-allocations")
+			{
+				options.checkAllocations = true;
+			}
+			else if (arg == "--world")
+			{
+				options.world = next();
+			}
+			else if (arg == "--save-world")
+			{
+				options.saveWorld = next();
+			}
+			else if (arg == "--paths")
+			{
+				options.paths = std::stoul(next());
+			}
+			else if (arg == "--world-size")
+			{
+				const std::string size = next();
+				const std::size_t x = size.find('x');
+				if (x == std::string::npos) throw std::runtime_error("--world-size should be WxD.");
+				options.worldWidth = std::stoul(size.substr(0, x));
+				options.worldDepth = std::stoul(size.substr(x + 1));
+			}
+			else if (arg == "--obstacles")
+			{
+				options.obstacles = std::stoi(next());
+			}
+			else if (arg == "--path-range")
+			{
+				options.pathRange = std::stoi(next());
+			}
+			else if (arg == "--async")
+			{
+				options.asyncPaths = true;
+			}
+			else if (arg == "--graph")
+			{
+				options.graphPaths = true;
+			}
+			else if (arg == "--check-paths")
+			{
+				options.checkPaths = true;
+			}
+			else if (arg == "--check-actors")
+			{
+				options.checkActors = std::stoul(next());
+			}
+			else if (arg == "--bench-actors")
+			{
+				options.benchActors = std::stoul(next());
+			}
+			else if (arg == "--check-height-queries")
+			{
+				options.checkHeightQueries = true;
+			}
+			else if (arg == "--bench-geometry")
+			{
+				options.benchGeometry = std::stoul(next());
+			}
+			else if (arg == "--check-top-runs")
+			{
+				options.checkTopRuns = true;
+			}
+			else if (arg == "--check-input")
+			{
+				options.checkInput = true;
+			}
+			else if (arg == "--check-text")
+			{
+				options.checkText = true;
+			}
+			else if (arg == "--check-resource-pool")
+			{
+				options.checkResourcePool = true;
+			}
+			else
+			{
+				throw std::runtime_error("Unknown option " + arg + ".");
+			}
+		}
+		if (options.width == 0 || options.height == 0) throw std::runtime_error("The frame can't be empty.");
+		if (options.worldWidth == 0 || options.worldDepth == 0) throw std::runtime_error("The world can't be empty.");
+		return options;
+	}
+
+	void saveImage(const std::string& filename, const PixelImage& image)
+	{
+		if (filename.size() >= 4 && filename.compare(filename.size() - 4, 4, ".png") == 0)
+			savePNG(filename, image);
+		else
+			savePPM(filename, image);
+	}
+
+	// Returnerar den största skillnaden i någon av färgkanalerna. Alfa jämförs inte, eftersom PPM inte har det.
+	int channelDifference(uint32_t a, uint32_t b) noexcept
+	{
+		int difference = 0;
+		for (int shift = 0; shift < 24; shift += 8)
+		{
+			difference = std::max(difference, std::abs(int(a >> shift & 0xff) - int(b >> shift & 0xff)));
+		}
+		return difference;
+	}
+
+	// Skriver ut hur frame skiljer sig från golden och sparar eventuellt en bild av skillnaderna. Returnerar true om de är lika.
+	bool compareFrames(const PixelImage& frame, const PixelImage& golden, const Options& options)
+	{
+		if (frame.width != golden.width || frame.height != golden.height)
+		{
+			std::cout << "Size differs: " << frame.width << "x" << frame.height << " vs " << golden.width << "x" << golden.height << "\n";
+			return false;
+		}
+		// Skillnaderna blir röda och resten blir en mörkare gråskalebild av framen.
+		PixelImage diff = {frame.width, frame.height, std::vector<uint32_t>(frame.pixels.size())};
+		std::size_t differing = 0;
+		int maxDifference = 0;
+		unsigned minX = frame.width, minY = frame.height, maxX = 0, maxY = 0;
+		for (unsigned y = 0; y < frame.height; y++)
+		{
+			for (unsigned x = 0; x < frame.width; x++)
+			{
+				const std::size_t i = x + std::size_t(y) * frame.width;
+				const int difference = channelDifference(frame.pixels[i], golden.pixels[i]);
+				maxDifference = std::max(maxDifference, difference);
+				if (difference > options.tolerance)
+				{
+					differing++;
+					minX = std::min(minX, x);
+					minY = std::min(minY, y);
+					maxX = std::max(maxX, x);
+					maxY = std::max(maxY, y);
+					diff.pixels[i] = 0xffff0000;
+				}
+				else
+				{
+					const uint32_t p = frame.pixels[i];
+					const uint32_t grey = ((p >> 16 & 0xff) + (p >> 8 & 0xff) + (p & 0xff)) / 12;
+					diff.pixels[i] = 0xff000000 | grey << 16 | grey << 8 | grey;
+				}
+			}
+		}
+		std::printf("%zu of %zu pixels differ (%.3f%%), max channel difference %d\n",
+			differing, frame.pixels.size(), 100.0 * differing / frame.pixels.size(), maxDifference);
+		if (differing > 0) std::printf("Differences within x [%u, %u], y [%u, %u]\n", minX, maxX, minY, maxY);
+		if (!options.diff.empty()) saveImage(options.diff, diff);
+		return differing == 0;
+	}
+
+	// Returnerar tiden sedan start i millisekunder.
+	double millisecondsSince(std::chrono::steady_clock::time_point start)
+	{
+		return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	struct GameRun
+	{
+		PixelImage frame;
+		// Allokeringar från heapen efter warmupTicks.
+		std::size_t allocations;
+	};
+
+	// Kör spelet i options.ticks ticks och returnerar den sista framen.
+	GameRun runGame(const Options& options)
+	{
+		ThreadPool threadPool;
+		HeadlessPlatform platform(options.width, options.height);
+		Game game(threadPool, platform.getFrameArena(), options.seed, options.npcs);
+		RenderQueue renderQueue(platform.getFrameArena());
+		InputState input;
+		std::unique_ptr<HotReload> hotReload;
+		if (!options.world.empty())
+		{
+			hotReload = std::make_unique<HotReload>(game.getWorld(), threadPool, options.world);
+			hotReload->wait(platform);
+		}
+
+		// Spelaren går åt öster, söder, väster och norr, en fjärdedel av tiden åt varje håll.
+		static constexpr unsigned char path[] = {'D', 'S', 'A', 'W'};
+		const unsigned ticksPerSide = std::max(options.ticks / 4, 1u);
+		double tickTotal = 0.0, tickMax = 0.0, renderTotal = 0.0, renderMax = 0.0;
+		std::size_t allocations = 0;
+		unsigned allocatingTicks = 0;
+		std::size_t queueItems = 0, queueImages = 0;
+		for (unsigned i = 0; i < options.ticks && platform.update(); i++)
+		{
+			const std::size_t allocationsBefore = heapAllocations.load(std::memory_order_relaxed);
+			if (i % ticksPerSide == 0)
+			{
+				const unsigned side = i / ticksPerSide % 4;
+				if (i > 0) platform.postKey(path[(side + 3) % 4], false);
+				platform.postKey(path[side], true);
+			}
+
+			const auto tickStart = std::chrono::steady_clock::now();
+			game.tick(input.tick(platform.getInputQueue()));
+			if (hotReload) hotReload->update(platform);
+			const double tickTime = millisecondsSince(tickStart);
+
+			const auto renderStart = std::chrono::steady_clock::now();
+			RenderTarget& target = platform.beginFrame();
+			target.setScale(game.getZoom());
+			renderQueue.clear();
+			game.fillQueue(target, renderQueue, true, options.overlays);
+			renderQueue.draw(target);
+			platform.endFrame();
+			const double renderTime = millisecondsSince(renderStart);
+			queueItems += renderQueue.size();
+			for (const RenderQueue::Item& item : renderQueue.getItems())
+			{
+				queueImages += item.count;
+			}
+
+			const std::size_t tickAllocations = heapAllocations.load(std::memory_order_relaxed) - allocationsBefore;
+			if (i >= warmupTicks && tickAllocations > 0)
+			{
+				allocations += tickAllocations;
+				allocatingTicks++;
+			}
+
+			tickTotal += tickTime;
+			tickMax = std::max(tickMax, tickTime);
+			renderTotal += renderTime;
+			renderMax = std::max(renderMax, renderTime);
+		}
+		const unsigned frames = std::max(platform.getFrameCount(), 1u);
+		std::printf("%u ticks: tick %.3f ms avg, %.3f ms max; render %.3f ms avg, %.3f ms max\n",
+			platform.getFrameCount(), tickTotal / frames, tickMax, renderTotal / frames, renderMax);
+		// Bilder som upprepas räknas som ett element i kön men som flera bilder.
+		std::printf("Render queue: %zu items avg, %zu images avg\n", queueItems / frames, queueImages / frames);
+		const FrameArena& arena = platform.getFrameArena();
+		std::printf("Frame arena: %zu KiB used, %zu KiB capacity, %u overflows\n",
+			arena.getLastFrameUsed() / 1024, arena.getCapacity() / 1024, arena.getOverflowCount());
+		if (options.ticks > warmupTicks)
+		{
+			std::printf("%zu heap allocations in %u of the ticks after the first %u\n", allocations, allocatingTicks, warmupTicks);
+		}
+		if (hotReload)
+		{
+			std::printf("%u files reloaded\n", hotReload->getReloadCount());
+			if (!hotReload->getLastError().empty()) std::printf("Last reload error: %s\n", hotReload->getLastError().c_str());
+		}
+		return {platform.getFrame(), allocations};
+	}
+
+	// Lämnar alla queries till en PathService på en gång och kör update() tills alla har fått svar.
+	void runPathService(World& world, const std::vector<std::pair<TilePos, TilePos>>& queries)
+	{
+		ThreadPool threadPool;
+		PathService service(world, threadPool);
+		const auto start = std::chrono::steady_clock::now();
+		for (const auto& query : queries)
+		{
+			service.request(query.first, query.second);
+		}
+		unsigned statuses[4] = {};
+		unsigned updates = 0;
+		double updateMax = 0.0, workTotal = 0.0;
+		while (!service.idle())
+		{
+			service.waitForBatch();
+			service.update();
+			updates++;
+			for (const PathService::Result& result : service.getResults())
+			{
+				statuses[result.status]++;
+			}
+			const PathService::Metrics metrics = service.getMetrics();
+			updateMax = std::max(updateMax, metrics.lastUpdateTime);
+			workTotal += metrics.lastWorkTime;
+		}
+		const double time = millisecondsSince(start);
+		const PathService::Metrics metrics = service.getMetrics();
+		std::printf("%zu paths on %ux%u with %u threads: %.3f ms, %.0f paths/s, %u updates\n",
+			queries.size(), world.getWidth(), world.getDepth(), threadPool.getThreadCount(), time, queries.size() / (time / 1000.0), updates);
+		std::printf("%u found, %u unreachable, %u gave up; %u from the cache, %u requeued\n",
+			statuses[Pathfinder::FOUND], statuses[Pathfinder::UNREACHABLE], statuses[Pathfinder::GAVE_UP], metrics.cacheHits, metrics.requeued);
+		std::printf("Latency %.3f ms avg, %.3f ms max, %.1f updates avg, %u max; update %.3f ms max; %.3f ms work in jobs\n",
+			metrics.averageLatency, metrics.maxLatency, metrics.averageLatencyTicks, metrics.maxLatencyTicks, updateMax, workTotal);
+	}
+
+	// Stegen till de åtta grannarna i samma ordning som bitarna i walkableNeighbours().
+	struct PathStep
+	{
+		NeighbourBit bit;
+		int dx;
+		int dz;
+		uint32_t cost;
+	};
+	const PathStep pathSteps[] = {
+		{NEIGHBOUR_N, 0, -1, Pathfinder::straightCost},
+		{NEIGHBOUR_S, 0, 1, Pathfinder::straightCost},
+		{NEIGHBOUR_E, 1, 0, Pathfinder::straightCost},
+		{NEIGHBOUR_W, -1, 0, Pathfinder::straightCost},
+		{NEIGHBOUR_NE, 1, -1, Pathfinder::diagonalCost},
+		{NEIGHBOUR_NW, -1, -1, Pathfinder::diagonalCost},
+		{NEIGHBOUR_SE, 1, 1, Pathfinder::diagonalCost},
+		{NEIGHBOUR_SW, -1, 1, Pathfinder::diagonalCost}
+	};
+
+	// Skriver den lägsta kostnaden från start till varje tile till costs med Dijkstra, eller UINT32_MAX.
+	void dijkstra(const Matrix<uint16_t>& heights, TilePos start, std::vector<uint32_t>& costs)
+	{
+		const int depth = heights.getHeight();
+		costs.assign(std::size_t(heights.getWidth()) * depth, UINT32_MAX);
+		typedef std::pair<uint32_t, uint32_t> Entry;
+		std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+		costs[std::size_t(start.x) * depth + start.z] = 0;
+		open.push({0, uint32_t(start.x) * depth + start.z});
+		while (!open.empty())
+		{
+			const Entry entry = open.top();
+			open.pop();
+			if (entry.first != costs[entry.second]) continue;
+			const int x = entry.second / depth;
+			const int z = entry.second % depth;
+			const unsigned char mask = walkableNeighbours(heights, x, z);
+			for (const PathStep& step : pathSteps)
+			{
+				if (!(mask & step.bit)) continue;
+				const uint32_t neighbour = uint32_t(x + step.dx) * depth + (z + step.dz);
+				if (entry.first + step.cost >= costs[neighbour]) continue;
+				costs[neighbour] = entry.first + step.cost;
+				open.push({costs[neighbour], neighbour});
+			}
+		}
+	}
+
+	// Returnerar kostnaden för att gå path, eller UINT32_MAX om något steg inte går att ta.
+	uint32_t pathCost(const Matrix<uint16_t>& heights, const std::vector<TilePos>& path)
+	{
+		uint32_t cost = 0;
+		for (std::size_t i = 1; i < path.size(); i++)
+		{
+			const PathStep* taken = nullptr;
+			for (const PathStep& step : pathSteps)
+			{
+				if (path[i].x - path[i - 1].x == step.dx && path[i].z - path[i - 1].z == step.dz) taken = &step;
+			}
+			if (!taken || !(walkableNeighbours(heights, path[i - 1].x, path[i - 1].z) & taken->bit)) return UINT32_MAX;
+			cost += taken->cost;
+		}
+		return cost;
+	}
+
+	// Gör världen platt och lägger till count slumpmässiga block på upp till 8 * 8 tiles, som med --obstacles.
+	void addObstacles(World& world, int count, std::mt19937& rng)
+	{
+		const int width = world.getWidth();
+		const int depth = world.getDepth();
+		world.setHeight({0, 0, width, depth}, 0);
+		for (int i = 0; i < count; i++)
+		{
+			const int x = rng() % width;
+			const int z = rng() % depth;
+			const int endX = x + 1 + rng() % 8;
+			const int endZ = z + 1 + rng() % 8;
+			world.setHeight({x, z, endX, endZ}, static_cast<uint16_t>(1 + rng() % 3));
+		}
+	}
+
+	// Returnerar true om graph har samma noder och kanter som en graf som byggs från början från världen.
+	bool sameAsRebuilt(PathGraph& graph, World& world)
+	{
+		graph.update();
+		const PathGraph rebuilt(world);
+		if (graph.getNodeCount() != rebuilt.getNodeCount() || graph.getEdgeCount() != rebuilt.getEdgeCount()) return false;
+		const uint32_t tiles = world.getWidth() * world.getDepth();
+		auto same = [](std::pair<const PathGraph::Edge*, const PathGraph::Edge*> a, std::pair<const PathGraph::Edge*, const PathGraph::Edge*> b) {
+			if (a.second - a.first != b.second - b.first) return false;
+			for (auto e = a.first, f = b.first; e != a.second; ++e, ++f)
+			{
+				if (e->tile != f->tile || e->cost != f->cost) return false;
+			}
+			return true;
+		};
+		for (uint32_t tile = 0; tile < tiles; tile++)
+		{
+			if (!same(graph.edgesFrom(tile), rebuilt.edgesFrom(tile)) || !same(graph.edgesTo(tile), rebuilt.edgesTo(tile))) return false;
+		}
+		return true;
+	}
+
+	/*
+	 * Jämför vägar med Dijkstra över alla tiles. Utan PathGraph ska Pathfinder hitta en väg med lägsta
+	 * kostnad precis när Dijkstra gör det, även när målet ligger på en platå som den bakåtriktade
+	 * floodStep() ska upptäcka. Med en PathGraph ska vägarna gå att gå och hittas precis när Dijkstra hittar
+	 * en, och de får vara högst maxGraphOverhead längre. Grafen byggs om medan världen ändras och jämförs med
+	 * en som byggs från början. Sist ska PathCache ge samma väg igen och glömma vägar genom ändringar.
+	 * Returnerar false om något är fel.
+	*/
+	bool checkPaths(const Options& options)
+	{
+		constexpr double maxGraphOverhead = 0.25;
+		std::mt19937 rng(options.seed);
+		Pathfinder pathfinder;
+		std::vector<TilePos> path;
+		std::vector<uint32_t> costs;
+		unsigned failures = 0;
+		auto fail = [&](const char* what, TilePos start, TilePos goal) {
+			if (failures++ < 10)
+			{
+				std::printf("%s from (%d, %d) to (%d, %d)\n", what, start.x, start.z, goal.x, goal.z);
+			}
+		};
+		/*
+		 * Jämför en sökning från start till goal med Dijkstra i costs. Returnerar kostnaden för vägen, eller
+		 * UINT32_MAX om den inte hittades.
+		*/
+		auto check = [&](const Matrix<uint16_t>& heights, TilePos start, TilePos goal, Pathfinder::Status status) -> uint32_t {
+			const uint32_t best = costs[std::size_t(goal.x) * heights.getHeight() + goal.z];
+			if (status == Pathfinder::UNREACHABLE)
+			{
+				if (best != UINT32_MAX) fail("Unreachable but Dijkstra found a path", start, goal);
+				if (!path.empty()) fail("Unreachable with a path", start, goal);
+				return UINT32_MAX;
+			}
+			if (status != Pathfinder::FOUND)
+			{
+				fail("Gave up or invalid", start, goal);
+				return UINT32_MAX;
+			}
+			if (best == UINT32_MAX) fail("Found a path that Dijkstra did not", start, goal);
+			if (path.empty() || path.front() != start || path.back() != goal) fail("The path does not go from start to goal", start, goal);
+			const uint32_t cost = pathCost(heights, path);
+			if (cost == UINT32_MAX) fail("The path takes a step that can't be taken", start, goal);
+			return cost;
+		};
+
+		// Pathfinder utan graf, på små världar med slumpade höjder och med block.
+		unsigned found = 0, unreachable = 0;
+		for (unsigned w = 0; w < 300; w++)
+		{
+			World world(rng(), 1 + rng() % 30, 1 + rng() % 30);
+			if (w % 2 == 1) addObstacles(world, 1 + rng() % 20, rng);
+			const Matrix<uint16_t>& heights = world.getHeights();
+			for (unsigned q = 0; q < 30; q++)
+			{
+				const TilePos start = {int(rng() % world.getWidth()), int(rng() % world.getDepth())};
+				const TilePos goal = {int(rng() % world.getWidth()), int(rng() % world.getDepth())};
+				dijkstra(heights, start, costs);
+				const uint32_t cost = check(heights, start, goal, pathfinder.findPath(heights, start, goal, path));
+				if (cost == UINT32_MAX)
+				{
+					unreachable++;
+					continue;
+				}
+				found++;
+				if (cost != costs[std::size_t(goal.x) * heights.getHeight() + goal.z]) fail("The path is not the shortest", start, goal);
+			}
+		}
+		std::printf("Pathfinder: %u paths the same as Dijkstra, %u unreachable\n", found, unreachable);
+
+		// PathGraph på större världar som ändras mellan sökningarna.
+		unsigned graphFound = 0, graphUnreachable = 0, rebuildFailures = 0;
+		double overheadSum = 0.0, overheadMax = 0.0;
+		for (unsigned w = 0; w < 40; w++)
+		{
+			World world(rng(), 40 + rng() % 100, 40 + rng() % 100);
+			if (w % 2 == 1) addObstacles(world, world.getWidth() * world.getDepth() / 80, rng);
+			PathGraph graph(world);
+			const Matrix<uint16_t>& heights = world.getHeights();
+			for (unsigned q = 0; q < 100; q++)
+			{
+				const TilePos start = {int(rng() % world.getWidth()), int(rng() % world.getDepth())};
+				const TilePos goal = {int(rng() % world.getWidth()), int(rng() % world.getDepth())};
+				if (std::max(std::abs(goal.x - start.x), std::abs(goal.z - start.z)) < Pathfinder::minHierarchicalDistance) continue;
+				dijkstra(heights, start, costs);
+				const uint32_t cost = check(heights, start, goal, pathfinder.findPath(heights, start, goal, path, nullptr, &graph));
+				if (cost == UINT32_MAX)
+				{
+					graphUnreachable++;
+				}
+				else
+				{
+					graphFound++;
+					const double overhead = double(cost) / costs[std::size_t(goal.x) * heights.getHeight() + goal.z] - 1.0;
+					if (overhead < 0.0) fail("The path is shorter than the shortest", start, goal);
+					if (overhead > maxGraphOverhead) fail("The path through the graph is too long", start, goal);
+					overheadSum += overhead;
+					overheadMax = std::max(overheadMax, overhead);
+				}
+
+				/*
+				 * Ändra världen då och då, så att grafen byggs om där, och jämför den med en ny graf. Hälften av
+				 * ändringarna börjar eller slutar vid en klustergräns.
+				*/
+				if (q % 5 == 4)
+				{
+					int x = rng() % world.getWidth();
+					int z = rng() % world.getDepth();
+					if (rng() % 2) x = x / PathGraph::clusterSize * PathGraph::clusterSize - int(rng() % 2);
+					if (rng() % 2) z = z / PathGraph::clusterSize * PathGraph::clusterSize - int(rng() % 2);
+					const int endX = x + 1 + rng() % 6;
+					const int endZ = z + 1 + rng() % 6;
+					world.setHeight({x, z, endX, endZ}, static_cast<uint16_t>(rng() % 4));
+					if (!sameAsRebuilt(graph, world))
+					{
+						rebuildFailures++;
+						failures++;
+					}
+				}
+			}
+		}
+
+		/*
+		 * En värld där det enda sättet över gränsen mellan de två första klustren är ett diagonalt steg från
+		 * (15, 7) till (16, 8), eftersom de raka stegen går ner i diken som man inte kan gå upp ur.
+		*/
+		{
+			World world(options.seed, 3 * PathGraph::clusterSize, PathGraph::clusterSize);
+			world.setHeight({0, 0, 16, 16}, 3);
+			world.setHeight({15, 8, 16, 16}, 0);
+			world.setHeight({16, 0, 48, 16}, 2);
+			world.setHeight({16, 0, 17, 8}, 0);
+			PathGraph graph(world);
+			const TilePos start = {2, 2};
+			const TilePos goal = {40, 8};
+			dijkstra(world.getHeights(), start, costs);
+			if (check(world.getHeights(), start, goal, pathfinder.findPath(world.getHeights(), start, goal, path, nullptr, &graph)) == UINT32_MAX)
+			{
+				fail("No path through the graph over a diagonal step", start, goal);
+			}
+		}
+		std::printf("PathGraph: %u paths valid, %u unreachable like Dijkstra, %.2f%% longer avg, %.2f%% max; %u rebuilt graphs differ\n",
+			graphFound, graphUnreachable, 100.0 * overheadSum / std::max(graphFound, 1u), 100.0 * overheadMax, rebuildFailures);
+
+		// PathCache ska ge samma väg igen, och aldrig en väg genom något som har ändrats.
+		World world(options.seed, 40, 40);
+		addObstacles(world, 20, rng);
+		PathCache cache(world, 4);
+		unsigned stored = 0;
+		for (unsigned q = 0; q < 2000; q++)
+		{
+			const TilePos start = {int(rng() % 40), int(rng() % 40)};
+			const TilePos goal = {int(rng() % 40), int(rng() % 40)};
+			// En väg till samma tile sparas inte.
+			if (start != goal && pathfinder.findPath(world.getHeights(), start, goal, path, &cache) == Pathfinder::FOUND)
+			{
+				stored++;
+				if (pathCost(world.getHeights(), path) == UINT32_MAX) fail("A cached path takes a step that can't be taken", start, goal);
+				const unsigned hits = cache.getHits();
+				std::vector<TilePos> again;
+				pathfinder.findPath(world.getHeights(), start, goal, again, &cache);
+				if (cache.getHits() != hits + 1 || again != path) fail("The cache did not return the same path", start, goal);
+			}
+			if (q % 3 == 0) world.raise(rng() % 40, rng() % 40, int(rng() % 3) - 1);
+			if (cache.size() > 4) fail("The cache holds too many paths", start, goal);
+		}
+		std::printf("PathCache: %u paths found, %u hits, %u misses\n", stored, cache.getHits(), cache.getMisses());
+
+		if (failures > 0)
+		{
+			std::printf("%u path checks failed\n", failures);
+			return false;
+		}
+		return true;
+	}
+
+	// Söker options.paths vägar mellan slumpmässiga tiles, först utan cache och sedan två gånger med.
+	void runPaths(const Options& options)
+	{
+		World world(options.seed, options.worldWidth, options.worldDepth);
+		// Hinder och vägar slumpas från en egen ström, så att de inte följer världens höjder.
+		std::mt19937 rng(options.seed + 1);
+		if (options.obstacles >= 0)
+		{
+			addObstacles(world, options.obstacles, rng);
+			world.clearJournal();
+		}
+		std::vector<std::pair<TilePos, TilePos>> queries(options.paths);
+		for (auto& query : queries)
+		{
+			query.first.x = rng() % world.getWidth();
+			query.first.z = rng() % world.getDepth();
+			if (options.pathRange > 0)
+			{
+				const int range = options.pathRange;
+				const int dx = int(rng() % unsigned(2 * range + 1)) - range;
+				const int dz = int(rng() % unsigned(2 * range + 1)) - range;
+				query.second = {
+					std::clamp(query.first.x + dx, 0, int(world.getWidth()) - 1),
+					std::clamp(query.first.z + dz, 0, int(world.getDepth()) - 1)
+				};
+			}
+			else
+			{
+				query.second.x = rng() % world.getWidth();
+				query.second.z = rng() % world.getDepth();
+			}
+		}
+
+		if (options.asyncPaths)
+		{
+			runPathService(world, queries);
+			return;
+		}
+
+		std::unique_ptr<PathGraph> graph;
+		if (options.graphPaths)
+		{
+			const auto graphStart = std::chrono::steady_clock::now();
+			graph = std::make_unique<PathGraph>(world);
+			std::printf("PathGraph: %.3f ms to build, %zu nodes, %zu edges\n",
+				millisecondsSince(graphStart), graph->getNodeCount(), graph->getEdgeCount());
+		}
+
+		Pathfinder pathfinder;
+		std::vector<TilePos> path;
+		unsigned statuses[4] = {};
+		std::size_t expanded = 0, length = 0;
+		const auto start = std::chrono::steady_clock::now();
+		for (const auto& query : queries)
+		{
+			const Pathfinder::Status status = pathfinder.findPath(world.getHeights(), query.first, query.second, path, nullptr, graph.get());
+			statuses[status]++;
+			expanded += pathfinder.getLastExpanded();
+			length += path.size();
+		}
+		const double time = millisecondsSince(start);
+		std::printf("%u paths on %ux%u: %.3f ms, %.0f paths/s\n",
+			options.paths, world.getWidth(), world.getDepth(), time, options.paths / (time / 1000.0));
+		std::printf("%u found, %u unreachable, %u gave up; %zu tiles expanded avg, %zu tiles per found path avg\n",
+			statuses[Pathfinder::FOUND], statuses[Pathfinder::UNREACHABLE], statuses[Pathfinder::GAVE_UP],
+			expanded / std::max(options.paths, 1u), length / std::max(statuses[Pathfinder::FOUND], 1u));
+
+		// Den andra gången finns alla vägar som hittades i cachen.
+		PathCache cache(world, queries.size());
+		for (unsigned pass = 0; pass < 2; pass++)
+		{
+			const auto passStart = std::chrono::steady_clock::now();
+			for (const auto& query : queries)
+			{
+				pathfinder.findPath(world.getHeights(), query.first, query.second, path, &cache, graph.get());
+			}
+			const double passTime = millisecondsSince(passStart);
+			std::printf("With cache, pass %u: %.3f ms, %.0f paths/s\n", pass + 1, passTime, options.paths / (passTime / 1000.0));
+		}
+		std::printf("Cache: %u hits, %u misses, %zu paths\n", cache.getHits(), cache.getMisses(), cache.size());
+	}
+
+	// En aktör som flyttas med moveActor(), för att jämföra med samma aktör i Entities.
+	struct Actor
+	{
+		EntityID id;
+		FixedPoint3D pos;
+		Fixed yVel;
+		Fixed velX;
+		Fixed velZ;
+	};
+
+	// Returnerar en hastighet i [-maxSpeed, maxSpeed).
+	Fixed randomSpeed(std::mt19937& rng, double maxSpeed)
+	{
+		return Fixed((rng() / 2147483648.0 - 1.0) * maxSpeed);
+	}
+
+	/*
+	 * Lägger till count aktörer på slumpmässiga tiles i entities, en bit ovanför marken så att de faller,
+	 * och returnerar dem.
+	*/
+	std::vector<Actor> addActors(World& world, Entities& entities, unsigned count, std::mt19937& rng)
+	{
+		std::vector<Actor> actors(count);
+		for (Actor& actor : actors)
+		{
+			const unsigned x = rng() % world.getWidth();
+			const unsigned z = rng() % world.getDepth();
+			const double y = (world.heightAt(x, z) + rng() % 4) * double(tileHeight);
+			actor.pos = FixedPoint3D::fromPoint3D({(x + 0.5) * tileWidth, y, (z + 0.5) * tileTopHeight});
+			actor.yVel = Fixed();
+			actor.velX = randomSpeed(rng, 6.0);
+			actor.velZ = randomSpeed(rng, 6.0);
+			actor.id = entities.add(actor.pos, Hitbox{16.0, 16.0, 16.0}, Image(ImageID::LOWERCASEMU, 16.0, 16.0));
+			entities.setVelocity(entities.indexOf(actor.id), actor.velX, actor.velZ);
+		}
+		return actors;
+	}
+
+	/*
+	 * Flyttar options.checkActors aktörer både en och en med moveActor() och tillsammans med
+	 * Entities::update() med flera trådar, med samma hastigheter, och jämför positionerna och yVel efter
+	 * varje tick. Entiteterna sorteras om och får nya hastigheter då och då, som i spelet. Returnerar false
+	 * vid första skillnaden.
+	*/
+	bool checkActors(const Options& options)
+	{
+		const unsigned ticks = options.ticks > 0 ? options.ticks : 600;
+		World world(options.seed, options.worldWidth, options.worldDepth);
+		std::mt19937 rng(options.seed + 1);
+		// Flera trådar även på en kärna, så att bitarna i parallelFor verkligen körs på olika trådar.
+		ThreadPool threadPool(4);
+		FrameArena arena;
+		Entities entities;
+		std::vector<Actor> actors = addActors(world, entities, options.checkActors, rng);
+
+		for (unsigned tick = 0; tick < ticks; tick++)
+		{
+			if (tick % 50 == 49)
+			{
+				for (Actor& actor : actors)
+				{
+					actor.velX = randomSpeed(rng, 6.0);
+					actor.velZ = randomSpeed(rng, 6.0);
+					entities.setVelocity(entities.indexOf(actor.id), actor.velX, actor.velZ);
+				}
+			}
+			if (tick % Game::ticksPerSort == 0)
+			{
+				entities.sortSpatially(arena);
+				arena.reset();
+			}
+
+			for (Actor& actor : actors)
+			{
+				moveActor(actor.pos, actor.yVel, Hitbox{16.0, 16.0, 16.0}, actor.velX, actor.velZ, false, world);
+			}
+			entities.update(world, threadPool);
+
+			for (std::size_t a = 0; a < actors.size(); a++)
+			{
+				const Actor& actor = actors[a];
+				const unsigned i = entities.indexOf(actor.id);
+				const FixedPoint3D pos = entities.getPos(i);
+				if (pos.x != actor.pos.x || pos.y != actor.pos.y || pos.z != actor.pos.z || entities.getYVel(i) != actor.yVel)
+				{
+					std::printf("Actor %zu differs after tick %u: moveActor (%.17g, %.17g, %.17g) yVel %.17g, Entities (%.17g, %.17g, %.17g) yVel %.17g\n",
+						a, tick + 1, actor.pos.x.toDouble(), actor.pos.y.toDouble(), actor.pos.z.toDouble(), actor.yVel.toDouble(),
+						pos.x.toDouble(), pos.y.toDouble(), pos.z.toDouble(), entities.getYVel(i).toDouble());
+					return false;
+				}
+			}
+		}
+		std::printf("%u actors on %ux%u moved the same with moveActor() and Entities::update() for %u ticks\n",
+			options.checkActors, world.getWidth(), world.getDepth(), ticks);
+		return true;
+	}
+
+	/*
+	 * Styr spelaren i ett Game med slumpade tangenttryckningar genom en InputQueue, som i fönstret, och flyttar
+	 * en entitet med den hastighet och det hopp som tangenterna ska ge. Hastigheten räknas ut här från
+	 * tangenterna, så en ändring i Game::tick() eller Player::logic() syns som en skillnad. Positionen och
+	 * yVel jämförs efter varje tick. Returnerar false vid första skillnaden.
+	*/
+	bool checkPlayer(const Options& options)
+	{
+		const unsigned ticks = options.ticks > 0 ? options.ticks : 600;
+		ThreadPool threadPool;
+		FrameArena arena;
+		Game game(threadPool, arena, options.seed);
+		const Player& player = game.getPlayer();
+		const auto queue = std::make_unique<InputQueue>();
+		InputState input;
+		Entities entities;
+		entities.add(player.pos, player.getHitbox(), player.image);
+
+		// W, A, S, D och mellanslag, och om de hålls nere.
+		static constexpr unsigned char keys[] = {'W', 'A', 'S', 'D', KEY_SPACE};
+		bool held[5] = {};
+		std::mt19937 rng(options.seed + 2);
+		unsigned jumps = 0;
+		for (unsigned tick = 0; tick < ticks; tick++)
+		{
+			// Ändra en tangent ungefär var sjätte tick, och tryck ibland ner och släpp mellanslag under samma tick.
+			auto post = [&](unsigned k, bool down) {
+				queue->push({down ? InputEvent::KEY_DOWN : InputEvent::KEY_UP, InputClock::now(), keys[k], L'\0', 0, 0});
+			};
+			if (rng() % 6 == 0)
+			{
+				const unsigned k = rng() % 5;
+				held[k] = !held[k];
+				post(k, held[k]);
+			}
+			if (!held[4] && rng() % 20 == 0)
+			{
+				post(4, true);
+				post(4, false);
+			}
+			game.tick(input.tick(*queue));
+
+			// Spelaren går bara åt de åtta riktningarna, så med motsatta tangenter nere står den still.
+			const int x = int(held[3]) - int(held[1]);
+			const int z = int(held[2]) - int(held[0]);
+			const bool opposite = (held[0] && held[2]) || (held[1] && held[3]);
+			const double speed = x != 0 && z != 0 ? Player::speed * invSqrt2 : Player::speed;
+			entities.setVelocity(0, Fixed(opposite ? 0.0 : x * speed), Fixed(opposite ? 0.0 : z * speed));
+			entities.setJumping(0, held[4]);
+			entities.update(game.getWorld());
+			jumps += entities.getYVel(0) == Fixed(jumpSpeed);
+
+			const FixedPoint3D pos = entities.getPos(0);
+			if (pos.x != player.pos.x || pos.y != player.pos.y || pos.z != player.pos.z || entities.getYVel(0) != player.getYVel())
+			{
+				std::printf("The player differs after tick %u: Player (%.17g, %.17g, %.17g) yVel %.17g, Entities (%.17g, %.17g, %.17g) yVel %.17g\n",
+					tick + 1, player.pos.x.toDouble(), player.pos.y.toDouble(), player.pos.z.toDouble(), player.getYVel().toDouble(),
+					pos.x.toDouble(), pos.y.toDouble(), pos.z.toDouble(), entities.getYVel(0).toDouble());
+				return false;
+			}
+		}
+		std::printf("The player moved the same as an entity with the same keys for %u ticks, with %u jumps\n", ticks, jumps);
+		return true;
+	}
+
+	// Returnerar masken från walkableNeighbours() för (x, z), räknad för sig för varje granne.
+	unsigned char naiveWalkableNeighbours(const Matrix<uint16_t>& heights, int x, int z)
+	{
+		const int width = heights.getWidth();
+		const int depth = heights.getHeight();
+		auto inside = [&](int tileX, int tileZ) {
+			return tileX >= 0 && tileZ >= 0 && tileX < width && tileZ < depth;
+		};
+		if (!inside(x, z)) return 0;
+		auto walkable = [&](int tileX, int tileZ) {
+			return inside(tileX, tileZ) && heights[tileX][tileZ] <= heights[x][z];
+		};
+		const bool n = walkable(x, z - 1);
+		const bool s = walkable(x, z + 1);
+		const bool e = walkable(x + 1, z);
+		const bool w = walkable(x - 1, z);
+		unsigned char mask = 0;
+		if (n) mask |= NEIGHBOUR_N;
+		if (s) mask |= NEIGHBOUR_S;
+		if (e) mask |= NEIGHBOUR_E;
+		if (w) mask |= NEIGHBOUR_W;
+		if (n && e && walkable(x + 1, z - 1)) mask |= NEIGHBOUR_NE;
+		if (n && w && walkable(x - 1, z - 1)) mask |= NEIGHBOUR_NW;
+		if (s && e && walkable(x + 1, z + 1)) mask |= NEIGHBOUR_SE;
+		if (s && w && walkable(x - 1, z + 1)) mask |= NEIGHBOUR_SW;
+		return mask;
+	}
+
+	/*
+	 * Jämför copyHeights(), heightRange() och walkableNeighbours() för rektanglar med samma sak en tile i
+	 * taget, och sampleLine() med de tiles som ligger närmast linjen. Världarna och rektanglarna slumpas
+	 * så att rektanglarna och linjerna ofta går utanför kanterna, och var tredje värld har höjder nära
+	 * 65535. Returnerar false om något skiljer sig.
+	*/
+	bool checkHeightQueries(const Options& options)
+	{
+		constexpr unsigned worlds = 500;
+		constexpr unsigned queriesPerWorld = 20;
+		constexpr uint16_t outside = 12345;
+		// Värden som inte får skrivas över efter det som funktionerna ska skriva.
+		constexpr uint16_t guardHeight = 7777;
+		constexpr unsigned char guardMask = 99;
+		std::mt19937 rng(options.seed);
+		unsigned failures = 0;
+		auto fail = [&](const char* what, unsigned world, TileRect area) {
+			if (failures++ < 10)
+			{
+				std::printf("%s differs in world %u for (%d, %d)-(%d, %d)\n", what, world, area.startX, area.startZ, area.endX, area.endZ);
+			}
+		};
+
+		for (unsigned w = 0; w < worlds; w++)
+		{
+			const int width = 1 + rng() % 40;
+			const int depth = 1 + rng() % 40;
+			auto inside = [&](int x, int z) {return x >= 0 && z >= 0 && x < width && z < depth;};
+			Matrix<uint16_t> heights(width, depth);
+			for (int x = 0; x < width; x++)
+			{
+				for (int z = 0; z < depth; z++)
+				{
+					heights[x][z] = static_cast<uint16_t>(rng() % 4 + (w % 3 == 0 ? 65532 : 0));
+				}
+			}
+			// Varje tile får en egen höjd här, så att sampleLine() visar vilka tiles den gick genom.
+			Matrix<uint16_t> tileIDs(width, depth);
+			for (int x = 0; x < width; x++)
+			{
+				for (int z = 0; z < depth; z++)
+				{
+					tileIDs[x][z] = static_cast<uint16_t>(x * depth + z);
+				}
+			}
+
+			for (unsigned q = 0; q < queriesPerWorld; q++)
+			{
+				TileRect area;
+				area.startX = int(rng() % unsigned(width + 20)) - 10;
+				area.startZ = int(rng() % unsigned(depth + 20)) - 10;
+				area.endX = area.startX + rng() % 30;
+				area.endZ = area.startZ + rng() % 30;
+				const int areaWidth = area.endX - area.startX;
+				const int areaDepth = area.endZ - area.startZ;
+				const std::size_t count = std::size_t(areaWidth) * areaDepth;
+
+				std::vector<uint16_t> copied(count + 1, guardHeight);
+				const TileRect clipped = copyHeights(heights, area, copied.data(), outside);
+				std::vector<unsigned char> masks(count + 1, guardMask);
+				walkableNeighbours(heights, area, masks.data());
+				const HeightPyramid::MinMax range = heightRange(heights, area);
+
+				TileRect expectedClip = {std::max(area.startX, 0), std::max(area.startZ, 0), std::min(area.endX, width), std::min(area.endZ, depth)};
+				if (expectedClip.startX >= expectedClip.endX || expectedClip.startZ >= expectedClip.endZ) expectedClip = {0, 0, 0, 0};
+				const TileRect clippedEmpty = clipped.startX >= clipped.endX || clipped.startZ >= clipped.endZ ? TileRect{0, 0, 0, 0} : clipped;
+				if (clippedEmpty.startX != expectedClip.startX || clippedEmpty.startZ != expectedClip.startZ ||
+					clippedEmpty.endX != expectedClip.endX || clippedEmpty.endZ != expectedClip.endZ)
+				{
+					fail("copyHeights() clipping", w, area);
+				}
+
+				uint16_t min = 65535, max = 0;
+				bool heightsOk = true, masksOk = true, singleMasksOk = true;
+				for (int x = area.startX; x < area.endX; x++)
+				{
+					for (int z = area.startZ; z < area.endZ; z++)
+					{
+						const std::size_t i = std::size_t(x - area.startX) * areaDepth + (z - area.startZ);
+						const bool in = inside(x, z);
+						if (in)
+						{
+							min = std::min(min, heights[x][z]);
+							max = std::max(max, heights[x][z]);
+						}
+						const unsigned char expectedMask = naiveWalkableNeighbours(heights, x, z);
+						heightsOk &= copied[i] == (in ? heights[x][z] : outside);
+						masksOk &= masks[i] == expectedMask;
+						singleMasksOk &= walkableNeighbours(heights, x, z) == expectedMask;
+					}
+				}
+				if (!heightsOk || copied[count] != guardHeight) fail("copyHeights()", w, area);
+				if (!masksOk || masks[count] != guardMask) fail("walkableNeighbours() for an area", w, area);
+				if (!singleMasksOk) fail("walkableNeighbours() for a tile", w, area);
+				if (range.min != min || range.max != max) fail("heightRange()", w, area);
+
+				/*
+				 * Linjen går ett steg per tile längs den längsta axeln, och på den andra axeln ska tilen vara den som
+				 * ligger närmast linjen. Mitt emellan två tiles duger båda.
+				*/
+				const int startX = int(rng() % unsigned(width + 20)) - 10;
+				const int startZ = int(rng() % unsigned(depth + 20)) - 10;
+				const int endX = int(rng() % unsigned(width + 20)) - 10;
+				const int endZ = int(rng() % unsigned(depth + 20)) - 10;
+				const TileRect line = {startX, startZ, endX, endZ};
+				const bool xMajor = std::abs(endX - startX) >= std::abs(endZ - startZ);
+				const int majorStart = xMajor ? startX : startZ;
+				const int minorStart = xMajor ? startZ : startX;
+				const int majorLength = std::abs(xMajor ? endX - startX : endZ - startZ);
+				const int minorLength = std::abs(xMajor ? endZ - startZ : endX - startX);
+				const int majorStep = (xMajor ? endX > startX : endZ > startZ) ? 1 : -1;
+				const int minorStep = (xMajor ? endZ > startZ : endX > startX) ? 1 : -1;
+				const std::size_t lineCount = majorLength + 1;
+
+				std::vector<uint16_t> samples(lineCount + 1, guardHeight);
+				if (sampleLine(tileIDs, startX, startZ, endX, endZ, samples.data(), lineCount, outside) != lineCount || samples[lineCount] != guardHeight)
+				{
+					fail("sampleLine() count", w, line);
+					continue;
+				}
+				bool lineOk = true;
+				for (std::size_t i = 0; i < lineCount; i++)
+				{
+					const int major = majorStart + majorStep * int(i);
+					const int along = int(i) * minorLength;
+					const int whole = majorLength > 0 ? along / majorLength : 0;
+					const int rest = majorLength > 0 ? along % majorLength : 0;
+					bool matched = false;
+					for (int candidate = whole; candidate <= whole + 1; candidate++)
+					{
+						if (candidate == whole ? 2 * rest > majorLength : 2 * rest < majorLength) continue;
+						const int minor = minorStart + minorStep * candidate;
+						const int x = xMajor ? major : minor;
+						const int z = xMajor ? minor : major;
+						matched |= samples[i] == (inside(x, z) ? tileIDs[x][z] : outside);
+					}
+					lineOk &= matched;
+				}
+				if (!lineOk || samples.front() != (inside(startX, startZ) ? tileIDs[startX][startZ] : outside) ||
+					samples[lineCount - 1] != (inside(endX, endZ) ? tileIDs[endX][endZ] : outside))
+				{
+					fail("sampleLine()", w, line);
+				}
+
+				// Med för lite plats skrivs bara början av linjen, men hela längden returneras.
+				uint16_t prefix[4] = {guardHeight, guardHeight, guardHeight, guardHeight};
+				const std::size_t prefixCount = std::min<std::size_t>(lineCount, 3);
+				if (sampleLine(tileIDs, startX, startZ, endX, endZ, prefix, 3, outside) != lineCount ||
+					!std::equal(prefix, prefix + prefixCount, samples.begin()) || prefix[prefixCount] != guardHeight)
+				{
+					fail("sampleLine() with a short buffer", w, line);
+				}
+			}
+		}
+		if (failures > 0)
+		{
+			std::printf("%u height queries differ\n", failures);
+			return false;
+		}
+		std::printf("Height queries match one tile at a time for %u worlds, %u areas and %u lines\n",
+			worlds, worlds * queriesPerWorld, worlds * queriesPerWorld);
+		return true;
+	}
+
+	/*
+	 * Ändrar slumpmässiga världar med setHeight(), raise(), raiseCircle() och undo() och jämför efter varje
+	 * ändring World::getTopRuns() och grannmaskerna med samma sak räknad från början för hela världen. Hälften
+	 * av världarna börjar platta, så att ändringarna ofta hamnar mitt i långa rader och bara en del av raden
+	 * till vänster behöver räknas om. Returnerar false om något skiljer sig.
+	*/
+	bool checkTopRuns(const Options& options)
+	{
+		constexpr unsigned worlds = 200;
+		constexpr unsigned editsPerWorld = 50;
+		std::mt19937 rng(options.seed);
+		unsigned failures = 0;
+		std::size_t tilesInRuns = 0, tiles = 0;
+		for (unsigned w = 0; w < worlds; w++)
+		{
+			const int width = 1 + rng() % 60;
+			const int depth = 1 + rng() % 60;
+			World world(options.seed + w, width, depth);
+			if (w % 2 == 0)
+			{
+				world.setHeight({0, 0, width, depth}, static_cast<uint16_t>(rng() % 3));
+				world.clearJournal();
+			}
+			Matrix<uint16_t> runs(width, depth);
+			for (unsigned e = 0; e < editsPerWorld; e++)
+			{
+				const int x = int(rng() % unsigned(width + 10)) - 5;
+				const int z = int(rng() % unsigned(depth + 10)) - 5;
+				switch (rng() % 5)
+				{
+				case 0:
+					world.setHeight(x, z, static_cast<uint16_t>(rng() % 4));
+					break;
+				case 1:
+					world.setHeight({x, z, x + 1 + int(rng() % 12), z + 1 + int(rng() % 4)}, static_cast<uint16_t>(rng() % 4));
+					break;
+				case 2:
+					world.raise({x, z, x + 1 + int(rng() % 12), z + 1 + int(rng() % 4)}, int(rng() % 5) - 2);
+					break;
+				case 3:
+					world.raiseCircle(x, z, rng() % 6, int(rng() % 5) - 2);
+					break;
+				default:
+					world.undo();
+					break;
+				}
+
+				const Matrix<uint16_t>& heights = world.getHeights();
+				bool runsOk = true, masksOk = true;
+				for (int tileZ = 0; tileZ < depth; tileZ++)
+				{
+					for (int tileX = width - 1; tileX >= 0; tileX--)
+					{
+						const uint16_t h = heights[tileX][tileZ];
+						const bool visible = tileZ == depth - 1 || heights[tileX][tileZ + 1] <= h + 1;
+						const bool continues = tileX + 1 < width && runs[tileX + 1][tileZ] > 0 && heights[tileX + 1][tileZ] == h &&
+							&world.tileAt(tileX + 1, tileZ).type == &world.tileAt(tileX, tileZ).type;
+						runs[tileX][tileZ] = visible ? (continues ? runs[tileX + 1][tileZ] + 1 : 1) : 0;
+						runsOk &= world.getTopRuns()[tileX][tileZ] == runs[tileX][tileZ];
+						tilesInRuns += runs[tileX][tileZ] > 1;
+						tiles++;
+
+						// En granne är lägre om den finns och är lägre, se NeighbourBit.
+						unsigned char mask = 0;
+						for (const PathStep& step : pathSteps)
+						{
+							const int nx = tileX + step.dx;
+							const int nz = tileZ + step.dz;
+							if (nx >= 0 && nz >= 0 && nx < width && nz < depth && heights[nx][nz] < h) mask |= step.bit;
+						}
+						masksOk &= world.tileAt(tileX, tileZ).neighbourMask == mask;
+					}
+				}
+				if (!runsOk || !masksOk)
+				{
+					if (failures++ < 10)
+					{
+						std::printf("%s differ in world %u (%dx%d) after edit %u\n",
+							!runsOk ? "Top runs" : "Neighbour masks", w, width, depth, e + 1);
+					}
+					break;
+				}
+			}
+		}
+		if (failures > 0)
+		{
+			std::printf("%u worlds differ\n", failures);
+			return false;
+		}
+		std::printf("Top runs and neighbour masks match a full rebuild after %u edits in %u worlds; %.1f%% of the tiles are in a run of more than one\n",
+			worlds * editsPerWorld, worlds, 100.0 * tilesInRuns / std::max<std::size_t>(tiles, 1));
+		return true;
+	}
+
+	// Funktionerna som de såg ut innan de gjordes inline, via vinkeln med atan2 och avståndet med hypot.
+	Point oldRotateAround(Point p, Point centre, double angle)
+	{
+		return moveAngle(centre, angleAround(p, centre) + angle, std::hypot(p.x - centre.x, p.y - centre.y));
+	}
+
+	Point oldMoveTowards(Point p, Point dest, double distance)
+	{
+		return moveAngle(p, angleAround(dest, p), distance);
+	}
+
+	double oldDistance(Point a, Point b)
+	{
+		return std::hypot(a.x - b.x, a.y - b.y);
+	}
+
+	/*
+	 * Tar tid på rotateAround(), moveTowards() och distance() för options.benchGeometry punkter, med de gamla
+	 * funktionerna ovan, med de som är inline en punkt i taget och med versionerna för arrayer. Var sextonde
+	 * punkt är samma som mitten eller målet. Resultaten ska vara lika så när som på avrundning, där de gamla
+	 * får större fel eftersom de går via vinklar. Returnerar false om något skiljer sig mer.
+	*/
+	bool benchGeometry(const Options& options)
+	{
+		const unsigned rounds = options.ticks > 0 ? options.ticks : 100;
+		const std::size_t count = options.benchGeometry;
+		const Point centre = {123.25, -456.5};
+		const double angle = 0.7;
+		const double step = 3.5;
+		std::mt19937 rng(options.seed);
+		std::vector<double> xs(count), ys(count);
+		for (std::size_t i = 0; i < count; i++)
+		{
+			xs[i] = i % 16 == 0 ? centre.x : (rng() / 4294967296.0 - 0.5) * 4096.0;
+			ys[i] = i % 16 == 0 ? centre.y : (rng() / 4294967296.0 - 0.5) * 4096.0;
+		}
+
+		// Resultaten för varje sätt: x och y, eller avståndet i x.
+		enum {OLD, INLINE, BATCHED, WAYS};
+		static const char* const wayNames[WAYS] = {"old", "inline", "batched"};
+		std::vector<double> outXs[WAYS], outYs[WAYS];
+		for (unsigned w = 0; w < WAYS; w++)
+		{
+			outXs[w].resize(count);
+			outYs[w].resize(count);
+		}
+		bool ok = true;
+		// Det största felet som räknas som avrundning, relativt koordinaterna som är inom ±2048, och för de gamla funktionerna.
+		constexpr double scale = 4096.0;
+		constexpr double roundingError = 1e-13;
+		constexpr double oldError = 1e-9;
+		auto compare = [&](const char* function, bool points) {
+			double maxDifference[WAYS] = {};
+			for (std::size_t i = 0; i < count; i++)
+			{
+				for (unsigned w = 0; w < WAYS; w++)
+				{
+					double difference = std::abs(outXs[w][i] - outXs[INLINE][i]) / scale;
+					if (points) difference = std::max(difference, std::abs(outYs[w][i] - outYs[INLINE][i]) / scale);
+					// NaN ska aldrig komma ut, inte ens för punkter som är samma som mitten eller målet.
+					if (difference != difference) difference = INFINITY;
+					maxDifference[w] = std::max(maxDifference[w], difference);
+				}
+			}
+			std::printf("%s: old differs by %.3g, batched by %.3g (relative to the coordinates)\n",
+				function, maxDifference[OLD], maxDifference[BATCHED]);
+			if (maxDifference[OLD] > oldError || maxDifference[BATCHED] > roundingError)
+			{
+				std::printf("%s differs too much\n", function);
+				ok = false;
+			}
+		};
+		auto time = [&](const char* function, unsigned way, auto run) {
+			const auto start = std::chrono::steady_clock::now();
+			for (unsigned r = 0; r < rounds; r++) run();
+			const double ms = millisecondsSince(start);
+			std::printf("  %-8s %s: %.3f ms per round, %.1f M points/s\n",
+				wayNames[way], function, ms / rounds, double(count) * rounds / (ms / 1000.0) / 1e6);
+		};
+
+		time("rotateAround()", OLD, [&]() {
+			for (std::size_t i = 0; i < count; i++)
+			{
+				const Point p = oldRotateAround({xs[i], ys[i]}, centre, angle);
+				outXs[OLD][i] = p.x;
+				outYs[OLD][i] = p.y;
+			}
+		});
+		time("rotateAround()", INLINE, [&]() {
+			for (std::size_t i = 0; i < count; i++)
+			{
+				const Point p = rotateAround({xs[i], ys[i]}, centre, angle);
+				outXs[INLINE][i] = p.x;
+				outYs[INLINE][i] = p.y;
+			}
+		});
+		time("rotateAround()", BATCHED, [&]() {
+			rotateAround(xs.data(), ys.data(), outXs[BATCHED].data(), outYs[BATCHED].data(), count, centre, angle);
+		});
+		compare("rotateAround()", true);
+
+		time("moveTowards()", OLD, [&]() {
+			for (std::size_t i = 0; i < count; i++)
+			{
+				const Point p = oldMoveTowards({xs[i], ys[i]}, centre, step);
+				outXs[OLD][i] = p.x;
+				outYs[OLD][i] = p.y;
+			}
+		});
+		time("moveTowards()", INLINE, [&]() {
+			for (std::size_t i = 0; i < count; i++)
+			{
+				const Point p = moveTowards({xs[i], ys[i]}, centre, step);
+				outXs[INLINE][i] = p.x;
+				outYs[INLINE][i] = p.y;
+			}
+		});
+		time("moveTowards()", BATCHED, [&]() {
+			moveTowards(xs.data(), ys.data(), outXs[BATCHED].data(), outYs[BATCHED].data(), count, centre, step);
+		});
+		compare("moveTowards()", true);
+
+		time("distance()", OLD, [&]() {
+			for (std::size_t i = 0; i < count; i++)
+			{
+				outXs[OLD][i] = oldDistance({xs[i], ys[i]}, centre);
+			}
+		});
+		time("distance()", INLINE, [&]() {
+			for (std::size_t i = 0; i < count; i++)
+			{
+				outXs[INLINE][i] = distance({xs[i], ys[i]}, centre);
+			}
+		});
+		time("distance()", BATCHED, [&]() {
+			distance(xs.data(), ys.data(), outXs[BATCHED].data(), count, centre);
+		});
+		compare("distance()", false);
+		return ok;
+	}
+
+	/*
+	 * Flyttar options.benchActors aktörer med Entities::update(), först på en tråd och sedan parallellt,
+	 * och tar sedan tid på sortSpatially() och på att bygga om och söka i en SpatialHash med aktörerna.
+	 * Skriver ut tiderna.
+	*/
+	void benchActors(const Options& options)
+	{
+		const unsigned ticks = options.ticks > 0 ? options.ticks : 100;
+		World world(options.seed, options.worldWidth, options.worldDepth);
+		ThreadPool threadPool;
+		FrameArena arena;
+		for (unsigned parallel = 0; parallel < 2; parallel++)
+		{
+			// Samma aktörer båda gångerna.
+			std::mt19937 rng(options.seed + 1);
+			Entities entities;
+			addActors(world, entities, options.benchActors, rng);
+			entities.sortSpatially(arena);
+			arena.reset();
+
+			const auto start = std::chrono::steady_clock::now();
+			for (unsigned tick = 0; tick < ticks; tick++)
+			{
+				if (parallel)
+					entities.update(world, threadPool);
+				else
+					entities.update(world);
+			}
+			const double time = millisecondsSince(start);
+			std::printf("%s: %u actors on %ux%u, %u ticks: %.3f ms per tick, %.0f actor-ticks/s\n",
+				parallel ? "Parallel" : "Serial", options.benchActors, world.getWidth(), world.getDepth(), ticks,
+				time / ticks, double(options.benchActors) * ticks / (time / 1000.0));
+		}
+		std::printf("%u threads in the pool\n", threadPool.getThreadCount());
+
+		std::mt19937 rng(options.seed + 1);
+		Entities entities;
+		addActors(world, entities, options.benchActors, rng);
+		const auto sortStart = std::chrono::steady_clock::now();
+		entities.sortSpatially(arena);
+		const double sortTime = millisecondsSince(sortStart);
+		arena.reset();
+
+		// Minst en hink per entitet, så att hinkarna inte blir längre med fler entiteter.
+		unsigned bucketCount = 4096;
+		while (bucketCount < options.benchActors) bucketCount *= 2;
+		SpatialHash hash(2.0 * tileWidth, bucketCount);
+		const auto buildStart = std::chrono::steady_clock::now();
+		for (unsigned tick = 0; tick < ticks; tick++)
+		{
+			hash.build(entities);
+		}
+		const double buildTime = millisecondsSince(buildStart) / ticks;
+
+		std::vector<unsigned> result;
+		std::size_t found = 0;
+		const auto neighbourStart = std::chrono::steady_clock::now();
+		for (unsigned i = 0; i < entities.size(); i++)
+		{
+			result.clear();
+			hash.queryNeighbours(i, result);
+			found += result.size();
+		}
+		const double neighbourTime = millisecondsSince(neighbourStart);
+
+		// Rektanglar på 4 * 4 tiles, som en vy eller ett område runt en explosion.
+		const unsigned areaQueries = std::max(options.benchActors, 1000u);
+		std::size_t areaFound = 0;
+		const auto areaStart = std::chrono::steady_clock::now();
+		for (unsigned q = 0; q < areaQueries; q++)
+		{
+			const double x = (rng() % world.getWidth()) * double(tileWidth);
+			const double z = (rng() % world.getDepth()) * double(tileTopHeight);
+			result.clear();
+			hash.query(x, z, x + 4.0 * tileWidth, z + 4.0 * tileTopHeight, result);
+			areaFound += result.size();
+		}
+		const double areaTime = millisecondsSince(areaStart);
+
+		std::printf("sortSpatially: %.3f ms\n", sortTime);
+		std::printf("SpatialHash with %u buckets: build %.3f ms\n", bucketCount, buildTime);
+		std::printf("queryNeighbours for every actor: %.3f ms, %.0f queries/s, %.2f neighbours avg\n",
+			neighbourTime, entities.size() / (neighbourTime / 1000.0), double(found) / std::max<std::size_t>(entities.size(), 1));
+		std::printf("%u queries of 4x4 tiles: %.3f ms, %.0f queries/s, %.2f actors avg\n",
+			areaQueries, areaTime, areaQueries / (areaTime / 1000.0), double(areaFound) / areaQueries);
+	}
+
+	/*
+	 * Skriver händelser med en InputWriter och läser dem med InputState. Först kontrolleras att en tangent
+	 * som trycks ner och släpps under samma tick syns i wasPressed() och wasReleased(), att händelser efter
+	 * until väntar till nästa tick och att latensen är hur länge den äldsta händelsen väntade. Sedan fylls
+	 * kön med tusentals slumpade musrörelser, tecken och tangenter per tick, och när inget väntar i
+	 * InputWritern jämförs tangenterna och musen med det som skrevs. En tangent får aldrig fastna och en
+	 * tryckning får aldrig försvinna. Returnerar false om något skiljer sig.
+	*/
+	bool checkInput(const Options& options)
+	{
+		const auto queue = std::make_unique<InputQueue>();
+		InputWriter writer(*queue);
+		InputState input;
+		auto fail = [](const char* what) {
+			std::printf("Input: %s\n", what);
+			return false;
+		};
+		auto key = [](InputEvent::Type type, InputClock::time_point time, unsigned char k) -> InputEvent {
+			return {type, time, k, L'\0', 0, 0};
+		};
+
+		const InputClock::time_point start = InputClock::now();
+		const auto ms = [](int n) {return std::chrono::milliseconds(n);};
+		writer.post(key(InputEvent::KEY_DOWN, start, 'W'));
+		writer.post(key(InputEvent::KEY_UP, start + ms(1), 'W'));
+		writer.post({InputEvent::MOUSE_MOVE, start + ms(2), 0, L'\0', 3, 4});
+		writer.post(key(InputEvent::KEY_DOWN, start + ms(20), 'A'));
+		const KeySnapshot& first = input.tick(*queue, start + ms(10));
+		if (!first.wasPressed('W') || !first.wasReleased('W') || first.keyDown('W'))
+		{
+			return fail("a key pressed and released in one tick isn't both pressed and released");
+		}
+		if (first.keyDown('A') || first.wasPressed('A')) return fail("an event after the end of the tick was read");
+		if (first.getMouseX() != 3 || first.getMouseY() != 4) return fail("the mouse didn't move");
+		if (first.getLatency() != ms(10)) return fail("the latency isn't the wait of the oldest event");
+		const KeySnapshot& second = input.tick(*queue, start + ms(30));
+		if (!second.keyDown('A') || !second.wasPressed('A') || second.wasPressed('W'))
+		{
+			return fail("the event that waited wasn't read in the next tick");
+		}
+		if (second.getLatency() != ms(10)) return fail("the latency isn't the wait of the oldest event");
+		writer.post(key(InputEvent::KEY_UP, start + ms(30), 'A'));
+		input.tick(*queue, start + ms(30));
+
+		/*
+		 * S hålls ner tills kön är full. Sedan släpps och trycks S, E trycks och släpps och musen flyttas,
+		 * och allt det måste vänta. Det ska synas i ticket efter att det har lagts i kön, med tiden då det hände.
+		*/
+		for (std::size_t i = 0; i < InputQueue::capacity(); i++)
+		{
+			writer.post(key(InputEvent::KEY_DOWN, start + ms(40), 'S'));
+		}
+		writer.post(key(InputEvent::KEY_UP, start + ms(40), 'S'));
+		writer.post(key(InputEvent::KEY_DOWN, start + ms(41), 'S'));
+		writer.post(key(InputEvent::KEY_DOWN, start + ms(42), 'E'));
+		writer.post(key(InputEvent::KEY_UP, start + ms(43), 'E'));
+		writer.post({InputEvent::MOUSE_MOVE, start + ms(44), 0, L'\0', 5, 6});
+		if (!writer.hasPending()) return fail("nothing waited when the queue was full");
+		const KeySnapshot& full = input.tick(*queue, start + ms(50));
+		if (!full.keyDown('S') || full.wasPressed('E')) return fail("the events that waited were read too early");
+		writer.flush();
+		if (writer.hasPending()) return fail("events still wait after the queue was emptied");
+		const KeySnapshot& flushed = input.tick(*queue, start + ms(90));
+		if (!flushed.wasReleased('S') || !flushed.wasPressed('S') || !flushed.keyDown('S'))
+		{
+			return fail("a key released and pressed while the queue was full isn't both released and pressed");
+		}
+		if (!flushed.wasPressed('E') || !flushed.wasReleased('E') || flushed.keyDown('E'))
+		{
+			return fail("a key pressed and released while the queue was full isn't both pressed and released");
+		}
+		if (flushed.getMouseX() != 5 || flushed.getMouseY() != 6) return fail("the mouse move that waited was lost");
+		if (flushed.getLatency() != ms(50)) return fail("the events that waited don't keep their time");
+		writer.post(key(InputEvent::KEY_UP, start + ms(90), 'S'));
+		input.tick(*queue, start + ms(90));
+
+		// Tangenter som slumpas, så att några är nere när kön blir full.
+		static constexpr unsigned char keys[] = {'W', 'A', 'S', 'D', KEY_SPACE, KEY_LBUTTON, KEY_ESCAPE, KEY_PAGE_UP};
+		constexpr unsigned keyCount = sizeof(keys);
+		const unsigned ticks = options.ticks > 0 ? options.ticks : 600;
+		std::mt19937 rng(options.seed);
+		bool down[keyCount] = {};
+		// Tangenter som har tryckts ner sedan förra gången inget väntade, och de som InputState har sett tryckas ner.
+		bool pressed[keyCount] = {};
+		bool seenPressed[keyCount] = {};
+		int mouseX = 0;
+		int mouseY = 0;
+		unsigned fullTicks = 0;
+		unsigned pendingTicks = 0;
+		std::size_t events = 0;
+		// Efter de slumpade ticksen körs några utan händelser, så att allt som väntar hinner läggas i kön.
+		for (unsigned tick = 0; tick < ticks + 4; tick++)
+		{
+			const unsigned count = tick < ticks ? rng() % 3000 : 0;
+			for (unsigned i = 0; i < count; i++)
+			{
+				const unsigned r = rng() % 10;
+				const InputClock::time_point now = InputClock::now();
+				if (r < 7)
+				{
+					mouseX = int(rng() % 1000);
+					mouseY = int(rng() % 1000);
+					writer.post({InputEvent::MOUSE_MOVE, now, 0, L'\0', mouseX, mouseY});
+				}
+				else if (r == 7)
+				{
+					writer.post({InputEvent::CHAR, now, 0, wchar_t(L'a' + rng() % 26), 0, 0});
+				}
+				else
+				{
+					// Som i Windows kommer KEY_DOWN om och om igen medan en tangent hålls ner.
+					const unsigned k = rng() % keyCount;
+					const bool wasDown = down[k];
+					down[k] = rng() % 2 == 0;
+					pressed[k] = pressed[k] || (down[k] && !wasDown);
+					writer.post(key(down[k] ? InputEvent::KEY_DOWN : InputEvent::KEY_UP, now, keys[k]));
+				}
+			}
+			events += count;
+			fullTicks += queue->freeSlots() == 0;
+			pendingTicks += writer.hasPending();
+
+			// Som i fönstret: spelet läser kön, och sedan läggs det som väntade i den.
+			const KeySnapshot& snapshot = input.tick(*queue, InputClock::now());
+			for (unsigned k = 0; k < keyCount; k++)
+			{
+				seenPressed[k] = seenPressed[k] || snapshot.wasPressed(keys[k]);
+			}
+			if (writer.hasPending())
+			{
+				writer.flush();
+				continue;
+			}
+			for (unsigned k = 0; k < keyCount; k++)
+			{
+				if (snapshot.keyDown(keys[k]) != down[k])
+				{
+					std::printf("Input: key %u is %s after tick %u but should be %s\n",
+						unsigned(keys[k]), snapshot.keyDown(keys[k]) ? "down" : "up", tick + 1, down[k] ? "down" : "up");
+					return false;
+				}
+				if (pressed[k] && !seenPressed[k])
+				{
+					std::printf("Input: a press of key %u was lost before tick %u\n", unsigned(keys[k]), tick + 1);
+					return false;
+				}
+				pressed[k] = false;
+				seenPressed[k] = false;
+			}
+			if (snapshot.getMouseX() != mouseX || snapshot.getMouseY() != mouseY)
+			{
+				std::printf("Input: the mouse is at (%d, %d) after tick %u but should be at (%d, %d)\n",
+					snapshot.getMouseX(), snapshot.getMouseY(), tick + 1, mouseX, mouseY);
+				return false;
+			}
+		}
+		if (writer.hasPending()) return fail("events still wait after the queue was emptied");
+		if (pendingTicks == 0) return fail("the queue never overflowed, so nothing was checked");
+		std::printf("Input: %zu events in %u ticks, the queue was full after %u and events waited after %u, %zu chars dropped\n",
+			events, ticks, fullTicks, pendingTicks, writer.getDroppedChars());
+		return true;
+	}
+
+	/*
+	 * Jämför text från formatInteger() och formatDecimal() med samma sak från swprintf, för gränsfall som
+	 * avrundning uppåt genom alla siffror, tal precis mitt emellan, -0, LLONG_MIN, NaN och inf och för
+	 * slumpade tal. Varje text skrivs också till alla kortare buffertar, som ska få början av den utan att
+	 * något skrivs efter dem, och läggs till i en TextBuffer som klipper den. Tal vars siffror inte får plats
+	 * i 64 bitar ska bli inf. Returnerar false om något skiljer sig.
+	*/
+	bool checkText(const Options& options)
+	{
+		constexpr std::size_t bufferSize = 128;
+		constexpr wchar_t guard = L'#';
+		wchar_t expected[bufferSize];
+		wchar_t out[bufferSize + 1];
+		std::size_t checked = 0;
+
+		// Jämför format(out, size) med expected för alla size upp till längden.
+		auto compare = [&](const std::function<std::size_t(wchar_t*, std::size_t)>& format, const char* what) {
+			const std::size_t length = std::wcslen(expected);
+			for (std::size_t size = 0; size <= length + 1; size++)
+			{
+				std::fill(out, out + bufferSize + 1, guard);
+				const std::size_t written = format(out, size);
+				const std::size_t wanted = std::min(size, length);
+				if (written != wanted || std::wmemcmp(out, expected, wanted) != 0 || out[wanted] != guard)
+				{
+					out[std::min(written, bufferSize)] = L'\0';
+					std::printf("Text: %s gives \"%ls\" with room for %zu chars but should give the first %zu of \"%ls\"\n",
+						what, out, size, wanted, expected);
+					return false;
+				}
+			}
+			checked++;
+			return true;
+		};
+		// text är "ab" och sedan expected, som ska vara klippt efter tolv tecken.
+		auto compareBuffer = [&](const TextBuffer<12>& text, const char* what) {
+			if (text.size() != std::min<std::size_t>(std::wcslen(expected) + 2, 12) || std::wcsncmp(text.c_str() + 2, expected, 10) != 0)
+			{
+				std::printf("Text: TextBuffer<12> with ab and %s is \"%ls\"\n", what, text.c_str());
+				return false;
+			}
+			return true;
+		};
+		auto checkInteger = [&](long long v) {
+			std::swprintf(expected, bufferSize, L"%lld", v);
+			char what[48];
+			std::snprintf(what, sizeof(what), "formatInteger(%lld)", v);
+			TextBuffer<12> text;
+			text.append(L"ab").append(v);
+			return compare([v](wchar_t* o, std::size_t size) {return formatInteger(o, size, v);}, what) && compareBuffer(text, what);
+		};
+		auto checkDecimal = [&](double v, unsigned decimals) {
+			std::swprintf(expected, bufferSize, L"%.*f", int(decimals), v);
+			// Siffror som inte får plats i 64 bitar blir inf.
+			std::wstring digits;
+			for (const wchar_t* c = expected; *c; c++)
+			{
+				if (*c >= L'0' && *c <= L'9') digits += *c;
+			}
+			digits.erase(0, std::min(digits.find_first_not_of(L'0'), digits.size()));
+			if (digits.size() > 20 || (digits.size() == 20 && digits > L"18446744073709551615"))
+			{
+				std::wcscpy(expected, std::signbit(v) ? L"-inf" : L"inf");
+			}
+			char what[96];
+			std::snprintf(what, sizeof(what), "formatDecimal(%.17g, %u)", v, decimals);
+			TextBuffer<12> text;
+			text.append(L"ab").append(v, decimals);
+			return compare([v, decimals](wchar_t* o, std::size_t size) {return formatDecimal(o, size, v, decimals);}, what) &&
+				compareBuffer(text, what);
+		};
+
+		const long long integers[] = {0, 1, -1, 9, 10, -10, 99, 100, 1234567890, LLONG_MAX, LLONG_MIN, LLONG_MIN + 1};
+		for (const long long v : integers)
+		{
+			if (!checkInteger(v)) return false;
+		}
+		const double nan = std::numeric_limits<double>::quiet_NaN();
+		const double inf = std::numeric_limits<double>::infinity();
+		const double decimals[] = {
+			0.0, -0.0, 9.995, 9.9951, 99.995, 0.125, 0.375, -0.125, 0.5, 1.5, 2.5, -2.5, 0.05, 0.15, 0.25, 1e-300,
+			-1e-300, std::numeric_limits<double>::denorm_min(), -0.001, 0.999999999, 9.9999999995, 123456.789, 1.0 / 3.0,
+			4503599627370495.5, 9007199254740993.0, 9223372036854775808.0, 18446744073709551615.0, 1.8446744073709552e19,
+			1e19, 1e20, -1e20, 1e300, nan, -nan, inf, -inf, std::numeric_limits<double>::max()
+		};
+		for (const double v : decimals)
+		{
+			for (unsigned d = 0; d <= 9; d++)
+			{
+				if (!checkDecimal(v, d)) return false;
+			}
+		}
+
+		// Slumpade tal, med mantissor som ofta slutar på ...5 och exponenter från små tal till över 2^64.
+		const unsigned count = options.ticks > 0 ? options.ticks : 100000;
+		std::mt19937_64 rng(options.seed);
+		for (unsigned i = 0; i < count; i++)
+		{
+			const long long integer = static_cast<long long>(rng()) >> (rng() % 64);
+			if (!checkInteger(integer)) return false;
+			const unsigned d = rng() % 10;
+			double v;
+			if (i % 2 == 0)
+			{
+				v = std::ldexp(double(rng() >> 11), int(rng() % 130) - 110);
+			}
+			else
+			{
+				// Ett tal med d + 1 decimaler som slutar på 5, som ligger nära mitten mellan två tal med d decimaler.
+				double scale = 10.0;
+				for (unsigned j = 0; j < d; j++) scale *= 10.0;
+				v = (double(rng() % 100000000) * 10.0 + 5.0) / scale;
+			}
+			if (rng() % 2 == 0) v = -v;
+			if (!checkDecimal(v, d)) return false;
+		}
+		std::printf("Text: %zu numbers formatted the same as swprintf, cut at every length\n", checked);
+		return true;
+	}
+
+	/*
+	 * Kontrollerar att ett handtag till något som har tagits bort förblir ogiltigt när platsen återanvänds,
+	 * att clear() gör alla handtag ogiltiga och att en plats vars generation slår runt inte används igen.
+	 * Generationerna är 8 bitar så att de slår runt snabbt. Sedan görs options.ticks (standard 100000)
+	 * slumpade add(), remove() och clear(), och efter var hundrade jämförs alla handtag som poolen någonsin
+	 * har lämnat ut med vad de ska peka på. Inget handtag får lämnas ut två gånger. Returnerar false om
+	 * något skiljer sig.
+	*/
+	bool checkResourcePool(const Options& options)
+	{
+		typedef ResourcePool<int, uint8_t> Pool;
+		auto fail = [](const char* what) {
+			std::printf("ResourcePool: %s\n", what);
+			return false;
+		};
+
+		Pool pool;
+		const Pool::HandleType first = pool.add(1);
+		if (!pool.remove(first)) return fail("remove() failed");
+		const Pool::HandleType reused = pool.add(2);
+		if (reused.index != first.index) return fail("a free slot wasn't reused");
+		if (reused == first || pool.get(first) || pool.contains(first) || pool.remove(first))
+		{
+			return fail("a removed handle is valid again after its slot was reused");
+		}
+		if (!pool.get(reused) || *pool.get(reused) != 2 || pool.size() != 1) return fail("the new handle is wrong");
+		if (pool.get(Pool::HandleType{}) || pool.contains(Pool::HandleType{})) return fail("a handle made with {} is valid");
+
+		Pool::HandleType cleared[8];
+		for (int i = 0; i < 8; i++) cleared[i] = pool.add(int(i));
+		pool.remove(cleared[3]);
+		pool.clear();
+		if (pool.size() != 0) return fail("clear() left objects");
+		const std::size_t slotCount = pool.capacity();
+		for (int i = 0; i < 8; i++) cleared[i] = pool.add(int(i));
+		if (pool.capacity() != slotCount) return fail("clear() didn't free the slots");
+		pool.clear();
+		for (int i = 0; i < 8; i++)
+		{
+			if (pool.contains(cleared[i]) || pool.contains(reused)) return fail("a handle is still valid after clear()");
+		}
+
+		// Samma plats tas bort och läggs till tills generationen slår runt. Sedan ska en ny plats användas.
+		Pool wrapping;
+		Pool::HandleType handle = wrapping.add(0);
+		const uint32_t index = handle.index;
+		unsigned adds = 1;
+		while (true)
+		{
+			wrapping.remove(handle);
+			handle = wrapping.add(0);
+			adds++;
+			if (handle.index != index) break;
+			if (handle.generation == 0) return fail("a handle got generation 0");
+			if (adds > 256) return fail("a slot was used for more than 255 generations");
+		}
+		if (adds != 256) return fail("a slot was retired before its generation wrapped");
+		if (wrapping.capacity() != 2 || wrapping.size() != 1) return fail("the retired slot was counted wrong");
+
+		// Slumpade operationer jämförs med vad varje handtag som har lämnats ut ska peka på.
+		struct Given
+		{
+			Pool::HandleType handle;
+			int value;
+			bool alive;
+		};
+		std::vector<Given> given;
+		std::vector<std::size_t> alive;
+		std::vector<bool> seen;
+		Pool random;
+		std::mt19937 rng(options.seed);
+		const unsigned operations = options.ticks > 0 ? options.ticks : 100000;
+		unsigned clears = 0;
+		for (unsigned op = 0; op < operations; op++)
+		{
+			const unsigned r = rng() % 1000;
+			if (r == 0)
+			{
+				random.clear();
+				for (const std::size_t i : alive) given[i].alive = false;
+				alive.clear();
+				clears++;
+			}
+			else if (r < 500 && !alive.empty())
+			{
+				const std::size_t a = rng() % alive.size();
+				if (!random.remove(given[alive[a]].handle)) return fail("remove() of a valid handle failed");
+				given[alive[a]].alive = false;
+				alive[a] = alive.back();
+				alive.pop_back();
+			}
+			else if (alive.size() < 64)
+			{
+				const int value = int(rng());
+				const Pool::HandleType h = random.add(int(value));
+				// Varje handtag får bara lämnas ut en gång, annars kan ett gammalt bli giltigt igen.
+				const std::size_t key = std::size_t(h.index) * 256 + h.generation;
+				if (seen.size() <= key) seen.resize(key + 1, false);
+				if (h.generation == 0 || seen[key]) return fail("a handle was given out twice");
+				seen[key] = true;
+				alive.push_back(given.size());
+				given.push_back({h, value, true});
+			}
+			if (op % 100 != 0) continue;
+			if (random.size() != alive.size()) return fail("size() is wrong");
+			for (const Given& g : given)
+			{
+				const int* value = random.get(g.handle);
+				if (g.alive ? !value || *value != g.value : value != nullptr)
+				{
+					std::printf("ResourcePool: handle (%u, %u) is %s after %u operations but should be %s\n",
+						unsigned(g.handle.index), unsigned(g.handle.generation), value ? "valid" : "invalid", op + 1,
+						g.alive ? "valid" : "invalid");
+					return false;
+				}
+				if (random.contains(g.handle) != g.alive) return fail("contains() differs from get()");
+			}
+		}
+		std::printf("ResourcePool: %zu handles from %u operations with %u clears in %zu slots pointed to the right objects\n",
+			given.size(), operations, clears, random.capacity());
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	try
+	{
+		const Options options = parseOptions(argc, argv);
+		if (options.out.empty() && options.compare.empty() && options.saveWorld.empty() && options.ticks == 0 && options.paths == 0 &&
+			options.checkActors == 0 && options.benchActors == 0 && !options.checkHeightQueries &&
+			!options.checkPaths && !options.checkTopRuns && options.benchGeometry == 0 && !options.checkInput && !options.checkText &&
+			!options.checkResourcePool)
+		{
+			printUsage();
+			return 2;
+		}
+
+		if (options.checkPaths)
+		{
+			return checkPaths(options) ? 0 : 1;
+		}
+		if (options.checkHeightQueries)
+		{
+			return checkHeightQueries(options) ? 0 : 1;
+		}
+		if (options.checkTopRuns)
+		{
+			return checkTopRuns(options) ? 0 : 1;
+		}
+		if (options.benchGeometry > 0)
+		{
+			return benchGeometry(options) ? 0 : 1;
+		}
+		if (options.checkInput)
+		{
+			return checkInput(options) ? 0 : 1;
+		}
+		if (options.checkText)
+		{
+			return checkText(options) ? 0 : 1;
+		}
+		if (options.checkResourcePool)
+		{
+			return checkResourcePool(options) ? 0 : 1;
+		}
+		if (options.checkActors > 0)
+		{
+			return checkActors(options) && checkPlayer(options) ? 0 : 1;
+		}
+		if (options.benchActors > 0)
+		{
+			benchActors(options);
+			return 0;
+		}
+		if (options.paths > 0)
+		{
+			runPaths(options);
+			return 0;
+		}
+		if (options.ticks > 0)
+		{
+			const GameRun run = runGame(options);
+			if (!options.out.empty()) saveImage(options.out, run.frame);
+			if (!options.compare.empty() && !compareFrames(run.frame, loadImageFile(options.compare), options))
+			{
+				return 1;
+			}
+			return options.checkAllocations && run.allocations > 0 ? 1 : 0;
+		}
+
+		World world(options.seed);
+		if (!options.saveWorld.empty()) saveWorldFile(options.saveWorld, world.getHeights());
+		SoftwareTarget target(options.width, options.height);
+		FrameArena arena;
+		RenderQueue renderQueue(arena);
+
+		const int x = std::clamp(options.cameraX, 0, int(world.getWidth()) - 1);
+		const int z = std::clamp(options.cameraZ, 0, int(world.getDepth()) - 1);
+		const Point3D camera = {(x + 0.5) * tileWidth, world.heightAt(x, z) * double(tileHeight), (z + 0.5) * tileTopHeight};
+		const Point centrePos = camera.project();
+
+		world.draw(centrePos, target, renderQueue, options.overlays);
+		if (options.sprite)
+		{
+			renderQueue.pushSprite(Image(ImageID::LOWERCASEMU, 16.0f, 16.0f), camera, 16.0, centrePos, target);
+		}
+		renderQueue.sort();
+		renderQueue.draw(target);
+
+		if (!options.out.empty()) saveImage(options.out, target.getFrame());
+		if (!options.compare.empty())
+		{
+			return compareFrames(target.getFrame(), loadImageFile(options.compare), options) ? 0 : 1;
+		}
+		return 0;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << e.what() << "\n";
+		printUsage();
+		return 2;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,44 @@
+﻿#include <vector>
+#include "win32platform.h"
+
+Win32Platform::Win32Platform(HINSTANCE hInstance, const wchar_t* title)
+	: dv(hInstance, title),
+	  images(),
+	  target(dv, images)
+{
+	loadImages(dv, images);
+}
+
+bool Win32Platform::update()
+{
+	dv.updateWindow();
+	return dv.windowExists();
+}
+
+RenderTarget& Win32Platform::beginFrame()
+{
+	frameArena.reset();
+	dv.beginDraw();
+	return target;
+}
+
+void Win32Platform::reloadImage(ImageID imageID, const PixelImage& image)
+{
+	// DirectV vill ha förmultiplicerad alfa.
+	std::vector<uint32_t> pixels(image.pixels.size());
+	for (std::size_t i = 0; i < pixels.size(); i++)
+	{
+		const uint32_t p = image.pixels[i];
+		const uint32_t a = p >> 24;
+		pixels[i] = a << 24 | ((p >> 16 & 0xff) * a / 255) << 16 | ((p >> 8 & 0xff) * a / 255) << 8 | (p & 0xff) * a / 255;
+	}
+	// Den nya bitmapen skapas först, så att den gamla finns kvar om det inte går.
+	const BitmapHandle bitmap = dv.addBitmap(image.width, image.height, pixels.data());
+	dv.release(images[imageID]);
+	images[imageID] = bitmap;
+}
+
+void Win32Platform::endFrame()
+{
+	dv.endDraw();
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+﻿#pragma once
+#include "directv.h"
+#include "directvtarget.h"
+#include "platform.h"
+
+// Plattformen för Windows. Den ritar med en DirectV i ett fullskärmsfönster.
+class Win32Platform : public Platform
+{
+private:
+	DirectV dv;
+	images_t images;
+	DirectVTarget target;
+	FrameArena frameArena;
+public:
+	// Skapar fönstret och laddar bilderna. Kastar DirectVException om det inte går.
+	Win32Platform(HINSTANCE hInstance, const wchar_t* title);
+
+	// Ingen kopiering.
+	Win32Platform(const Win32Platform&) = delete;
+	// Ingen kopiering.
+	Win32Platform& operator=(const Win32Platform&) = delete;
+
+	bool update() override;
+	InputQueue& getInputQueue() noexcept override {return dv.getInputQueue();}
+	FrameArena& getFrameArena() noexcept override {return frameArena;}
+
+	RenderTarget& beginFrame() override;
+	void endFrame() override;
+
+	void reloadImage(ImageID imageID, const PixelImage& image) override;
+
+	int getWidth() const noexcept override {return dv.getWidth();}
+	int getHeight() const noexcept override {return dv.getHeight();}
+
+	// Returnerar DirectV:n, för det som bara finns på Windows (HUD, minikarta o.d.).
+	DirectV& getDirectV() noexcept {return dv;}
+};
\ No newline at end of file
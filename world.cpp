@@ -1,6 +1,10 @@
-﻿#include "world.h"
+﻿#include <algorithm>
+#include <random>
+#include "world.h"
+#include "dirtyregions.h"
+#include "renderqueue.h"
 
-void loadImagesAt(Tile& tile, float x, float y)
+void loadImagesAt(TileType& tile, float x, float y)
 {
 	int yOffsetTop = 0;
 	auto loadTopImage = [&](Image& i) -> void {
@@ -44,173 +48,467 @@ void loadImagesAt(Tile& tile, float x, float y)
 	loadSideImage(tile.sideImages.grass);
 }
 
-World::World()
-	: tiles(50, 50)
+namespace
 {
-	for (unsigned y = 0; y < tiles.getHeight(); y++)
+	// Lägger image i kön en gång för varje sträcka av tiles i [0, count) där has(i) är true, som en bild som upprepas.
+	template <typename Has>
+	void pushStretches(RenderQueue& queue, uint64_t key, const Image& image, float xPos, float yPos, unsigned count, Has has)
 	{
-		for (unsigned x = 0; x < tiles.getWidth(); x++)
+		for (unsigned i = 0; i < count; i++)
 		{
-			loadImagesAt(tiles[x][y], 0.0f, 0.0f);
-			tiles[x][y].height = static_cast<unsigned short>(rand() % 3);
+			if (!has(i)) continue;
+			unsigned length = 1;
+			while (i + length < count && has(i + length)) length++;
+			queue.push(key, image, xPos + i * tileWidth, yPos, length);
+			i += length - 1;
 		}
 	}
 }
 
-void World::drawTile(int x, int y, int z, Point centrePos, DirectV& dv, images_t& images)
+World::World(uint32_t seed, unsigned width, unsigned depth)
+	: tileTypes(1),
+	  heights(width, depth),
+	  types(width, depth),
+	  neighbourMasks(width, depth),
+	  topRuns(width, depth),
+	  pyramid(heights),
+	  journalStart(0),
+	  editDepth(0),
+	  editBounds{0, 0, 0, 0}
 {
-	auto& currTile = tiles.at(x, z);
-	if (y == currTile.height)
+	loadImagesAt(tileTypes[0], 0.0f, 0.0f);
+	// std::uniform_int_distribution är inte likadan i alla standardbibliotek, så fördelningen görs för hand.
+	std::mt19937 rng(seed);
+	for (unsigned y = 0; y < heights.getHeight(); y++)
 	{
-		const int diff = currTile.height - (z == tiles.getHeight() - 1 ? 0 : tiles.at(x, z + 1).height);
+		for (unsigned x = 0; x < heights.getWidth(); x++)
+		{
+			types[x][y] = 0;
+			heights[x][y] = static_cast<uint16_t>(rng() % 3);
+		}
+	}
+	updateNeighbourMasks(0, 0, heights.getWidth(), heights.getHeight());
+	updateTopRuns({0, 0, int(heights.getWidth()), int(heights.getHeight())});
+	pyramid.rebuild();
+}
+
+void World::updateNeighbourMasks(int startX, int startZ, int endX, int endZ)
+{
+	startX = std::max(startX, 0);
+	startZ = std::max(startZ, 0);
+	endX = std::min(endX, static_cast<int>(heights.getWidth()));
+	endZ = std::min(endZ, static_cast<int>(heights.getHeight()));
+	const int lastX = heights.getWidth() - 1;
+	const int lastZ = heights.getHeight() - 1;
+	for (int x = startX; x < endX; x++)
+	{
+		for (int z = startZ; z < endZ; z++)
+		{
+			const uint16_t h = heights[x][z];
+			unsigned char mask = 0;
+			if (z > 0 && h > heights[x][z - 1]) mask |= NEIGHBOUR_N;
+			if (z < lastZ && h > heights[x][z + 1]) mask |= NEIGHBOUR_S;
+			if (x < lastX && h > heights[x + 1][z]) mask |= NEIGHBOUR_E;
+			if (x > 0 && h > heights[x - 1][z]) mask |= NEIGHBOUR_W;
+			if (x < lastX && z > 0 && h > heights[x + 1][z - 1]) mask |= NEIGHBOUR_NE;
+			if (x > 0 && z > 0 && h > heights[x - 1][z - 1]) mask |= NEIGHBOUR_NW;
+			if (x < lastX && z < lastZ && h > heights[x + 1][z + 1]) mask |= NEIGHBOUR_SE;
+			if (x > 0 && z < lastZ && h > heights[x - 1][z + 1]) mask |= NEIGHBOUR_SW;
+			neighbourMasks[x][z] = mask;
+		}
+	}
+}
+
+bool World::visibleTop(int x, int z) const noexcept
+{
+	// Toppen döljs av tilen framför om den är mer än en höjdenhet högre, se drawTile().
+	return z == int(heights.getHeight()) - 1 || heights[x][z + 1] <= heights[x][z] + 1;
+}
+
+void World::updateTopRuns(TileRect area)
+{
+	const int width = heights.getWidth();
+	for (int z = area.startZ; z < area.endZ; z++)
+	{
+		for (int x = area.endX - 1; x >= 0; x--)
+		{
+			uint16_t run = 0;
+			if (visibleTop(x, z))
+			{
+				const bool continues = x + 1 < width && topRuns[x + 1][z] > 0 && heights[x + 1][z] == heights[x][z] && types[x + 1][z] == types[x][z];
+				run = continues ? std::min(topRuns[x + 1][z] + 1, 0xffff) : 1;
+			}
+			// Längderna till vänster beror bara på den här, så om den inte har ändrats har inte de heller det.
+			if (x < area.startX && topRuns[x][z] == run) break;
+			topRuns[x][z] = run;
+		}
+	}
+}
+
+void World::drawTile(int x, int y, int z, Point centrePos, RenderTarget& target, RenderQueue& queue, bool overlays)
+{
+	const uint64_t key = RenderQueue::depthKey(z, y, false);
+	const uint16_t height = heights.at(x, z);
+	const TileType& currTile = tileTypes[types[x][z]];
+	if (y == height)
+	{
+		const int diff = height - (z == int(heights.getHeight()) - 1 ? 0 : heights[x][z + 1]);
 		if (diff >= -1)
 		{
-			const float xPos = dv.getEffWidth() / 2.0f + x * tileWidth - centrePos.x;
-			const float yPos = dv.getEffHeight() / 2.0f + z * tileTopHeight - y * tileHeight - centrePos.y;
+			const float xPos = target.getEffWidth() / 2.0f + x * tileWidth - centrePos.x;
+			const float yPos = target.getEffHeight() / 2.0f + z * tileTopHeight - y * tileHeight - centrePos.y;
 
 			// Rita bas.
-			currTile.topImages.base.draw(
-				xPos,
-				yPos,
-				dv,
-				images
-			);
-
-			// Rita kanter.
-			if (x > 0 && currTile.height > tiles.at(x - 1, z).height)
-				currTile.topImages.leftEdge.draw(
-					xPos,
-					yPos,
-					dv,
-					images
-				);
-			if (z > 0 && currTile.height > tiles.at(x, z - 1).height)
-				currTile.topImages.topEdge.draw(
-					xPos,
-					yPos,
-					dv,
-					images
-				);
-			if (x < tiles.getWidth() - 1 && currTile.height > tiles.at(x + 1, z).height)
-				currTile.topImages.rightEdge.draw(
-					xPos,
-					yPos,
-					dv,
-					images
-				);
-			if (z < tiles.getHeight() - 1 && currTile.height > tiles.at(x, z + 1).height)
-				currTile.topImages.bottomEdge.draw(
-					xPos,
-					yPos,
-					dv,
-					images
-				);
-
-			// Rita hörn.
-			if (x > 0 && z > 0 && currTile.height > tiles.at(x - 1, z - 1).height)
-				currTile.topImages.nwCorner.draw(
-					xPos,
-					yPos,
-					dv,
-					images
-				);
-			if (x < tiles.getWidth() - 1 && z > 0 && currTile.height > tiles.at(x + 1, z - 1).height)
-				currTile.topImages.neCorner.draw(
-					xPos,
-					yPos,
-					dv,
-					images
-				);
-			if (x > 0 && z < tiles.getHeight() - 1 && currTile.height > tiles.at(x - 1, z + 1).height)
-				currTile.topImages.swCorner.draw(
-					xPos,
-					yPos,
-					dv,
-					images
-				);
-			if (x < tiles.getWidth() - 1 && z < tiles.getHeight() - 1 && currTile.height > tiles.at(x + 1, z + 1).height)
-				currTile.topImages.seCorner.draw(
-					xPos,
-					yPos,
-					dv,
-					images
-				);
+			queue.push(key, currTile.topImages.base, xPos, yPos);
+			if (overlays) drawTopOverlays(x, z, 1, key, xPos, yPos, queue);
 		}
 	}
-	else if (y <= currTile.height - 1)
+	else if (y <= height - 1)
 	{
-		const int diff = y - (z == tiles.getHeight() - 1 ? 0 : tiles.at(x, z + 1).height);
+		const int diff = y - (z == int(heights.getHeight()) - 1 ? 0 : heights[x][z + 1]);
 		if (diff >= 0)
 		{
-			const float xPos = dv.getEffWidth() / 2.0f + x * tileWidth - centrePos.x;
-			const float yPos = dv.getEffHeight() / 2.0f + z * tileTopHeight + tileTopHeight - (y + 1) * tileHeight  - centrePos.y;
+			const float xPos = target.getEffWidth() / 2.0f + x * tileWidth - centrePos.x;
+			const float yPos = target.getEffHeight() / 2.0f + z * tileTopHeight + tileTopHeight - (y + 1) * tileHeight  - centrePos.y;
 
 			// Rita basen.
-			currTile.sideImages.base.draw(
-				xPos,
-				yPos,
-				dv,
-				images
-			);
-
-			// Rita kanter.
-			if (x > 0 && y >= tiles.at(x - 1, z).height)
-				currTile.sideImages.leftEdge.draw(
-					xPos,
-					yPos,
-					dv,
-					images
-				);
-			if (x < tiles.getWidth() - 1 && y >= tiles.at(x + 1, z).height)
-				currTile.sideImages.rightEdge.draw(
-					xPos,
-					yPos,
-					dv,
-					images
-				);
-
-			// Rita gräs.
-			if (y == currTile.height - 1)
+			queue.push(key, currTile.sideImages.base, xPos, yPos);
+			if (overlays) drawSideOverlays(x, y, z, 1, key, xPos, yPos, queue);
+		}
+	}
+}
+
+void World::drawTopOverlays(int x, int z, unsigned count, uint64_t key, float xPos, float yPos, RenderQueue& queue) const
+{
+	const TileType::TopImages& images = tileTypes[types[x][z]].topImages;
+	auto overlay = [&](const Image& image, unsigned char bit) {
+		pushStretches(queue, key, image, xPos, yPos, count, [&](unsigned i) {return (neighbourMasks[x + i][z] & bit) != 0;});
+	};
+
+	// Rita kanter.
+	overlay(images.leftEdge, NEIGHBOUR_W);
+	overlay(images.topEdge, NEIGHBOUR_N);
+	overlay(images.rightEdge, NEIGHBOUR_E);
+	overlay(images.bottomEdge, NEIGHBOUR_S);
+
+	// Rita hörn.
+	overlay(images.nwCorner, NEIGHBOUR_NW);
+	overlay(images.neCorner, NEIGHBOUR_NE);
+	overlay(images.swCorner, NEIGHBOUR_SW);
+	overlay(images.seCorner, NEIGHBOUR_SE);
+}
+
+void World::drawSideOverlays(int x, int y, int z, unsigned count, uint64_t key, float xPos, float yPos, RenderQueue& queue) const
+{
+	const TileType::SideImages& images = tileTypes[types[x][z]].sideImages;
+
+	// Rita kanter.
+	pushStretches(queue, key, images.leftEdge, xPos, yPos, count, [&](unsigned i) {return x + int(i) > 0 && y >= heights[x + i - 1][z];});
+	pushStretches(queue, key, images.rightEdge, xPos, yPos, count, [&](unsigned i) {return x + int(i) < int(heights.getWidth()) - 1 && y >= heights[x + i + 1][z];});
+
+	// Rita gräs.
+	pushStretches(queue, key, images.grass, xPos, yPos, count, [&](unsigned i) {return y == heights[x + i][z] - 1;});
+}
+
+void World::draw(Point centrePos, RenderTarget& target, RenderQueue& queue, bool overlays)
+{
+	const int startX = calculateStartX(centrePos, target);
+	const int endX = calculateEndX(centrePos, target);
+	const int startZ = calculateStartZ(centrePos, target);
+	const int endZ = calculateEndZ(centrePos, target);
+	for (int z = startZ; z < endZ; z++)
+	{
+		const int startY = calculateStartY(centrePos, z, target);
+		const int endY = calculateEndY(centrePos, z, target);
+		const int frontZ = std::min<int>(z + 1, heights.getHeight() - 1);
+		for (int y = startY; y < endY; y++)
+		{
+			const uint64_t key = RenderQueue::depthKey(z, y, false);
+			// Samma villkor som i drawTile(): sidan syns om tilen framför inte är högre än lagret.
+			auto visibleSide = [&](int x) {return y < heights[x][z] && (z == frontZ || y >= heights[x][frontZ]);};
+			for (int x = startX; x < endX; x++)
 			{
-				currTile.sideImages.grass.draw(
-					xPos,
-					yPos,
-					dv,
-					images
-				);
+				/*
+				 * Basbilderna för en rad med toppar eller sidor läggs i kön som en bild, och kanterna läggs efter den.
+				 * Bilderna för olika tiles på en rad överlappar inte varandra, så bara ordningen inom varje tile spelar
+				 * roll. Bilder ritas
+				 * på hela pixlar, se Image::draw(), och avrundningen blir bara densamma som för separata bilder när
+				 * raden börjar på en positiv position.
+				*/
+				const float xPos = target.getEffWidth() / 2.0f + x * tileWidth - centrePos.x;
+				unsigned count = 0;
+				if (y == heights[x][z])
+				{
+					count = std::min<int>(topRuns[x][z], endX - x);
+				}
+				else if (visibleSide(x))
+				{
+					count = 1;
+					while (x + int(count) < endX && visibleSide(x + count) && types[x + count][z] == types[x][z]) count++;
+				}
+				if (count > 1 && xPos >= 0.0f)
+				{
+					const bool top = y == heights[x][z];
+					const float yPos = top ?
+						target.getEffHeight() / 2.0f + z * tileTopHeight - y * tileHeight - centrePos.y :
+						target.getEffHeight() / 2.0f + z * tileTopHeight + tileTopHeight - (y + 1) * tileHeight  - centrePos.y;
+					const TileType& type = tileTypes[types[x][z]];
+					queue.push(key, top ? type.topImages.base : type.sideImages.base, xPos, yPos, count);
+					if (overlays && top) drawTopOverlays(x, z, count, key, xPos, yPos, queue);
+					if (overlays && !top) drawSideOverlays(x, y, z, count, key, xPos, yPos, queue);
+					x += count - 1;
+					continue;
+				}
+				drawTile(x, y, z, centrePos, target, queue, overlays);
 			}
 		}
 	}
 }
 
-int World::calculateStartX(Point centrePos, DirectV& dv)
+int World::calculateStartX(Point centrePos, RenderTarget& target)
 {
-	const int a = floor((0.0 - dv.getEffWidth() / 2.0 + centrePos.x) / tileWidth);
+	const int a = floor((0.0 - target.getEffWidth() / 2.0 + centrePos.x) / tileWidth);
 	const int lowerBound = 0;
-	const int upperBound = tiles.getWidth();
+	const int upperBound = heights.getWidth();
 	return a > lowerBound ? a < upperBound ? a : upperBound : lowerBound;
 }
 
-int World::calculateEndX(Point centrePos, DirectV& dv)
+int World::calculateEndX(Point centrePos, RenderTarget& target)
 {
-	const int a = floor((dv.getEffWidth() / 2.0 + centrePos.x) / tileWidth) + 1;
+	const int a = floor((target.getEffWidth() / 2.0 + centrePos.x) / tileWidth) + 1;
 	const int lowerBound = 0;
-	const int upperBound = tiles.getWidth();
+	const int upperBound = heights.getWidth();
 	return a > lowerBound ? a < upperBound ? a : upperBound : lowerBound;
 }
 
-int World::calculateStartY(Point centrePos, int z, DirectV& dv)
+int World::calculateStartZ(Point centrePos, RenderTarget& target)
 {
-	const int a = floor((0.0 - dv.getEffHeight() / 2.0 + centrePos.y - z * tileTopHeight) / tileTopHeight);
+	// Lager 0 på raden slutar en rad längre ner än raden börjar.
+	const int a = floor((0.0 - target.getEffHeight() / 2.0 + centrePos.y - tileTopHeight) / tileTopHeight);
 	const int lowerBound = 0;
-	const int upperBound = getHeight();
+	const int upperBound = heights.getHeight();
+	return a > lowerBound ? a < upperBound ? a : upperBound : lowerBound;
+}
+
+int World::calculateEndZ(Point centrePos, RenderTarget& target)
+{
+	const double maxHeight = pyramid.maxHeight(0, 0, getWidth(), getDepth()) * tileHeight;
+	const int a = floor((target.getEffHeight() / 2.0 + centrePos.y + maxHeight) / tileTopHeight) + 1;
+	const int lowerBound = 0;
+	const int upperBound = heights.getHeight();
 	return a > lowerBound ? a < upperBound ? a : upperBound : lowerBound;
 }
 
-int World::calculateEndY(Point centrePos, int z, DirectV& dv)
+int World::calculateStartY(Point centrePos, int z, RenderTarget& target)
 {
-	const int a = floor((dv.getEffHeight() + centrePos.y - z * tileTopHeight) / tileTopHeight) + 1;
+	// Lager y på raden z ritas från z * tileTopHeight - y * tileHeight och tileTopHeight neråt.
+	const int a = floor((z * tileTopHeight - target.getEffHeight() / 2.0 - centrePos.y) / tileHeight);
 	const int lowerBound = 0;
 	const int upperBound = getHeight();
 	return a > lowerBound ? a < upperBound ? a : upperBound : lowerBound;
+}
+
+int World::calculateEndY(Point centrePos, int z, RenderTarget& target)
+{
+	const int a = floor((z * tileTopHeight + tileTopHeight + target.getEffHeight() / 2.0 - centrePos.y) / tileHeight) + 1;
+	const int lowerBound = 0;
+	const int upperBound = pyramid.maxHeight(0, 0, getWidth(), getDepth()) + 1;
+	return a > lowerBound ? a < upperBound ? a : upperBound : lowerBound;
+}
+
+PickResult World::pick(Point screenPos, Point centrePos, RenderTarget& target) const
+{
+	const double worldX = screenPos.x - target.getEffWidth() / 2.0 + centrePos.x;
+	const double worldY = screenPos.y - target.getEffHeight() / 2.0 + centrePos.y;
+	const int x = floor(worldX / tileWidth);
+	if (x < 0 || x >= static_cast<int>(heights.getWidth())) return {PickResult::NONE, 0, 0, 0};
+
+	/*
+	 * Tilen (x, z) med höjden h täcker skärmraderna [z * tileTopHeight - h * tileHeight, (z + 1) * tileTopHeight)
+	 * och rader längre fram ritas ovanpå rader längre bak. Den högsta tilen i kolumnen begränsar hur långt
+	 * fram en träff kan ligga.
+	*/
+	const uint16_t maxHeight = pyramid.maxHeight(x, 0, x + 1, heights.getHeight());
+	const int firstZ = std::min<int>(floor((worldY + maxHeight * tileHeight) / tileTopHeight), heights.getHeight() - 1);
+	const int lastZ = std::max<int>(floor(worldY / tileTopHeight), 0);
+	for (int z = firstZ; z >= lastZ; z--)
+	{
+		const uint16_t height = heights[x][z];
+		const double top = z * tileTopHeight - height * tileHeight;
+		const double bottom = (z + 1) * tileTopHeight;
+		if (worldY >= top && worldY < bottom)
+		{
+			if (worldY < top + tileTopHeight)
+				return {PickResult::TOP, x, z, height};
+			else
+				return {PickResult::SIDE, x, z, static_cast<int>(ceil((bottom - worldY) / tileHeight)) - 1};
+		}
+	}
+	return {PickResult::NONE, 0, 0, 0};
+}
+
+void World::writeHeight(int x, int z, uint16_t height)
+{
+	uint16_t& h = heights[x][z];
+	if (h != height)
+	{
+		journal.push_back({x, z, h});
+		h = height;
+	}
+}
+
+void World::heightsChanged(TileRect rect)
+{
+	// Grannarnas grannmasker och hur de ritas beror också på de ändrade höjderna.
+	const TileRect affected = clip({rect.startX - 1, rect.startZ - 1, rect.endX + 1, rect.endZ + 1});
+	updateNeighbourMasks(affected.startX, affected.startZ, affected.endX, affected.endZ);
+	updateTopRuns(affected);
+	pyramid.update(rect.startX, rect.startZ, rect.endX, rect.endZ);
+	for (DirtyRegions* d : dirtyRegions)
+	{
+		d->add(affected);
+	}
+}
+
+TileRect World::clip(TileRect rect) const noexcept
+{
+	rect.startX = std::max(rect.startX, 0);
+	rect.startZ = std::max(rect.startZ, 0);
+	rect.endX = std::max(std::min(rect.endX, static_cast<int>(heights.getWidth())), rect.startX);
+	rect.endZ = std::max(std::min(rect.endZ, static_cast<int>(heights.getHeight())), rect.startZ);
+	return rect;
+}
+
+void World::beginEdit()
+{
+	if (editDepth++ == 0)
+	{
+		journalEdits.push_back(journalStart + journal.size());
+		editBounds = {0, 0, 0, 0};
+	}
+}
+
+void World::endEdit()
+{
+	if (editDepth == 0 || --editDepth != 0) return;
+
+	if (journalStart + journal.size() == journalEdits.back())
+	{
+		// Inget ändrades, så det finns inget att ångra eller uppdatera.
+		journalEdits.pop_back();
+		return;
+	}
+
+	// Glöm de äldsta ändringarna, men aldrig den som just gjordes.
+	while (journal.size() > maxJournalSize && journalEdits.size() > 1)
+	{
+		journalEdits.pop_front();
+		journal.erase(journal.begin(), journal.begin() + (journalEdits.front() - journalStart));
+		journalStart = journalEdits.front();
+	}
+
+	heightsChanged(editBounds);
+}
+
+void World::extendEditBounds(TileRect area) noexcept
+{
+	if (area.startX >= area.endX || area.startZ >= area.endZ) return;
+	if (editBounds.startX >= editBounds.endX || editBounds.startZ >= editBounds.endZ)
+	{
+		editBounds = area;
+	}
+	else
+	{
+		editBounds.startX = std::min(editBounds.startX, area.startX);
+		editBounds.startZ = std::min(editBounds.startZ, area.startZ);
+		editBounds.endX = std::max(editBounds.endX, area.endX);
+		editBounds.endZ = std::max(editBounds.endZ, area.endZ);
+	}
+}
+
+void World::setHeight(int x, int z, uint16_t height)
+{
+	setHeight({x, z, x + 1, z + 1}, height);
+}
+
+void World::setHeight(TileRect area, uint16_t height)
+{
+	area = clip(area);
+	beginEdit();
+	for (int x = area.startX; x < area.endX; x++)
+	{
+		for (int z = area.startZ; z < area.endZ; z++)
+		{
+			writeHeight(x, z, height);
+		}
+	}
+	extendEditBounds(area);
+	endEdit();
+}
+
+void World::raise(int x, int z, int amount)
+{
+	raise({x, z, x + 1, z + 1}, amount);
+}
+
+void World::raise(TileRect area, int amount)
+{
+	area = clip(area);
+	beginEdit();
+	for (int x = area.startX; x < area.endX; x++)
+	{
+		for (int z = area.startZ; z < area.endZ; z++)
+		{
+			writeHeight(x, z, static_cast<uint16_t>(std::clamp(heights[x][z] + amount, 0, 0xffff)));
+		}
+	}
+	extendEditBounds(area);
+	endEdit();
+}
+
+void World::raiseCircle(int centreX, int centreZ, int radius, int amount)
+{
+	const TileRect area = clip({centreX - radius, centreZ - radius, centreX + radius + 1, centreZ + radius + 1});
+	beginEdit();
+	for (int x = area.startX; x < area.endX; x++)
+	{
+		for (int z = area.startZ; z < area.endZ; z++)
+		{
+			const int dx = x - centreX;
+			const int dz = z - centreZ;
+			if (dx * dx + dz * dz <= radius * radius)
+				writeHeight(x, z, static_cast<uint16_t>(std::clamp(heights[x][z] + amount, 0, 0xffff)));
+		}
+	}
+	extendEditBounds(area);
+	endEdit();
+}
+
+bool World::undo()
+{
+	if (journalEdits.empty() || editDepth != 0) return false;
+
+	const std::size_t start = journalEdits.back() - journalStart;
+	TileRect bounds = {journal[start].x, journal[start].z, journal[start].x + 1, journal[start].z + 1};
+	for (std::size_t i = journal.size(); i-- > start;)
+	{
+		const JournalEntry& e = journal[i];
+		heights[e.x][e.z] = e.oldHeight;
+		bounds.startX = std::min(bounds.startX, e.x);
+		bounds.startZ = std::min(bounds.startZ, e.z);
+		bounds.endX = std::max(bounds.endX, e.x + 1);
+		bounds.endZ = std::max(bounds.endZ, e.z + 1);
+	}
+	journal.resize(start);
+	journalEdits.pop_back();
+	heightsChanged(bounds);
+	return true;
+}
+
+void World::clearJournal() noexcept
+{
+	journal.clear();
+	journalEdits.clear();
+	journalStart = 0;
+	if (editDepth != 0) journalEdits.push_back(0);
 }
\ No newline at end of file
@@ -1,15 +1,25 @@
 ﻿#pragma once
+#include <cstdint>
+#include <deque>
 #include <limits>
+#include <vector>
 #include "image.h"
 #include "matrix.h"
 #include "geoutils.h"
-#include "directv.h"
+#include "rendertarget.h"
+#include "heightpyramid.h"
 
 constexpr float tileWidth = 32.0f;
 constexpr float tileHeight = 16.0f;
 constexpr float tileTopHeight = 32.0f;
+// Tilestorlekarna som tvåpotenser, för fixtalskoordinater.
+constexpr int tileWidthShift = 5;
+constexpr int tileHeightShift = 4;
+constexpr int tileTopHeightShift = 5;
+static_assert(1 << tileWidthShift == tileWidth && 1 << tileHeightShift == tileHeight && 1 << tileTopHeightShift == tileTopHeight);
 
-struct Tile
+// Bilderna som används för att rita en sorts tile.
+struct TileType
 {
 	struct TopImages {
 		Image base;
@@ -28,26 +38,196 @@ struct Tile
 		Image leftEdge;
 		Image grass;
 	} sideImages;
-	unsigned short height;
 };
 
+/*
+ * Bitarna i en tiles grannmask. En bit är satt om grannen åt det hållet är lägre än tilen.
+ * Grannar utanför världen räknas aldrig som lägre.
+*/
+enum NeighbourBit : unsigned char
+{
+	NEIGHBOUR_N  = 0b00000001,
+	NEIGHBOUR_S  = 0b00000010,
+	NEIGHBOUR_E  = 0b00000100,
+	NEIGHBOUR_W  = 0b00001000,
+	NEIGHBOUR_NE = 0b00010000,
+	NEIGHBOUR_NW = 0b00100000,
+	NEIGHBOUR_SE = 0b01000000,
+	NEIGHBOUR_SW = 0b10000000
+};
+
+// En vy av en tile. Värdena kopieras ut ur världen, så vyn blir inte uppdaterad om världen ändras.
+struct Tile
+{
+	const TileType& type;
+	uint16_t height;
+	unsigned char neighbourMask;
+};
+
+// En rektangel av tiles, [startX, endX) * [startZ, endZ).
+struct TileRect
+{
+	int startX;
+	int startZ;
+	int endX;
+	int endZ;
+};
+
+class DirtyRegions; // Forward-declarea för att World ska kunna ha DirtyRegions som en vän.
+class RenderQueue;
+
+// Resultatet av World::pick().
+struct PickResult
+{
+	enum Face
+	{
+		NONE,
+		TOP,
+		SIDE
+	};
+
+	Face face;
+	int x;
+	int z;
+	// Höjden på den del av tilen som träffades. För toppen är det tilens höjd och för sidan är det sidans lager.
+	int y;
+};
+
+/*
+ * Världen lagras som separata matriser (höjder, typer och grannmasker) istället för en matris med
+ * Tile-structs, så att kollisioner och culling bara behöver läsa den täta höjdmatrisen.
+*/
 class World
 {
 private:
-	Matrix<Tile> tiles;
+	std::vector<TileType> tileTypes;
+	Matrix<uint16_t> heights;
+	Matrix<unsigned char> types;
+	Matrix<unsigned char> neighbourMasks;
+	/*
+	 * Hur många tiles åt öster från (x, z), den själv medräknad, som har en topp som syns och samma höjd och
+	 * typ. 0 om toppen är dold. Basbilderna för en sådan rad läggs i renderkön som en enda bild som upprepas,
+	 * och kanterna och hörnen läggs efter den en tile i taget. Bara rader slås ihop, inte rektanglar, eftersom
+	 * alla tiles på en rad har samma djupnyckel och sprites därför ritas i samma ordning som förut.
+	*/
+	Matrix<uint16_t> topRuns;
+	HeightPyramid pyramid;
+	std::vector<DirtyRegions*> dirtyRegions;
+
+	// En ändring i ångra-journalen.
+	struct JournalEntry
+	{
+		int x;
+		int z;
+		uint16_t oldHeight;
+	};
+	/*
+	 * Ändringarna ligger i deques, så att de äldsta kan glömmas i tid proportionell mot hur mycket som
+	 * glöms. journalEdits räknar från den första journalraden som har skrivits, och journalStart är hur
+	 * många rader som har glömts, så ingen position behöver räknas om när rader tas bort i början.
+	*/
+	std::deque<JournalEntry> journal;
+	std::deque<std::size_t> journalEdits; // Där varje ändring börjar, räknat från den första raden som har skrivits.
+	std::size_t journalStart;
+	unsigned editDepth;
+	TileRect editBounds;
+
+	// Räknar om grannmaskerna i rektangeln [startX, endX) * [startZ, endZ). Rektangeln klipps mot världen.
+	void updateNeighbourMasks(int startX, int startZ, int endX, int endZ);
+	// Returnerar true om toppen på (x, z) syns, dvs. inte döljs av tilen framför.
+	bool visibleTop(int x, int z) const noexcept;
+	// Räknar om topRuns för raderna i area, som måste vara klippt mot världen. Längderna till vänster om area räknas om så långt de ändras.
+	void updateTopRuns(TileRect area);
+	/*
+	 * Lägger kanterna och hörnen på topparna av count tiles från (x, z) åt öster i kön. Tilesen måste ha samma
+	 * typ, och xPos är positionen för den första. Samma kant på flera tiles i rad blir en bild som upprepas.
+	*/
+	void drawTopOverlays(int x, int z, unsigned count, uint64_t key, float xPos, float yPos, RenderQueue& queue) const;
+	// Samma som ovan, men för kanterna och gräset på lager y av sidorna.
+	void drawSideOverlays(int x, int y, int z, unsigned count, uint64_t key, float xPos, float yPos, RenderQueue& queue) const;
+	// Ändrar höjden på en tile som finns i världen och skriver den gamla höjden i journalen.
+	void writeHeight(int x, int z, uint16_t height);
+	// Uppdaterar grannmasker, pyramiden och alla DirtyRegions för en ändrad rektangel.
+	void heightsChanged(TileRect rect);
+	// Klipper en rektangel mot världen.
+	TileRect clip(TileRect rect) const noexcept;
+	// Utökar editBounds så att den täcker area.
+	void extendEditBounds(TileRect area) noexcept;
 public:
-	World();
+	// Så många journalrader som sparas innan de äldsta ändringarna glöms bort.
+	static constexpr std::size_t maxJournalSize = 1 << 20;
+
+	/*
+	 * Skapar en slumpmässig värld med width * depth tiles. Höjderna tas från en std::mt19937 med seed, så
+	 * samma seed ger samma värld på alla plattformar.
+	*/
+	explicit World(uint32_t seed, unsigned width = 50, unsigned depth = 50);
+
+	// Ingen kopiering, eftersom pyramiden pekar på höjdmatrisen.
+	World(const World&) = delete;
+	// Ingen kopiering.
+	World& operator=(const World&) = delete;
+
+	// Lägger bilderna för alla tiles som syns på skärmen i kön. Om overlays är false läggs bara basbilderna i kön.
+	void draw(Point centrePos, RenderTarget& target, RenderQueue& queue, bool overlays = true);
+	// Lägger bilderna för lager y av tilen (x, z) i kön. Om overlays är false läggs bara basbilderna i kön.
+	void drawTile(int x, int y, int z, Point centrePos, RenderTarget& target, RenderQueue& queue, bool overlays = true);
+
+	unsigned getWidth() const noexcept {return heights.getWidth();}
+	unsigned getDepth() const noexcept {return heights.getHeight();}
+	constexpr unsigned getHeight() const noexcept {return std::numeric_limits<uint16_t>::max() + 1;}
+
+	int calculateStartX(Point centrePos, RenderTarget& target);
+	int calculateEndX(Point centrePos, RenderTarget& target);
+	// Returnerar de rader som kan synas. Ingen rad kan synas högre upp än vad den högsta tilen i världen når.
+	int calculateStartZ(Point centrePos, RenderTarget& target);
+	int calculateEndZ(Point centrePos, RenderTarget& target);
+	// Returnerar de lager på raden z som hamnar på skärmen. Lager över den högsta tilen i världen räknas inte.
+	int calculateStartY(Point centrePos, int z, RenderTarget& target);
+	int calculateEndY(Point centrePos, int z, RenderTarget& target);
+
+	/*
+	 * Returnerar den tile som syns överst på skärmpositionen screenPos (i samma koordinater som getEffWidth()).
+	 * Bara de rader som kan täcka punkten gås igenom, framifrån och bakåt, så tiden beror på hur hög
+	 * terrängen är i kolumnen och inte på hur stor skärmen är.
+	*/
+	PickResult pick(Point screenPos, Point centrePos, RenderTarget& target) const;
 
-	void drawTile(int x, int y, int z, Point centrePos, DirectV& dv, images_t& images);
+	// Returnerar en vy av tilen på (x, y). Kastar std::out_of_range om (x, y) är utanför världen. Frågor om många tiles finns i heightqueries.h.
+	Tile tileAt(int x, int y) const {return {tileTypes[types.at(x, y)], heights.at(x, y), neighbourMasks.at(x, y)};}
+	// Returnerar höjden på (x, y). Kastar std::out_of_range om (x, y) är utanför världen.
+	uint16_t heightAt(int x, int y) const {return heights.at(x, y);}
+	// Returnerar hela höjdmatrisen.
+	const Matrix<uint16_t>& getHeights() const noexcept {return heights;}
+	// Returnerar min/max-pyramiden över höjdmatrisen.
+	const HeightPyramid& getPyramid() const noexcept {return pyramid;}
+	// Returnerar längderna på raderna med toppar som ritas som en bild, se topRuns.
+	const Matrix<uint16_t>& getTopRuns() const noexcept {return topRuns;}
 
-	unsigned getWidth() const noexcept {return tiles.getWidth();}
-	unsigned getDepth() const noexcept {return tiles.getHeight();}
-	constexpr unsigned getHeight() const noexcept {return std::numeric_limits<decltype(Tile::height)>::max() + 1;}
+	/*
+	 * Redigering. Alla funktioner klipper mot världen och gör inget utanför den. Höjder hålls inom [0, 65535].
+	 * Varje anrop blir ett eget steg i ångra-journalen om det inte görs mellan beginEdit() och endEdit().
+	 * Kostnaden är proportionell mot det ändrade området, inte mot världens storlek.
+	*/
 
-	int calculateStartX(Point centrePos, DirectV& dv);
-	int calculateEndX(Point centrePos, DirectV& dv);
-	int calculateStartY(Point centrePos, int z, DirectV& dv);
-	int calculateEndY(Point centrePos, int z, DirectV& dv);
+	// Påbörjar en ändring som kan bestå av flera anrop (t.ex. ett penseldrag). Kan nästlas.
+	void beginEdit();
+	// Avslutar en ändring som påbörjades med beginEdit().
+	void endEdit();
+	// Sätter höjden på (x, z).
+	void setHeight(int x, int z, uint16_t height);
+	// Sätter höjden på alla tiles i rektangeln.
+	void setHeight(TileRect area, uint16_t height);
+	// Höjer (x, z) med amount. Ett negativt amount sänker.
+	void raise(int x, int z, int amount);
+	// Höjer alla tiles i rektangeln med amount. Ett negativt amount sänker.
+	void raise(TileRect area, int amount);
+	// Höjer alla tiles inom radius tiles från (centreX, centreZ) med amount. Ett negativt amount sänker.
+	void raiseCircle(int centreX, int centreZ, int radius, int amount);
+	// Ångrar den senaste ändringen. Returnerar false om det inte finns något att ångra.
+	bool undo();
+	// Glömmer alla ändringar i ångra-journalen.
+	void clearJournal() noexcept;
 
-	Tile& tileAt(int x, int y) {return tiles.at(x, y);}
+	friend DirtyRegions;
 };
\ No newline at end of file
@@ -0,0 +1,79 @@
+﻿#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+#include "worldfile.h"
+
+namespace
+{
+	constexpr char magic[4] = {'T', 'W', 'L', 'D'};
+	constexpr std::size_t headerSize = 16;
+
+	uint32_t readLE32(const uint8_t* p) noexcept {return uint32_t(p[3]) << 24 | uint32_t(p[2]) << 16 | uint32_t(p[1]) << 8 | p[0];}
+
+	void writeLE32(std::vector<uint8_t>& out, uint32_t v)
+	{
+		for (int shift = 0; shift < 32; shift += 8) out.push_back(v >> shift);
+	}
+}
+
+Matrix<uint16_t> loadWorldFile(const std::string& filename)
+{
+	std::ifstream file(filename, std::ios::binary);
+	if (!file) throw std::runtime_error("Failed to open " + filename + ".");
+	const std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	if (data.size() < headerSize || !std::equal(std::begin(magic), std::end(magic), data.begin()))
+	{
+		throw std::runtime_error(filename + " is not a world file.");
+	}
+	if (readLE32(&data[4]) != worldFileVersion) throw std::runtime_error(filename + " has an unsupported version.");
+	const uint32_t width = readLE32(&data[8]);
+	const uint32_t depth = readLE32(&data[12]);
+	const std::size_t cells = (data.size() - headerSize) / 2;
+	if (width == 0 || depth == 0 || (data.size() - headerSize) % 2 != 0 || cells % width != 0 || cells / width != depth)
+	{
+		throw std::runtime_error(filename + " has the wrong size.");
+	}
+
+	Matrix<uint16_t> heights(width, depth);
+	const uint8_t* p = &data[headerSize];
+	for (uint32_t z = 0; z < depth; z++)
+	{
+		for (uint32_t x = 0; x < width; x++, p += 2)
+		{
+			heights[x][z] = uint16_t(p[1] << 8 | p[0]);
+		}
+	}
+	return heights;
+}
+
+void saveWorldFile(const std::string& filename, const Matrix<uint16_t>& heights)
+{
+	std::vector<uint8_t> data(std::begin(magic), std::end(magic));
+	data.reserve(headerSize + std::size_t(heights.getWidth()) * heights.getHeight() * 2);
+	writeLE32(data, worldFileVersion);
+	writeLE32(data, heights.getWidth());
+	writeLE32(data, heights.getHeight());
+	for (unsigned z = 0; z < heights.getHeight(); z++)
+	{
+		for (unsigned x = 0; x < heights.getWidth(); x++)
+		{
+			data.push_back(heights[x][z]);
+			data.push_back(heights[x][z] >> 8);
+		}
+	}
+
+	const std::string temporary = filename + ".tmp";
+	{
+		std::ofstream file(temporary, std::ios::binary);
+		if (!file) throw std::runtime_error("Failed to create " + temporary + ".");
+		file.write(reinterpret_cast<const char*>(data.data()), data.size());
+		if (!file) throw std::runtime_error("Failed to write " + temporary + ".");
+	}
+	std::error_code error;
+	std::filesystem::rename(temporary, filename, error);
+	if (error) throw std::runtime_error("Failed to rename " + temporary + " to " + filename + ".");
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+﻿#pragma once
+#include <cstdint>
+#include <string>
+#include "matrix.h"
+
+/*
+ * Världsfiler. En fil börjar med "TWLD", en version och världens bredd och djup (alla som 32 bitar,
+ * little endian), följt av höjden på varje tile som 16 bitar, rad för rad med z som rad.
+*/
+
+constexpr uint32_t worldFileVersion = 1;
+
+// Läser höjderna från en världsfil. Kastar std::runtime_error om filen inte går att läsa eller är trasig.
+Matrix<uint16_t> loadWorldFile(const std::string& filename);
+/*
+ * Skriver höjderna till en världsfil. Filen skrivs först under ett annat namn och byter sedan namn, så
+ * att den som läser filen samtidigt aldrig ser en halvskriven fil. Kastar std::runtime_error om det inte går.
+*/
+void saveWorldFile(const std::string& filename, const Matrix<uint16_t>& heights);
\ No newline at end of file